@@ -0,0 +1,201 @@
+#ifndef SBPL_ADAPTIVE_CHUNKED_ARENA_H
+#define SBPL_ADAPTIVE_CHUNKED_ARENA_H
+
+// standard includes
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace adim {
+
+/// An append-only container that stores objects contiguously in fixed-size
+/// chunks. Objects are never moved, so pointers to them remain valid until the
+/// arena is cleared, and objects are addressed by the index at which they were
+/// created. Clearing the arena destroys all objects at once but keeps the
+/// chunks for reuse; releasing it also returns the chunks to the system.
+///
+/// Creating objects requires exclusive access, but objects that have been
+/// created may be read from other threads while further objects are created:
+/// chunks are located through a directory that is replaced rather than
+/// reallocated in place when it fills up, and the size is published only
+/// after the object has been constructed. Replaced directories are kept until
+/// the arena is cleared.
+///
+/// The size of a slot may be chosen at run time, for objects that store a
+/// variable number of trailing elements past the end of T, and slots may be
+/// aligned to more than alignof(T), e.g. to a cache line so that consecutive
+/// objects never share one.
+template <typename T>
+class ChunkedArena
+{
+public:
+
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    /// \param chunk_size The number of objects per chunk, rounded up to a
+    ///     power of two
+    /// \param slot_size The number of bytes reserved for each object, at
+    ///     least sizeof(T)
+    /// \param alignment The alignment of each object, a power of two that is
+    ///     at least alignof(T)
+    explicit ChunkedArena(
+        size_t chunk_size = 4096,
+        size_t slot_size = sizeof(T),
+        size_t alignment = alignof(T));
+
+    ~ChunkedArena() { release(); }
+
+    ChunkedArena(const ChunkedArena &) = delete;
+    ChunkedArena &operator=(const ChunkedArena &) = delete;
+
+    template <typename... Args>
+    T *create(Args&&... args);
+
+    T &operator[](size_t i) { return *slot(i); }
+    const T &operator[](size_t i) const { return *slot(i); }
+
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    /// \return The number of bytes of storage held by the arena
+    size_t capacityBytes() const { return num_chunks_ * chunk_size_ * stride_; }
+
+    /// \return The distance, in bytes, between consecutive objects
+    size_t stride() const { return stride_; }
+
+    void clear();
+    void release();
+
+private:
+
+    size_t chunk_size_;
+    size_t shift_;
+    size_t mask_;
+    size_t stride_;
+    size_t alignment_;
+    std::atomic<size_t> size_;
+
+    // the current directory is the last one in dirs_; it holds the aligned
+    // start of each chunk, and chunks_ the memory that backs them
+    std::atomic<char **> dir_;
+    std::vector<std::unique_ptr<char *[]>> dirs_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t dir_capacity_;
+    size_t num_chunks_;
+
+    T *slot(size_t i) const {
+        char *chunk = dir_.load(std::memory_order_acquire)[i >> shift_];
+        return reinterpret_cast<T *>(chunk + (i & mask_) * stride_);
+    }
+
+    void addChunk();
+};
+
+template <typename T>
+const size_t ChunkedArena<T>::CACHE_LINE_SIZE;
+
+template <typename T>
+ChunkedArena<T>::ChunkedArena(
+    size_t chunk_size,
+    size_t slot_size,
+    size_t alignment)
+:
+    chunk_size_(1),
+    shift_(0),
+    mask_(0),
+    stride_(0),
+    alignment_(std::max(alignment, alignof(T))),
+    size_(0),
+    dir_(nullptr),
+    dirs_(),
+    chunks_(),
+    dir_capacity_(0),
+    num_chunks_(0)
+{
+    assert((alignment_ & (alignment_ - 1)) == 0);
+    while (chunk_size_ < chunk_size) {
+        chunk_size_ <<= 1;
+        ++shift_;
+    }
+    mask_ = chunk_size_ - 1;
+    slot_size = std::max(slot_size, sizeof(T));
+    stride_ = (slot_size + alignment_ - 1) & ~(alignment_ - 1);
+}
+
+template <typename T>
+template <typename... Args>
+T *ChunkedArena<T>::create(Args&&... args)
+{
+    const size_t n = size_.load(std::memory_order_relaxed);
+    if ((n >> shift_) >= num_chunks_) {
+        addChunk();
+    }
+    T *obj = slot(n);
+    new (obj) T(std::forward<Args>(args)...);
+    size_.store(n + 1, std::memory_order_release);
+    return obj;
+}
+
+template <typename T>
+void ChunkedArena<T>::clear()
+{
+    const size_t n = size_.load(std::memory_order_relaxed);
+    if (!std::is_trivially_destructible<T>::value) {
+        for (size_t i = 0; i < n; ++i) {
+            (*this)[i].~T();
+        }
+    }
+    size_.store(0, std::memory_order_release);
+
+    // no reader may hold on to a replaced directory past this point
+    if (dirs_.size() > 1) {
+        dirs_.erase(dirs_.begin(), dirs_.end() - 1);
+    }
+}
+
+template <typename T>
+void ChunkedArena<T>::release()
+{
+    clear();
+    dir_.store(nullptr, std::memory_order_release);
+    dirs_.clear();
+    chunks_.clear();
+    dir_capacity_ = 0;
+    num_chunks_ = 0;
+}
+
+// Append a chunk to the directory, first moving the directory to one with
+// twice the capacity if it is full. The slots of the current directory past
+// the published chunks are not read by other threads, so they may be written
+// in place.
+template <typename T>
+void ChunkedArena<T>::addChunk()
+{
+    if (num_chunks_ == dir_capacity_) {
+        const size_t capacity = std::max<size_t>(2 * dir_capacity_, 16);
+        std::unique_ptr<char *[]> dir(new char *[capacity]);
+        if (num_chunks_ > 0) {
+            std::copy(dirs_.back().get(), dirs_.back().get() + num_chunks_, dir.get());
+        }
+        dir_.store(dir.get(), std::memory_order_release);
+        dirs_.push_back(std::move(dir));
+        dir_capacity_ = capacity;
+    }
+
+    std::unique_ptr<char[]> mem(new char[chunk_size_ * stride_ + alignment_ - 1]);
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(mem.get());
+    const uintptr_t aligned = (addr + alignment_ - 1) & ~(uintptr_t)(alignment_ - 1);
+    dirs_.back()[num_chunks_++] = reinterpret_cast<char *>(aligned);
+    chunks_.push_back(std::move(mem));
+}
+
+} // namespace adim
+
+#endif
@@ -2,6 +2,7 @@
 #define SBPL_ADAPTIVE_ADAPTIVE_DISCRETE_SPACE_H
 
 // standard includes
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,9 @@
 #include <sbpl/headers.h>
 #include <smpl/forward.h>
 
+// project includes
+#include <sbpl_adaptive/core/graph/successor_buffer.h>
+
 namespace adim {
 
 SBPL_CLASS_FORWARD(AdaptiveDiscreteSpace)
@@ -31,11 +35,36 @@ public:
 
     /// \brief used by the tracker to tell the environment which state is being
     /// expanded
+    ///
+    /// Parallel searches call this while holding their own lock, so calls are
+    /// never concurrent, though they may be made from any search thread.
     virtual void expandingState(int StateID) = 0;
 
     /// \brief gets the state ID of the 'best' state encountered during tracking
     virtual int getBestSeenState() = 0;
 
+    /// \brief whether successors may be generated, and heuristics evaluated,
+    /// concurrently from multiple threads, as done by PASEPlanner_AD.
+    /// Environments that are not thread safe are expanded one state at a time.
+    virtual bool supportsConcurrentExpansions() const { return false; }
+
+    /// \brief called by planners before and after a span in which they call
+    /// the environment from several threads concurrently, so that thread safe
+    /// environments may skip synchronization outside of such spans. Spans may
+    /// nest. See ConcurrentExpansionScope.
+    virtual void beginConcurrentExpansions() { }
+    virtual void endConcurrentExpansions() { }
+
+    /// \brief whether this environment and \p other share any state that is
+    /// modified while planning, so that they may not be searched concurrently
+    /// by separate planners, as done by AdaptivePlannerPool and
+    /// AdaptivePlannerPortfolio. Environments built on shared components must
+    /// report the components that are not safe to use from several threads.
+    virtual bool sharesMutableState(const AdaptiveDiscreteSpace &other) const
+    {
+        return this == &other;
+    }
+
     /// \brief checks if the given stateID path is executable
     virtual bool isExecutablePath(const std::vector<int> &stateIDV) = 0;
 
@@ -54,12 +83,33 @@ public:
     /// \brief resets the environment to its original state - no spheres, etc.
     virtual void reset() = 0;
 
+    /// \brief returns the id of the state in this environment equivalent to
+    /// the state \p src_state_id of the replica environment \p src, creating
+    /// it if necessary. Used to exchange paths and sphere locations between
+    /// replicas of the same environment. Returns -1 if unsupported.
+    ///
+    /// Environments that implement translateStateID() must also override
+    /// supportsStateTranslation().
+    virtual int translateStateID(
+        const AdaptiveDiscreteSpace &src,
+        int src_state_id)
+    {
+        return -1;
+    }
+
+    /// \brief whether translateStateID() is implemented
+    virtual bool supportsStateTranslation() const { return false; }
+
     /// \name Interface Functions for TRAPlanner
     ///@{
 
     /// \brief adds a new sphere of radius rad at the state coordinates
     /// specified by StateID returns the earliest expansion step of the modified
     /// states
+    ///
+    /// \p first_mod_step is set to INT_MAX if none of the modified states has
+    /// been expanded, or to -1 if the affected expansion steps are unknown, in
+    /// which case the search must start from scratch.
     virtual void addSphere(int StateID, int &first_mod_step) = 0;
 
     void GetPreds(
@@ -74,6 +124,16 @@ public:
         std::vector<int> *SuccIDV,
         std::vector<int> *CostV);
 
+    void GetPreds(
+        int TargetStateID,
+        int expansionStep,
+        SuccessorBuffer *preds);
+
+    void GetSuccs(
+        int SourceStateID,
+        int expansionStep,
+        SuccessorBuffer *succs);
+
     ///@}
 
     virtual void visualizeState(int sID, int scolor, std::string name);
@@ -98,6 +158,27 @@ public:
 
     bool isInTrackingMode() const { return trackMode; }
 
+    /// \brief whether the searches over this environment should stop
+    ///
+    /// Searches poll this and return as if they ran out of time once it is
+    /// true, which is the case while any InterruptToken of the environment is
+    /// raised.
+    bool interruptRequested() const { return interrupts_ > 0; }
+
+    /// \name Heuristic Invalidation
+    ///
+    /// Searches may cache the heuristic values of states across calls for the
+    /// same goal if the environment opts in via heuristicsCacheable(). Such
+    /// environments must call invalidateHeuristics() whenever their
+    /// heuristics change for reasons other than a change of the goal, e.g.
+    /// when a precomputed distance field is rebuilt. The heuristics of other
+    /// environments are recomputed for every search.
+    ///@{
+    virtual bool heuristicsCacheable() const { return false; }
+    void invalidateHeuristics() { ++heuristic_epoch_; }
+    unsigned int heuristicEpoch() const { return heuristic_epoch_; }
+    ///@}
+
     const std::vector<int> &getLastAdaptivePath() { return lastAdaptivePath_; }
 
     /// \name Reimplemented Public Functions from DiscreteSpaceInformation
@@ -115,6 +196,35 @@ public:
 
     ///@}
 
+    /// \name Buffered Transition Generation
+    ///
+    /// Equivalent to the std::vector-based GetSuccs and GetPreds, but clear
+    /// and refill a buffer owned by the caller so that its storage is reused
+    /// across expansions.
+    ///@{
+
+    void GetSuccs(int SourceStateID, SuccessorBuffer *succs);
+    void GetPreds(int TargetStateID, SuccessorBuffer *preds);
+
+    ///@}
+
+    /// \name Lazy Edge Evaluation
+    ///
+    /// Used by searches that defer the validation of edges until their target
+    /// state is selected for expansion. GetLazySuccs returns successors with a
+    /// lower bound on the cost of each edge, and flags the costs that are
+    /// exact; the remaining edges are validated on demand via EvaluateEdge. By
+    /// default, all successors are generated as by GetSuccs with exact costs.
+    ///@{
+
+    void GetLazySuccs(int SourceStateID, SuccessorBuffer *succs);
+
+    /// \brief returns the exact cost of the edge between two states in the
+    /// current mode, or -1 if the edge is invalid
+    virtual int EvaluateEdge(int SourceStateID, int TargetStateID);
+
+    ///@}
+
 protected:
 
     /// NOTES:
@@ -126,6 +236,9 @@ protected:
     /// * getSuccs and getPreds functions should take into account the
     ///   environment mode when generating successor or predecessor states for
     ///   the planner
+    /// * The output vectors of the GetSuccs_* and GetPreds_* functions are
+    ///   cleared by the caller and reused across expansions; append to them
+    ///   rather than assigning new vectors to keep their storage
 
     /// \brief gets successors for tracking mode
     virtual void GetSuccs_Track(
@@ -179,6 +292,20 @@ protected:
         std::vector<int>* PredIDV,
         std::vector<int>* CostV) = 0;
 
+    /// \brief gets successors with lower-bound costs for tracking mode
+    virtual void GetLazySuccs_Track(
+        int SourceStateID,
+        std::vector<int>* SuccIDV,
+        std::vector<int>* CostV,
+        std::vector<bool>* isTrueCost);
+
+    /// \brief gets successors with lower-bound costs for planning mode
+    virtual void GetLazySuccs_Plan(
+        int SourceStateID,
+        std::vector<int>* SuccIDV,
+        std::vector<int>* CostV,
+        std::vector<bool>* isTrueCost);
+
     virtual void onSetPlanMode() { }
 
     virtual void onSetTrackMode(
@@ -190,15 +317,111 @@ private:
 
     bool trackMode; ///< true - tracking, false - planning
     std::vector<int> lastAdaptivePath_;
+    std::atomic<int> interrupts_; ///< number of raised interrupt tokens
+    unsigned int heuristic_epoch_;
+
+    friend class InterruptToken;
+};
+
+/// \brief Brackets a span of concurrent calls to an environment for the
+/// lifetime of the object, if \p concurrent is set
+class ConcurrentExpansionScope
+{
+public:
+
+    ConcurrentExpansionScope(AdaptiveDiscreteSpace *space, bool concurrent) :
+        space_(concurrent ? space : nullptr)
+    {
+        if (space_) {
+            space_->beginConcurrentExpansions();
+        }
+    }
+
+    ~ConcurrentExpansionScope()
+    {
+        if (space_) {
+            space_->endConcurrentExpansions();
+        }
+    }
+
+    ConcurrentExpansionScope(const ConcurrentExpansionScope &) = delete;
+    ConcurrentExpansionScope &operator=(const ConcurrentExpansionScope &) = delete;
+
+private:
+
+    AdaptiveDiscreteSpace *space_;
+};
+
+/// \brief A handle through which one party interrupts the searches over an
+/// environment
+///
+/// The environment is interrupted while any of its tokens is raised, so that
+/// parties interrupting the same environment for different reasons, e.g. a
+/// planner stopping its own background search and a portfolio stopping the
+/// planner, do not clear each other's interrupts. A token may be raised from
+/// any thread and remains raised until cleared or destroyed.
+class InterruptToken
+{
+public:
+
+    explicit InterruptToken(AdaptiveDiscreteSpace *space = nullptr);
+    ~InterruptToken() { clear(); }
+
+    InterruptToken(const InterruptToken &) = delete;
+    InterruptToken &operator=(const InterruptToken &) = delete;
+
+    /// \brief clear the token and bind it to another environment
+    void reset(AdaptiveDiscreteSpace *space);
+
+    void raise();
+    void clear();
+    bool raised() const { return raised_; }
+
+private:
+
+    AdaptiveDiscreteSpace *space_;
+    std::atomic<bool> raised_;
 };
 
 inline
 AdaptiveDiscreteSpace::AdaptiveDiscreteSpace() :
     trackMode(false),
-    lastAdaptivePath_()
+    lastAdaptivePath_(),
+    interrupts_(0),
+    heuristic_epoch_(0)
 {
 }
 
+inline
+InterruptToken::InterruptToken(AdaptiveDiscreteSpace *space) :
+    space_(space),
+    raised_(false)
+{
+}
+
+inline
+void InterruptToken::reset(AdaptiveDiscreteSpace *space)
+{
+    clear();
+    space_ = space;
+}
+
+inline
+void InterruptToken::raise()
+{
+    if (space_ && !raised_.exchange(true)) {
+        ++space_->interrupts_;
+    }
+}
+
+inline
+void InterruptToken::clear()
+{
+    if (space_ && raised_.exchange(false)) {
+        --space_->interrupts_;
+    }
+}
+
 inline
 void AdaptiveDiscreteSpace::GetPreds(
     int TargetStateID,
@@ -257,6 +480,93 @@ void AdaptiveDiscreteSpace::GetSuccs(
     }
 }
 
+inline
+void AdaptiveDiscreteSpace::GetPreds(
+    int TargetStateID,
+    int expansionStep,
+    SuccessorBuffer *preds)
+{
+    preds->clear();
+    GetPreds(TargetStateID, expansionStep, &preds->ids, &preds->costs);
+}
+
+inline
+void AdaptiveDiscreteSpace::GetSuccs(
+    int SourceStateID,
+    int expansionStep,
+    SuccessorBuffer *succs)
+{
+    succs->clear();
+    GetSuccs(SourceStateID, expansionStep, &succs->ids, &succs->costs);
+}
+
+inline
+void AdaptiveDiscreteSpace::GetPreds(int TargetStateID, SuccessorBuffer *preds)
+{
+    preds->clear();
+    GetPreds(TargetStateID, &preds->ids, &preds->costs);
+}
+
+inline
+void AdaptiveDiscreteSpace::GetSuccs(int SourceStateID, SuccessorBuffer *succs)
+{
+    succs->clear();
+    GetSuccs(SourceStateID, &succs->ids, &succs->costs);
+}
+
+inline
+void AdaptiveDiscreteSpace::GetLazySuccs(
+    int SourceStateID,
+    SuccessorBuffer *succs)
+{
+    succs->clear();
+    if (trackMode) {
+        GetLazySuccs_Track(
+                SourceStateID, &succs->ids, &succs->costs, &succs->true_costs);
+    }
+    else {
+        GetLazySuccs_Plan(
+                SourceStateID, &succs->ids, &succs->costs, &succs->true_costs);
+    }
+}
+
+inline
+int AdaptiveDiscreteSpace::EvaluateEdge(int SourceStateID, int TargetStateID)
+{
+    std::vector<int> succs;
+    std::vector<int> costs;
+    GetSuccs(SourceStateID, &succs, &costs);
+    int cost = -1;
+    for (size_t i = 0; i < succs.size(); ++i) {
+        if (succs[i] == TargetStateID && (cost < 0 || costs[i] < cost)) {
+            cost = costs[i];
+        }
+    }
+    return cost;
+}
+
+inline
+void AdaptiveDiscreteSpace::GetLazySuccs_Track(
+    int SourceStateID,
+    std::vector<int>* SuccIDV,
+    std::vector<int>* CostV,
+    std::vector<bool>* isTrueCost)
+{
+    GetSuccs_Track(SourceStateID, SuccIDV, CostV);
+    isTrueCost->assign(SuccIDV->size(), true);
+}
+
+inline
+void AdaptiveDiscreteSpace::GetLazySuccs_Plan(
+    int SourceStateID,
+    std::vector<int>* SuccIDV,
+    std::vector<int>* CostV,
+    std::vector<bool>* isTrueCost)
+{
+    GetSuccs_Plan(SourceStateID, SuccIDV, CostV);
+    isTrueCost->assign(SuccIDV->size(), true);
+}
+
 inline
 void AdaptiveDiscreteSpace::visualizeStatePath(
     std::vector<int> *path,
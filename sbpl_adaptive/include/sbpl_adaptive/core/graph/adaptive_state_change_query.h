@@ -0,0 +1,39 @@
+#ifndef SBPL_ADAPTIVE_ADAPTIVE_STATE_CHANGE_QUERY_H
+#define SBPL_ADAPTIVE_ADAPTIVE_STATE_CHANGE_QUERY_H
+
+// standard includes
+#include <vector>
+
+// system includes
+#include <sbpl/headers.h>
+
+namespace adim {
+
+/// A description of a change to the edge costs of an adaptive environment, to
+/// be passed to SBPLPlanner::costs_changed().
+///
+/// Following the SBPL convention, predecessors are the states whose outgoing
+/// edges changed and successors are the states whose incoming edges changed.
+/// Additionally, environments that record the expansion step of each region
+/// (e.g. via ExpansionGrid3D) may report the earliest expansion step affected
+/// by the change, as returned by ExpansionGrid3D::getEarliestExpansionStep()
+/// for the modified cells or filled in by
+/// MultiRepAdaptiveDiscreteSpace::FillExpansionStep(); a negative step means
+/// the step is unknown.
+class AdaptiveStateChangeQuery : public StateChangeQuery
+{
+public:
+
+    std::vector<int> predecessors;
+    std::vector<int> successors;
+    int expansion_step;
+
+    AdaptiveStateChangeQuery() : predecessors(), successors(), expansion_step(-1) { }
+
+    const std::vector<int> *getPredecessors() const override { return &predecessors; }
+    const std::vector<int> *getSuccessors() const override { return &successors; }
+};
+
+} // namespace adim
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SBPL_ADAPTIVE_SUCCESSOR_BUFFER_H
+#define SBPL_ADAPTIVE_SUCCESSOR_BUFFER_H
+
+// standard includes
+#include <stddef.h>
+#include <vector>
+
+namespace adim {
+
+/// A reusable buffer of transitions, stored as parallel arrays of target state
+/// ids and costs. Lazily generated transitions additionally record whether
+/// each cost is exact.
+///
+/// Searches keep one buffer for the lifetime of the planner and pass it to
+/// every expansion. Clearing it keeps its storage, so that after the first few
+/// expansions generating successors no longer allocates. Environments fill the
+/// buffer through the same vector pointers as the std::vector-based
+/// GetSuccs/GetPreds interface, and must only append to them.
+struct SuccessorBuffer
+{
+    std::vector<int> ids;
+    std::vector<int> costs;
+    std::vector<bool> true_costs;
+
+    void clear() { ids.clear(); costs.clear(); true_costs.clear(); }
+
+    void reserve(size_t n) { ids.reserve(n); costs.reserve(n); true_costs.reserve(n); }
+
+    void push_back(int id, int cost) { ids.push_back(id); costs.push_back(cost); }
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+};
+
+} // namespace adim
+
+#endif
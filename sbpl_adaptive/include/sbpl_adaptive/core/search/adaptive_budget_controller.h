@@ -0,0 +1,87 @@
+#ifndef SBPL_ADAPTIVE_ADAPTIVE_BUDGET_CONTROLLER_H
+#define SBPL_ADAPTIVE_ADAPTIVE_BUDGET_CONTROLLER_H
+
+// standard includes
+#include <deque>
+#include <mutex>
+
+// system includes
+#include <smpl/forward.h>
+
+namespace adim {
+
+SBPL_CLASS_FORWARD(AdaptiveBudgetController)
+
+/// Learns per-phase time budgets for the adaptive planner from the outcomes of
+/// previous planning and tracking searches.
+///
+/// For each phase, the controller keeps a bounded window of the time the phase
+/// search needed to produce a solution. The budget for the next search is a
+/// high quantile of that window, scaled by a slack factor, and clamped to the
+/// configured per-retry limit. Every search that exhausts its budget without
+/// success multiplies the budget of its phase by the slack factor, up to the
+/// limit, until the next success of the phase.
+///
+/// Budgets are only learned once a minimum number of samples has been
+/// recorded; until then the configured limit is used. A single controller may
+/// be shared by several planners over the same environment.
+class AdaptiveBudgetController
+{
+public:
+
+    enum Phase { PLANNING = 0, TRACKING, NUM_PHASES };
+
+    AdaptiveBudgetController();
+
+    /// \name Parameters
+    ///@{
+    void setWindowSize(size_t size);
+    void setMinSamples(size_t count) { min_samples_ = count; }
+    void setQuantile(double q) { quantile_ = q; }
+    void setSlack(double slack) { slack_ = slack; }
+    void setMinBudget(double secs) { min_budget_ = secs; }
+
+    size_t windowSize() const { return window_size_; }
+    size_t minSamples() const { return min_samples_; }
+    double quantile() const { return quantile_; }
+    double slack() const { return slack_; }
+    double minBudget() const { return min_budget_; }
+    ///@}
+
+    /// Return the time budget for the next search of a phase, no greater than
+    /// \p max_budget.
+    double budget(Phase phase, double max_budget) const;
+
+    /// Record the time a phase needed to produce a solution, summed over the
+    /// searches it ran
+    void recordSuccess(Phase phase, double elapsed);
+
+    /// Record a phase that exhausted its budget after \p elapsed seconds, summed
+    /// over its searches, without producing a solution, growing the budget of
+    /// the phase
+    void recordFailure(Phase phase, double elapsed);
+
+    size_t numSamples(Phase phase) const;
+
+    void reset();
+
+private:
+
+    size_t window_size_;
+    size_t min_samples_;
+    double quantile_;
+    double slack_;
+    double min_budget_;
+
+    mutable std::mutex mutex_;
+    std::deque<double> samples_[NUM_PHASES];
+
+    // factor applied to the learned budget, grown by consecutive failures
+    double growth_[NUM_PHASES];
+
+    void push(Phase phase, double sample);
+};
+
+} // namespace adim
+
+#endif
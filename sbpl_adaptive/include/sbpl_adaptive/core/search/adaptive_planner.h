@@ -2,7 +2,10 @@
 #define SBPL_ADAPTIVE_ADAPTIVE_PLANNER_H
 
 // standard includes
+#include <functional>
+#include <future>
 #include <memory>
+#include <thread>
 
 // system includes
 #include <ros/console.h>
@@ -13,6 +16,8 @@
 // project includes
 #include <sbpl_adaptive/SCVStat.h>
 #include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/search/adaptive_budget_controller.h>
+#include <sbpl_adaptive/core/search/planner_trace.h>
 
 namespace adim {
 
@@ -52,6 +57,45 @@ public:
 /// current query. If the underlying search procedures are also resumable, this
 /// feature can be used to preempt the search and dedicate more time in the
 /// event of failures to find solutions.
+///
+/// By default, every planning phase searches from scratch. If the planning
+/// search is a TRAPlanner, incremental planning may be enabled (see
+/// set_incremental_planning()), in which case each planning phase restores the
+/// search tree of the previous one to the earliest expansion step affected by
+/// the new spheres, and only repeats the work downstream of it.
+///
+/// Optionally, the planning phase of the next iteration may be started
+/// speculatively while the tracking phase of the current iteration is still
+/// running (see enableSpeculativePlanning()). The speculative search runs on a
+/// second thread in a replica of the environment, with a sphere predicted at
+/// the best state seen so far by the tracker. If tracking then fails at the
+/// predicted state, the speculative path replaces the next planning search;
+/// otherwise, it is discarded.
+///
+/// The time limits given for the planning and tracking searches may be tuned
+/// automatically by an AdaptiveBudgetController (see set_budget_controller()).
+/// The controller learns from the outcomes of the phase searches of previous
+/// iterations and queries, and sets the time limits of each iteration, never
+/// exceeding the configured limits.
+///
+/// When edge costs change (see costs_changed()), the spheres introduced so far
+/// are kept and the change is forwarded to the planning and tracking searches,
+/// which may repair their search trees rather than starting from scratch. The
+/// next call to replan() then begins a new iteration from the planning phase.
+///
+/// Optionally, the search may continue in the background after a solution has
+/// been returned (see enableBackgroundRefinement()). The reused tracking
+/// search continues at lower suboptimality bounds, and new spheres are then
+/// introduced along costly stretches of the solution while the target bound
+/// is tightened. Each cheaper solution is published through a callback. The
+/// refinement is stopped before any other call modifies the planner, which
+/// then returns to its state, and its environment to its spheres and mode,
+/// from before the refinement.
+///
+/// Progress of the search is reported at debug level only. For a structured
+/// record of each query, attach a PlannerTrace (see set_trace()), which
+/// receives typed events for phase boundaries, searches, sphere insertions,
+/// tracking cost ratios, and partial paths.
 class AdaptivePlanner : public SBPLPlanner
 {
 public:
@@ -79,6 +123,49 @@ public:
 
     bool set_time_per_retry(double t_plan, double t_track);
 
+    bool set_phase_eps(double planning_eps, double tracking_eps);
+
+    void set_budget_controller(const AdaptiveBudgetControllerPtr &controller);
+    const AdaptiveBudgetControllerPtr &budget_controller() const { return budget_controller_; }
+
+    void set_trace(const PlannerTracePtr &trace);
+    const PlannerTracePtr &trace() const { return trace_; }
+
+    bool set_incremental_planning(bool enabled);
+    bool incremental_planning() const { return incremental_planning_; }
+
+    /// \name Speculative Planning
+    ///@{
+    bool enableSpeculativePlanning(
+        AdaptiveDiscreteSpace *spec_space,
+        const PlannerAllocator &spec_search_alloc,
+        double probe_time = 0.0);
+
+    void disableSpeculativePlanning();
+
+    bool speculativePlanningEnabled() const { return (bool)spec_planner_; }
+    ///@}
+
+    /// \name Background Refinement
+    ///@{
+    typedef std::function<void(const std::vector<int> &solution, int cost)>
+            SolutionCallback;
+
+    void enableBackgroundRefinement(
+        const SolutionCallback &callback,
+        double time_limit,
+        double dec_eps = 0.2);
+
+    void disableBackgroundRefinement();
+
+    bool backgroundRefinementEnabled() const { return (bool)refine_callback_; }
+
+    bool refining() const { return refine_thread_.joinable(); }
+
+    void waitForRefinement();
+    void stopRefinement();
+    ///@}
+
     /// \name Required Public Functions from SBPLPlanner
     ///@{
     int replan(
@@ -139,6 +226,13 @@ private:
     ///@{
     double time_per_retry_plan_;
     double time_per_retry_track_;
+
+    // learns the time limits of the phase searches; may be null
+    AdaptiveBudgetControllerPtr budget_controller_;
+
+    // time limits of the phase searches of the current iteration
+    double plan_budget_;
+    double track_budget_;
     ///@}
 
     /// \name Search Parameters
@@ -146,6 +240,10 @@ private:
     double target_eps_;
     double planning_eps_;
     double tracking_eps_;
+
+    // restore the planning search tree across iterations instead of planning
+    // from scratch; requires the planning search to be a TRAPlanner
+    bool incremental_planning_;
     ///@}
 
     /// \name Query
@@ -162,6 +260,7 @@ private:
     unsigned int search_expands_;
     int num_iterations_;
 
+    PlannerTracePtr trace_;
     ///@}
 
     /// \name Search State
@@ -195,8 +294,92 @@ private:
     int last_track_iter_;
     ///@}
 
+    /// \name Speculative Planning State
+    ///@{
+
+    // replica of adaptive_environment_ searched by spec_planner_ on a second
+    // thread while the tracker runs; only ever touched by one thread at a time
+    AdaptiveDiscreteSpace *spec_environment_;
+    std::unique_ptr<SBPLPlanner> spec_planner_;
+    InterruptToken spec_interrupt_;
+
+    // time the tracker runs before a speculative search is launched
+    double spec_probe_time_;
+
+    // locations of all spheres introduced for the current query
+    std::vector<int> sphere_history_;
+
+    struct SpeculativePlan
+    {
+        int ret;
+        int cost;
+        std::vector<int> sol; // state ids in spec_environment_
+    };
+
+    std::future<SpeculativePlan> spec_future_;
+    int spec_iter_;       // iteration the speculative search is planning for
+    int spec_sphere_;     // predicted sphere location
+    bool spec_adopt_;     // the prediction matched the tracking failure
+    ///@}
+
+    /// \name Background Refinement State
+    ///@{
+    SolutionCallback refine_callback_;
+    double refine_time_limit_;
+    double refine_dec_eps_;
+
+    // runs refine(); owns the planner state while joinable
+    std::thread refine_thread_;
+    InterruptToken refine_interrupt_;
+
+    // the planner state when the refinement was launched, restored once the
+    // refinement stops
+    struct RefinementSnapshot
+    {
+        double plan_budget;
+        double track_budget;
+        double planning_eps;
+        double tracking_eps;
+        AdaptivePlannerCSVStat_c stat;
+        double final_eps_planning_time;
+        double final_eps;
+        unsigned int search_expands;
+        int num_iterations;
+        PlanMode plan_mode;
+        int iteration;
+        std::vector<int> plan_sol;
+        int plan_cost;
+        std::vector<int> track_sol;
+        int track_cost;
+        std::vector<int> pending_spheres;
+        sbpl::clock::duration iter_elapsed;
+        sbpl::clock::duration plan_elapsed;
+        sbpl::clock::duration track_elapsed;
+        sbpl::clock::duration time_elapsed;
+        int last_plan_iter;
+        int last_track_iter;
+        std::vector<int> sphere_history;
+    };
+
+    RefinementSnapshot refine_snapshot_;
+    ///@}
+
+    void traceEvent(TraceEvent::Type type, int64_t value = 0, double real = 0.0) const;
+    void logIterationTimes() const;
+
+    double phaseBudget(AdaptiveBudgetController::Phase phase, double limit) const;
+
+    void launchRefinement(const std::vector<int> &solution, int cost);
+    void refine(std::vector<int> solution, int cost);
+    void saveRefinementSnapshot();
+    void restoreRefinementSnapshot();
+
     bool onPlanningState(const sbpl::clock::duration time_remaining, std::vector<int> &sol);
     bool onTrackingState(const sbpl::clock::duration time_remaining, std::vector<int> &sol);
+
+    bool launchSpeculativePlan();
+    bool adoptSpeculativePlan();
+    void discardSpeculativePlan();
 };
 
 inline int AdaptivePlanner::replan(
@@ -236,6 +419,19 @@ inline int AdaptivePlanner::replan(
             solution_stateIDs_V, &solcost);
 }
 
+inline void AdaptivePlanner::traceEvent(
+    TraceEvent::Type type,
+    int64_t value,
+    double real) const
+{
+    if (trace_) {
+        trace_->record(
+                type,
+                plan_mode_ == PLANNING ? TraceEvent::PLANNING : TraceEvent::TRACKING,
+                iteration_, value, real);
+    }
+}
+
 inline double AdaptivePlanner::get_solution_eps() const
 {
     ROS_WARN("get_solution_eps() not implemented for this planner!");
@@ -248,11 +444,6 @@ inline double AdaptivePlanner::get_final_epsilon()
     return planner_->get_final_epsilon() * tracker_->get_final_epsilon();
 }
 
-inline void AdaptivePlanner::costs_changed(StateChangeQuery const & stateChange)
-{
-    ROS_WARN("costs_changed(...) NOT IMPLEMENTED FOR THIS PLANNER");
-}
-
 } // namespace adim
 
 #endif
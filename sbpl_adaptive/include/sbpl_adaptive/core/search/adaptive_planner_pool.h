@@ -0,0 +1,120 @@
+#ifndef SBPL_ADAPTIVE_ADAPTIVE_PLANNER_POOL_H
+#define SBPL_ADAPTIVE_ADAPTIVE_PLANNER_POOL_H
+
+// standard includes
+#include <functional>
+#include <memory>
+#include <vector>
+
+// system includes
+#include <smpl/forward.h>
+
+// project includes
+#include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/search/adaptive_planner.h>
+
+namespace adim {
+
+SBPL_CLASS_FORWARD(AdaptivePlannerPool)
+
+/// Solves batches of independent queries with a pool of AdaptivePlanner
+/// workers running on separate threads.
+///
+/// Each worker owns a mutable adaptive environment (state tables, sphere
+/// state, search state) that is never touched by another worker. The parts of
+/// the environment that do not change during planning, such as the occupancy
+/// grid, the robot model, and precomputed heuristics, are meant to be built
+/// once and shared by the environments of all workers (e.g. AdaptiveGrid3D
+/// only refers to a const sbpl::OccupancyGrid). Any shared part must be safe
+/// to use from several threads at once.
+///
+/// The contract is enforced via AdaptiveDiscreteSpace::sharesMutableState():
+/// a worker is rejected if its environment shares mutable state with the
+/// environment of another worker. For MultiRepAdaptiveDiscreteSpace, each
+/// worker's space must have its own representations, abstract goal, and
+/// thread pool (if any).
+///
+/// Since state ids are only meaningful within the environment that created
+/// them, queries are described by a callback that sets up the start and goal
+/// in the environment of the worker that runs the query, and solutions are
+/// reported in terms of that environment (see BatchResult::worker and
+/// replanBatch()).
+class AdaptivePlannerPool
+{
+public:
+
+    struct BatchResult
+    {
+        int ret;                // 1 if a solution was found; 0 otherwise
+        int cost;
+        int worker;             // index of the worker that ran the query
+        double time;            // time spent on the query (s)
+        std::vector<int> solution;  // state ids in the worker's environment
+    };
+
+    /// Set up query \p query in the environment \p space and store the ids of
+    /// its start and goal states.
+    /// \return false if the query is invalid
+    typedef std::function<bool(
+            AdaptiveDiscreteSpace *space,
+            size_t query,
+            int &start_id,
+            int &goal_id)> QuerySetupFn;
+
+    /// Called on the worker thread once query \p query has finished, while the
+    /// state ids of its solution are still valid in \p space.
+    typedef std::function<void(
+            AdaptiveDiscreteSpace *space,
+            size_t query,
+            const BatchResult &result)> QueryDoneFn;
+
+    AdaptivePlannerPool(bool forward_search = true);
+
+    /// Add a worker to the pool. The environment must not share mutable
+    /// state with the environment of any other worker and must outlive the
+    /// pool.
+    /// \return The index of the new worker, or -1 if the environment shares
+    ///     mutable state with that of another worker
+    int addWorker(
+        AdaptiveDiscreteSpace *space,
+        const PlannerAllocator &plan_search_alloc,
+        const PlannerAllocator &track_search_alloc);
+
+    int numWorkers() const { return (int)workers_.size(); }
+
+    AdaptivePlanner *planner(int i) { return workers_[i].planner.get(); }
+    AdaptiveDiscreteSpace *workerSpace(int i) { return workers_[i].space; }
+
+    /// Solve \p num_queries queries, distributed over all workers, allotting
+    /// up to \p allocated_time_secs to each query.
+    /// \param[out] results The result of each query, in query order
+    /// \return The number of queries for which a solution was found
+    int replanBatch(
+        size_t num_queries,
+        const QuerySetupFn &setup,
+        double allocated_time_secs,
+        std::vector<BatchResult> *results,
+        const QueryDoneFn &done = QueryDoneFn());
+
+private:
+
+    struct Worker
+    {
+        AdaptiveDiscreteSpace *space;
+        std::unique_ptr<AdaptivePlanner> planner;
+    };
+
+    bool forward_search_;
+    std::vector<Worker> workers_;
+
+    void runQuery(
+        int worker,
+        size_t query,
+        const QuerySetupFn &setup,
+        double allocated_time_secs,
+        BatchResult &result);
+};
+
+} // namespace adim
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SBPL_ADAPTIVE_ADAPTIVE_PLANNER_PORTFOLIO_H
+#define SBPL_ADAPTIVE_ADAPTIVE_PLANNER_PORTFOLIO_H
+
+// standard includes
+#include <memory>
+#include <vector>
+
+// system includes
+#include <smpl/forward.h>
+
+// project includes
+#include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/search/adaptive_planner.h>
+
+namespace adim {
+
+SBPL_CLASS_FORWARD(AdaptivePlannerPortfolio)
+
+/// Races several configurations of AdaptivePlanner against each other on the
+/// same query and returns the first executable solution.
+///
+/// Each configuration consists of its own copy of the adaptive environment and
+/// its own pair of planning/tracking search allocators, so that the
+/// configurations share no mutable state and may run concurrently. Since state
+/// ids are only meaningful within the environment that created them, the start
+/// and goal must be set on each configuration's planner individually (see
+/// planner()) and the solution returned by replan() refers to the environment
+/// of the winning configuration (see winner()).
+///
+/// Once a configuration finds a solution, the remaining configurations are
+/// interrupted through an InterruptToken of their environments owned by the
+/// portfolio.
+class AdaptivePlannerPortfolio
+{
+public:
+
+    AdaptivePlannerPortfolio(bool forward_search = true);
+
+    /// Add a configuration to the portfolio. The environment must not share
+    /// mutable state (see AdaptiveDiscreteSpace::sharesMutableState()) with
+    /// the environment of any other configuration and must outlive the
+    /// portfolio.
+    /// \return The index of the new configuration, or -1 if the environment
+    ///     shares mutable state with that of another configuration
+    int addConfiguration(
+        AdaptiveDiscreteSpace *space,
+        const PlannerAllocator &plan_search_alloc,
+        const PlannerAllocator &track_search_alloc);
+
+    int numConfigurations() const { return (int)configs_.size(); }
+
+    AdaptivePlanner *planner(int i) { return configs_[i].planner.get(); }
+    AdaptiveDiscreteSpace *space(int i) { return configs_[i].space; }
+
+    /// Run all configurations concurrently for up to \p allocated_time_secs.
+    /// \return 1 if any configuration found a solution; 0 otherwise
+    int replan(
+        double allocated_time_secs,
+        std::vector<int> *solution,
+        int *solcost);
+
+    /// \return The index of the configuration that produced the solution of
+    ///     the last call to replan(), or -1 if none did
+    int winner() const { return winner_; }
+
+private:
+
+    struct Configuration
+    {
+        AdaptiveDiscreteSpace *space;
+        std::unique_ptr<AdaptivePlanner> planner;
+        std::unique_ptr<InterruptToken> interrupt;
+        std::vector<int> solution;
+        int cost;
+        int ret;
+    };
+
+    bool forward_search_;
+    std::vector<Configuration> configs_;
+    int winner_;
+};
+
+} // namespace adim
+
+#endif
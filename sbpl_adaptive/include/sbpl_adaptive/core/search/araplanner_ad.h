@@ -1,14 +1,20 @@
 #ifndef SBPL_ADAPTIVE_ARAPLANNER_AD_H
 #define SBPL_ADAPTIVE_ARAPLANNER_AD_H
 
+// standard includes
+#include <algorithm>
+#include <vector>
+
 // system includes
 #include <sbpl/headers.h>
 #include <smpl/forward.h>
 #include <smpl/time.h>
 
 // project includes
+#include <sbpl_adaptive/chunked_arena.h>
 #include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
 #include <sbpl_adaptive/core/search/adaptive_planner.h>
+#include <sbpl_adaptive/core/search/open_list.h>
 
 namespace adim {
 
@@ -16,9 +22,80 @@ class ADARAPlannerAllocator : public PlannerAllocator
 {
 public:
 
+    explicit ADARAPlannerAllocator(
+        OpenListType open_list_type = OpenListType::BINARY_HEAP,
+        bool lazy_evaluation = false)
+    :
+        open_list_type_(open_list_type),
+        lazy_evaluation_(lazy_evaluation)
+    { }
+
     SBPLPlanner *make(
         AdaptiveDiscreteSpace *space,
         bool forward_search) const override;
+
+private:
+
+    OpenListType open_list_type_;
+    bool lazy_evaluation_;
+};
+
+/// Search state of ARAPlanner_AD, stored contiguously in the arena of the
+/// search state space
+struct ARAState_AD : public AbstractSearchState
+{
+    int state_id;
+
+    unsigned int g;
+    unsigned int v;
+    int h;
+
+    // heuristic epoch of the search state space at the time h was computed,
+    // or 0 if h was never computed
+    unsigned int heur_epoch;
+
+    short unsigned int iterationclosed;
+    short unsigned int callnumberaccessed;
+
+    ARAState_AD* bestnextstate;
+    unsigned int costtobestnextstate;
+    ARAState_AD* bestpredstate;
+
+    // lazy search only: predecessors whose edges to this state have not been
+    // evaluated and may improve g, and the smallest cost-to-come through them
+    struct LazyPred
+    {
+        ARAState_AD* pred;
+        unsigned int g;
+    };
+    std::vector<LazyPred> lazy_preds;
+    unsigned int lazy_g;
+};
+
+struct ARASearchStateSpace_AD
+{
+    double eps;
+    double eps_satisfied;
+    OpenList* open;
+    CList* inconslist;
+    short unsigned int searchiteration;
+    short unsigned int callnumber;
+    ARAState_AD* searchgoalstate;
+    ARAState_AD* searchstartstate;
+
+    bool bReevaluatefvals;
+    bool bReinitializeSearchStateSpace;
+    bool bNewSearchIteration;
+
+    // incremented whenever cached heuristic values become stale, i.e. when
+    // the goal or the environment's heuristics change
+    unsigned int heur_epoch;
+
+    // all search states, in order of creation
+    ChunkedArena<ARAState_AD> states;
+
+    // map from graph state id to the index of its search state, or -1
+    std::vector<int> state_index;
 };
 
 SBPL_CLASS_FORWARD(ARAPlanner_AD)
@@ -34,13 +111,62 @@ SBPL_CLASS_FORWARD(ARAPlanner_AD)
 ///     path up to a certain state (dictated by the environment via a call to
 ///     getBestSeenState()). The call to replan(...) will return false, but the
 ///     output vector will contain the partial solution.
+///
+/// The OPEN list may be any OpenList implementation; a bucket queue is usually
+/// fastest since the keys of the search are integer f-values.
+///
+/// In lazy mode (forward search only), successors are generated via
+/// AdaptiveDiscreteSpace::GetLazySuccs and edges without exact costs are
+/// evaluated via AdaptiveDiscreteSpace::EvaluateEdge only once their target
+/// state is selected for expansion, as in Lazy Weighted A*. The g-value and
+/// best predecessor of a state always refer to evaluated edges; unevaluated
+/// edges only lower its priority in OPEN until they are evaluated.
+///
+/// In bidirectional mode (forward search only), a second search grows backward
+/// from the goal via GetPreds and the start heuristic, and each iteration
+/// expands the frontier with the smaller OPEN list. The search stops once the
+/// cheapest path found through a state reached by both searches costs no more
+/// than the larger of the two smallest keys in OPEN. States are reopened when
+/// their g-value improves, so this path is within the initial epsilon of the
+/// optimal cost. Each call to replan() runs a single search with the initial
+/// epsilon. Only forward expansions are reported to the environment via
+/// expandingState(int), so partial paths can still be reconstructed up to the
+/// state returned by getBestSeenState(), if the forward search reached it.
+/// If the goal has no predecessors, as is the case for the abstract goal of a
+/// MultiRepAdaptiveDiscreteSpace or for environments that do not implement
+/// GetPreds, replan() runs the unidirectional search instead.
+///
+/// If the environment allows it (see
+/// AdaptiveDiscreteSpace::heuristicsCacheable()), the heuristic value of a
+/// search state is cached across calls to replan() and only recomputed once
+/// the goal changes or the environment invalidates its heuristics. Otherwise,
+/// it is recomputed whenever the state is reinitialized.
+///
+/// Search states are allocated from a chunked arena owned by the planner and
+/// indexed by graph state id, rather than through SBPL's MDP state wrappers.
+/// All search states are released at once when the planner is destroyed or
+/// via force_planning_from_scratch_and_free_memory().
 class ARAPlanner_AD : public SBPLPlanner
 {
 public:
 
     ARAPlanner_AD(
         AdaptiveDiscreteSpace* environment,
-        bool bforwardsearch);
+        bool bforwardsearch,
+        OpenListType open_list_type = OpenListType::BINARY_HEAP);
+
+    /// \brief enable or disable lazy edge evaluation; forces the next search
+    /// to start from scratch
+    void set_lazy_evaluation(bool lazy);
+    bool lazy_evaluation() const { return blazy; }
+
+    /// \brief returns the number of edges evaluated lazily by the last search
+    int get_n_edge_evaluations() const { return num_edge_evaluations; }
+
+    /// \brief enable or disable bidirectional search; disables lazy
+    /// evaluation
+    void set_bidirectional(bool bidirectional);
+    bool bidirectional() const { return bbidirectional; }
 
     ~ARAPlanner_AD();
 
@@ -60,6 +186,7 @@ public:
     int set_goal(int goal_stateID);
     int set_start(int start_stateID);
     int force_planning_from_scratch();
+    int force_planning_from_scratch_and_free_memory();
     int set_search_mode(bool bSearchUntilFirstSolution);
     void costs_changed(StateChangeQuery const & stateChange);
     ///@}
@@ -80,6 +207,8 @@ private:
 
     AdaptiveDiscreteSpace* environment_;
 
+    OpenListType open_list_type_;
+
     double finitial_eps;
     double finitial_eps_planning_time;
     double final_eps;
@@ -95,105 +224,156 @@ private:
     // modes)
     bool bsearchuntilfirstsolution;
 
-    ARASearchStateSpace_t* pSearchStateSpace_;
+    // if true, then edges are evaluated when their target is expanded
+    bool blazy;
+    int num_edge_evaluations;
+
+    // if true, then a backward search grows from the goal concurrently with
+    // the forward search
+    bool bbidirectional;
+
+    ARASearchStateSpace_AD* pSearchStateSpace_;
+
+    // backward search state space used by bidirectional search, or NULL
+    ARASearchStateSpace_AD* pBackwardSearchStateSpace_;
+
+    // heuristic epoch of the environment at the start of the last search
+    unsigned int env_heur_epoch;
+
+    // reused by every expansion
+    SuccessorBuffer succs_;
 
     int MaxMemoryCounter;
     sbpl::clock::time_point TimeStarted;
 
-    void Initialize_searchinfo(
-        CMDPSTATE* state,
-        ARASearchStateSpace_t* pSearchStateSpace);
+    int ComputeKey(ARAState_AD* state, ARASearchStateSpace_AD* pSearchStateSpace) const
+    {
+        return std::min(state->g, state->lazy_g) + (int)(pSearchStateSpace->eps * state->h);
+    }
 
-    CMDPSTATE* CreateState(
+    ARAState_AD* CreateState(
         int stateID,
-        ARASearchStateSpace_t* pSearchStateSpace);
+        ARASearchStateSpace_AD* pSearchStateSpace);
+
+    ARAState_AD* GetState(int stateID, ARASearchStateSpace_AD* pSearchStateSpace);
 
-    CMDPSTATE* GetState(int stateID, ARASearchStateSpace_t* pSearchStateSpace);
+    // returns the search state if it was reached by the current search, or
+    // NULL otherwise, without creating it
+    ARAState_AD* FindState(int stateID, ARASearchStateSpace_AD* pSearchStateSpace);
 
     int ComputeHeuristic(
-        CMDPSTATE* MDPstate,
-        ARASearchStateSpace_t* pSearchStateSpace);
+        ARAState_AD* state,
+        ARASearchStateSpace_AD* pSearchStateSpace);
 
     // initialization of a state
     void InitializeSearchStateInfo(
-        ARAState* state,
-        ARASearchStateSpace_t* pSearchStateSpace);
+        ARAState_AD* state,
+        ARASearchStateSpace_AD* pSearchStateSpace);
 
     // re-initialization of a state
     void ReInitializeSearchStateInfo(
-        ARAState* state,
-        ARASearchStateSpace_t* pSearchStateSpace);
+        ARAState_AD* state,
+        ARASearchStateSpace_AD* pSearchStateSpace);
 
-    void DeleteSearchStateData(ARAState* state);
+    // compute the heuristic of a state unless it is cached for the current
+    // heuristic epoch
+    void UpdateHeuristic(
+        ARAState_AD* state,
+        ARASearchStateSpace_AD* pSearchStateSpace);
+
+    // invalidate all cached heuristic values, and recompute those of the
+    // states used by the current search
+    void InvalidateHeuristics(ARASearchStateSpace_AD* pSearchStateSpace);
+
+    // invalidate the cached heuristic values if the environment's heuristics
+    // changed since the last search
+    void CheckHeuristicEpoch();
 
     // used for backward search
-    void UpdatePreds(ARAState* state, ARASearchStateSpace_t* pSearchStateSpace);
+    void UpdatePreds(ARAState_AD* state, ARASearchStateSpace_AD* pSearchStateSpace);
 
     // used for forward search
-    void UpdateSuccs(ARAState* state, ARASearchStateSpace_t* pSearchStateSpace);
+    void UpdateSuccs(ARAState_AD* state, ARASearchStateSpace_AD* pSearchStateSpace);
+
+    // lazy search only: evaluate the pending edges of a state popped from OPEN
+    // until its g-value is exact; returns false if it was returned to OPEN or
+    // is unreachable instead
+    bool EvaluateLazyPreds(ARAState_AD* state, ARASearchStateSpace_AD* pSearchStateSpace);
+
+    int GetGVal(int StateID, ARASearchStateSpace_AD* pSearchStateSpace);
 
-    int GetGVal(int StateID, ARASearchStateSpace_t* pSearchStateSpace);
+    // returns true if any of the given states was expanded by the current search
+    bool IsSearchAffected(
+        const std::vector<int>& changed_state_ids,
+        ARASearchStateSpace_AD* pSearchStateSpace);
 
     // returns 1 if the solution is found, 0 if the solution does not exist and
     // 2 if it ran out of time
     int ImprovePath(
-        ARASearchStateSpace_t* pSearchStateSpace,
+        ARASearchStateSpace_AD* pSearchStateSpace,
         double MaxNumofSecs);
 
-    void BuildNewOPENList(ARASearchStateSpace_t* pSearchStateSpace);
+    void BuildNewOPENList(ARASearchStateSpace_AD* pSearchStateSpace);
 
-    void Reevaluatefvals(ARASearchStateSpace_t* pSearchStateSpace);
+    void Reevaluatefvals(ARASearchStateSpace_AD* pSearchStateSpace);
 
     // creates (allocates memory) search state space
     // does not initialize search statespace
-    int CreateSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpace);
+    int CreateSearchStateSpace(ARASearchStateSpace_AD* pSearchStateSpace);
 
     // deallocates memory used by SearchStateSpace
-    void DeleteSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpace);
+    void DeleteSearchStateSpace(ARASearchStateSpace_AD* pSearchStateSpace);
 
     // debugging
-    void PrintSearchState(ARAState* state, FILE* fOut);
+    void PrintSearchState(ARAState_AD* state, FILE* fOut);
 
     // reset properly search state space
     // needs to be done before deleting states
-    int ResetSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpace);
+    int ResetSearchStateSpace(ARASearchStateSpace_AD* pSearchStateSpace);
 
     // initialization before each search
-    void ReInitializeSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpace);
+    void ReInitializeSearchStateSpace(ARASearchStateSpace_AD* pSearchStateSpace);
 
     // very first initialization
-    int InitializeSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpace);
+    int InitializeSearchStateSpace(ARASearchStateSpace_AD* pSearchStateSpace);
 
     int SetSearchGoalState(
         int SearchGoalStateID,
-        ARASearchStateSpace_t* pSearchStateSpace);
+        ARASearchStateSpace_AD* pSearchStateSpace);
 
     int SetSearchStartState(
         int SearchStartStateID,
-        ARASearchStateSpace_t* pSearchStateSpace);
+        ARASearchStateSpace_AD* pSearchStateSpace);
 
     // reconstruct path functions are only relevant for forward search
     int ReconstructPath(
-        ARASearchStateSpace_t* pSearchStateSpace,
-        CMDPSTATE* beststate = NULL);
+        ARASearchStateSpace_AD* pSearchStateSpace,
+        ARAState_AD* beststate = NULL);
 
-    void PrintSearchPath(ARASearchStateSpace_t* pSearchStateSpace, FILE* fOut);
+    void PrintSearchPath(ARASearchStateSpace_AD* pSearchStateSpace, FILE* fOut);
 
-    int getHeurValue(ARASearchStateSpace_t* pSearchStateSpace, int StateID);
+    int getHeurValue(ARASearchStateSpace_AD* pSearchStateSpace, int StateID);
 
     // get path
     std::vector<int> GetSearchPath(
-        ARASearchStateSpace_t* pSearchStateSpace,
+        ARASearchStateSpace_AD* pSearchStateSpace,
         int& solcost,
-        CMDPSTATE* beststate = NULL);
+        ARAState_AD* beststate = NULL);
 
     bool Search(
-        ARASearchStateSpace_t* pSearchStateSpace,
+        ARASearchStateSpace_AD* pSearchStateSpace,
         std::vector<int>& pathIds,
         int & PathCost,
         bool bFirstSolution,
         bool bOptimalSolution,
         double MaxNumofSecs);
+
+    bool CanSearchBackward();
+
+    bool SearchBidirectional(
+        std::vector<int>& pathIds,
+        int& PathCost,
+        double MaxNumofSecs);
 };
 
 } // namespace adim
@@ -0,0 +1,225 @@
+#ifndef SBPL_ADAPTIVE_OPEN_LIST_H
+#define SBPL_ADAPTIVE_OPEN_LIST_H
+
+// standard includes
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+// system includes
+#include <sbpl/headers.h>
+
+namespace adim {
+
+enum class OpenListType
+{
+    BINARY_HEAP,
+    BUCKET_QUEUE,
+    QUATERNARY_HEAP
+};
+
+const char *to_string(OpenListType type);
+
+/// A priority queue of search states ordered by integer keys (f-values).
+///
+/// Keys are long integers, as with SBPL's CKey, so that inflated keys, e.g.
+/// the f-values of an MHA* search with large heuristics and suboptimality
+/// bounds, do not overflow. As with SBPL's CHeap, membership is tracked through the heapindex field of
+/// AbstractSearchState: it is 0 iff the state is not in the list, and it must
+/// not be modified by the caller while the state is in the list. Ties between
+/// states with equal keys are broken arbitrarily.
+class OpenList
+{
+public:
+
+    typedef long Key;
+    typedef std::function<Key(AbstractSearchState *)> KeyFn;
+
+    virtual ~OpenList() { }
+
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+
+    /// \return The smallest key in the list, or INFINITECOST if it is empty
+    virtual Key minKey() = 0;
+
+    /// Insert a state that is not in the list
+    virtual void insert(AbstractSearchState *state, Key key) = 0;
+
+    /// Change the key of a state in the list, in either direction
+    virtual void update(AbstractSearchState *state, Key key) = 0;
+
+    /// \return A state with the smallest key, or NULL if the list is empty
+    virtual AbstractSearchState *min() = 0;
+
+    /// Remove and return a state with the smallest key, or NULL if the list
+    /// is empty
+    virtual AbstractSearchState *deleteMin() = 0;
+
+    /// Remove a state that is in the list
+    virtual void erase(AbstractSearchState *state) = 0;
+
+    /// Remove all states from the list
+    virtual void clear() = 0;
+
+    /// Recompute the keys of all states in the list, e.g. after the
+    /// inflation factor changed, and restore the ordering
+    virtual void rekey(const KeyFn &key) = 0;
+
+    void insertOrUpdate(AbstractSearchState *state, Key key)
+    {
+        if (state->heapindex != 0) {
+            update(state, key);
+        } else {
+            insert(state, key);
+        }
+    }
+};
+
+/// Construct an open list of the given type
+OpenList *MakeOpenList(OpenListType type);
+
+/// Binary heap; a thin adapter around SBPL's CHeap
+class BinaryHeapOpenList : public OpenList
+{
+public:
+
+    bool empty() const override { return heap_.currentsize == 0; }
+    size_t size() const override { return heap_.currentsize; }
+    Key minKey() override;
+    void insert(AbstractSearchState *state, Key key) override;
+    void update(AbstractSearchState *state, Key key) override;
+    AbstractSearchState *min() override;
+    AbstractSearchState *deleteMin() override;
+    void erase(AbstractSearchState *state) override;
+    void clear() override;
+    void rekey(const KeyFn &key) override;
+
+private:
+
+    CHeap heap_;
+};
+
+/// Bucket queue with one bucket per integer key.
+///
+/// Buckets cover a window of at most max_span keys starting at the smallest
+/// key seen since the queue was last emptied. The buckets are stored in a
+/// ring, so that the window is extended towards smaller keys without moving
+/// the other buckets. Keys that fall beyond the window are kept in an
+/// unordered overflow list that is redistributed over a new window once all
+/// buckets are empty. Insertions, updates, and removals are O(1); finding the
+/// minimum is amortized O(1) when keys are (nearly) monotone, as is the case
+/// for the f-values of a weighted A* search.
+class BucketOpenList : public OpenList
+{
+public:
+
+    /// \param max_span The maximum number of buckets in the window
+    explicit BucketOpenList(int max_span = 1 << 16);
+
+    bool empty() const override { return size_ == 0; }
+    size_t size() const override { return size_; }
+    Key minKey() override;
+    void insert(AbstractSearchState *state, Key key) override;
+    void update(AbstractSearchState *state, Key key) override;
+    AbstractSearchState *min() override;
+    AbstractSearchState *deleteMin() override;
+    void erase(AbstractSearchState *state) override;
+    void clear() override;
+    void rekey(const KeyFn &key) override;
+
+private:
+
+    struct Node
+    {
+        AbstractSearchState *state;
+        Key key;
+        int prev;
+        int next;
+        bool overflow;
+    };
+
+    std::vector<Node> nodes_;
+    int free_;
+
+    // ring of bucket heads, whose size is a power of two; buckets outside the
+    // window are always empty
+    std::vector<int> buckets_;
+    size_t start_;  // ring index of the bucket of base_
+    size_t span_;   // number of buckets in the window
+    Key base_;
+    size_t cursor_; // offset of the first bucket that may be non-empty
+    size_t max_span_;
+    int overflow_;
+    size_t size_;
+
+    int &bucket(size_t offset) {
+        return buckets_[(start_ + offset) & (buckets_.size() - 1)];
+    }
+
+    int &head(const Node &n) {
+        return n.overflow ? overflow_ : bucket((size_t)(n.key - base_));
+    }
+
+    void reset(Key base);
+    void reserve(size_t span);
+    void rebase(Key base);
+    void place(int n);
+    void release(int n);
+    void link(int n);
+    void unlink(int n);
+    bool refill();
+};
+
+/// 4-ary heap laid out so that the four children of every node share a
+/// 64-byte cache line. Compared to a binary heap it halves the depth of the
+/// tree and the number of cache misses per sift-down.
+class QuaternaryHeapOpenList : public OpenList
+{
+public:
+
+    QuaternaryHeapOpenList();
+    ~QuaternaryHeapOpenList();
+
+    QuaternaryHeapOpenList(const QuaternaryHeapOpenList &) = delete;
+    QuaternaryHeapOpenList &operator=(const QuaternaryHeapOpenList &) = delete;
+
+    bool empty() const override { return size_ == 0; }
+    size_t size() const override { return size_; }
+    Key minKey() override;
+    void insert(AbstractSearchState *state, Key key) override;
+    void update(AbstractSearchState *state, Key key) override;
+    AbstractSearchState *min() override;
+    AbstractSearchState *deleteMin() override;
+    void erase(AbstractSearchState *state) override;
+    void clear() override;
+    void rekey(const KeyFn &key) override;
+
+private:
+
+    struct Node
+    {
+        AbstractSearchState *state;
+        Key key;
+    };
+
+    // the root is stored at offset 3 so that child groups begin on cache line
+    // boundaries
+    static const size_t OFFSET = 3;
+
+    void *raw_;
+    Node *data_;
+    size_t capacity_;
+    size_t size_;
+
+    Node &at(size_t i) { return data_[i + OFFSET]; }
+
+    void grow();
+    void set(size_t i, const Node &n);
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+};
+
+} // namespace adim
+
+#endif
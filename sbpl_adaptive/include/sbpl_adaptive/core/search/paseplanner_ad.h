@@ -0,0 +1,245 @@
+#ifndef SBPL_ADAPTIVE_PASEPLANNER_AD_H
+#define SBPL_ADAPTIVE_PASEPLANNER_AD_H
+
+// standard includes
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <vector>
+
+// system includes
+#include <sbpl/headers.h>
+#include <smpl/forward.h>
+#include <smpl/time.h>
+
+// project includes
+#include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/search/adaptive_planner.h>
+#include <sbpl_adaptive/thread_pool.h>
+
+namespace adim {
+
+class ADPASEPlannerAllocator : public PlannerAllocator
+{
+public:
+
+    /// \param num_threads The number of threads expanding states; defaults to
+    ///     the number of hardware threads
+    explicit ADPASEPlannerAllocator(
+        int num_threads = 0,
+        Heuristic *heuristic = nullptr);
+
+    SBPLPlanner *make(
+        AdaptiveDiscreteSpace *space,
+        bool forward_search) const override;
+
+private:
+
+    int num_threads_;
+    Heuristic *heuristic_;
+};
+
+struct PASEState
+{
+    int state_id;       // corresponding graph state
+
+    unsigned int g;     // cost-to-come
+    unsigned int h;     // estimated cost-to-go
+    unsigned int f;     // (g + eps * h) at time of insertion into OPEN
+
+    unsigned int call_number;
+
+    enum Status { NEW, OPEN, BEING_EXPANDED, CLOSED } status;
+
+    PASEState *bestpredstate;
+};
+
+SBPL_CLASS_FORWARD(PASEPlanner_AD)
+
+/// An implementation of Parallel A* for Slow Expansions (PA*SE) for the
+/// adaptive dimensionality framework.
+///
+/// Several threads expand states concurrently. A state s is only selected for
+/// expansion if its cost-to-come can no longer be reduced by the expansion of
+/// any state currently being expanded, or of any state ahead of it in OPEN,
+/// i.e. if
+///
+///     g(s) <= g(s') + w * h(s', s)
+///
+/// for all such states s', where h(s', s) is the pairwise heuristic provided
+/// by the heuristic (or the environment's GetFromToHeuristic) and w is the
+/// independence factor. States selected this way are never re-expanded, and
+/// the cost of the solution is within eps * w of the optimal cost when the
+/// pairwise heuristic is consistent.
+///
+/// The bookkeeping of the search is done under a single lock, while the
+/// successors of selected states, which dominate the cost of expansions in
+/// high-dimensional representations, and all heuristics, including those
+/// needed to select states, are computed outside of it. They are computed
+/// concurrently if the environment supports it (see
+/// AdaptiveDiscreteSpace::supportsConcurrentExpansions()) and no separate
+/// heuristic is given; otherwise, one thread at a time computes them, and only
+/// the bookkeeping overlaps.
+///
+/// Only forward search is supported. Each call to replan() runs a single
+/// search with the initial epsilon; the solution is not improved further.
+class PASEPlanner_AD : public SBPLPlanner
+{
+public:
+
+    PASEPlanner_AD(
+        AdaptiveDiscreteSpace *space,
+        Heuristic *heuristic,
+        bool bForwardSearch,
+        int num_threads = 0);
+
+    ~PASEPlanner_AD();
+
+    void set_independence_eps(double eps) { m_indep_eps = eps; }
+    double get_independence_eps() const { return m_indep_eps; }
+
+    /// Set the maximum number of states at the front of OPEN considered for
+    /// expansion by an idle thread. Limits the quadratic cost of checking the
+    /// independence of states ahead in OPEN.
+    void set_max_candidates(int count) { m_max_candidates = count; }
+    int get_max_candidates() const { return m_max_candidates; }
+
+    int num_threads() const { return m_pool->numWorkers(); }
+
+    /// \name Required Functions from SBPLPlanner
+    ///@{
+    int replan(double allowed_time_secs, std::vector<int> *solution) override;
+    int replan(double allowed_time_secs, std::vector<int> *solution, int *solcost) override;
+    int set_goal(int state_id) override;
+    int set_start(int state_id) override;
+    int force_planning_from_scratch() override;
+    int set_search_mode(bool bSearchUntilFirstSolution) override;
+    void costs_changed(const StateChangeQuery &stateChange) override;
+    ///@}
+
+    /// \name Reimplemented Functions from SBPLPlanner
+    ///@{
+    int replan(std::vector<int> *solution, ReplanParams params) override;
+    int replan(std::vector<int> *solution, ReplanParams params, int *solcost) override;
+    int force_planning_from_scratch_and_free_memory() override;
+    double get_solution_eps() const override { return m_satisfied_eps; }
+    int get_n_expands() const override { return m_expand_count; }
+    double get_initial_eps() override { return m_initial_eps; }
+    double get_initial_eps_planning_time() override { return sbpl::to_seconds(m_search_time); }
+    double get_final_eps_planning_time() override { return sbpl::to_seconds(m_search_time); }
+    int get_n_expands_init_solution() override { return m_expand_count; }
+    double get_final_epsilon() override { return m_initial_eps; }
+    void get_search_stats(std::vector<PlannerStats> *s) override;
+    void set_initialsolution_eps(double initialsolution_eps) override { m_initial_eps = initialsolution_eps; }
+    ///@}
+
+private:
+
+    struct OpenCompare
+    {
+        bool operator()(const PASEState *a, const PASEState *b) const
+        {
+            return a->f < b->f || (a->f == b->f && a->state_id < b->state_id);
+        }
+    };
+
+    enum SearchStatus { SEARCHING, FOUND, TIMED_OUT, EXHAUSTED };
+
+    // a state and its cost-to-come when it was considered for selection
+    struct Candidate
+    {
+        PASEState *state;
+        unsigned int g;
+    };
+
+    struct CandidateLess
+    {
+        bool operator()(const Candidate &a, const Candidate &b) const
+        {
+            return a.state < b.state;
+        }
+    };
+
+    // per-thread storage for the selection of states
+    struct SelectionBuffer
+    {
+        std::vector<Candidate> open;
+        std::vector<Candidate> expanding;
+        std::vector<Candidate> checked;
+    };
+
+    AdaptiveDiscreteSpace *m_space;
+    Heuristic *m_heur;
+    bool bforwardsearch;
+
+    ThreadPoolPtr m_pool;
+
+    double m_initial_eps;
+    double m_indep_eps;
+    double m_satisfied_eps;
+    int m_max_candidates;
+
+    bool m_bounded;
+    sbpl::clock::duration m_allowed_time;
+
+    int m_start_state_id;
+    int m_goal_state_id;
+
+    std::vector<PASEState *> m_states;
+    std::vector<int> m_graph_to_search_map;
+    unsigned int m_call_number;
+
+    /// \name Shared Search State
+    ///
+    /// Guarded by m_mutex while the search is running.
+    ///@{
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::set<PASEState *, OpenCompare> m_open;
+    std::vector<PASEState *> m_being_expanded;
+    SearchStatus m_status;
+    sbpl::clock::time_point m_start_time;
+    int m_expand_count;
+
+    // incremented whenever OPEN or the set of states being expanded changes
+    unsigned int m_version;
+    ///@}
+
+    // serializes successor generation and heuristic evaluation in
+    // environments that are not thread safe
+    std::mutex m_expand_mutex;
+    bool m_concurrent;
+
+    sbpl::clock::duration m_search_time;
+    int m_solution_cost;
+
+    void searchLoop(int worker);
+
+    PASEState *selectState(
+        std::unique_lock<std::mutex> &lock,
+        SelectionBuffer &buf);
+    bool isIndependent(
+        const Candidate &s,
+        std::vector<Candidate>::const_iterator first,
+        std::vector<Candidate>::const_iterator last) const;
+    void updateSuccessors(
+        PASEState *s,
+        const SuccessorBuffer &succs,
+        const std::vector<unsigned int> &succ_h);
+    void removeBeingExpanded(PASEState *s);
+    bool timedOut() const;
+
+    unsigned int computeKey(const PASEState *s) const;
+    unsigned int computeHeuristic(int state_id) const;
+    int computePairwiseHeuristic(int from_id, int to_id) const;
+
+    PASEState *getSearchState(int state_id);
+    void reinitSearchState(PASEState *state);
+    void reinitSearchState(PASEState *state, unsigned int h);
+
+    void extractPath(PASEState *to_state, std::vector<int> &solution, int &cost) const;
+};
+
+} // namespace adim
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef SBPL_ADAPTIVE_PLANNER_TRACE_H
+#define SBPL_ADAPTIVE_PLANNER_TRACE_H
+
+// standard includes
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// system includes
+#include <smpl/forward.h>
+#include <smpl/time.h>
+
+namespace adim {
+
+/// A single entry in a PlannerTrace. The meaning of \p value and \p real
+/// depends on the event type.
+struct TraceEvent
+{
+    enum Type : uint16_t
+    {
+        QUERY_START = 0,    // value: start state id, real: goal state id
+        QUERY_END,          // value: 1 on success, real: query time (s)
+        ITERATION_START,    // value: number of pending spheres
+        PHASE_START,        //
+        PHASE_END,          // value: 1 on success, real: phase time (s)
+        SEARCH,             // value: expansions, real: search time (s)
+        SPHERE_INSERTED,    // value: state id
+        COST_RATIO,         // value: tracking cost, real: tracking / planning cost
+        PARTIAL_PATH,       // value: path length, real: state id of the last state
+        NUM_TYPES
+    };
+
+    enum Phase : uint16_t { PLANNING = 0, TRACKING, NONE };
+
+    int64_t time_ns;    // time since the trace epoch
+    uint16_t type;
+    uint16_t phase;
+    int32_t iteration;
+    int64_t value;
+    double real;
+};
+
+const char *to_string(TraceEvent::Type type);
+const char *to_string(TraceEvent::Phase phase);
+
+SBPL_CLASS_FORWARD(PlannerTrace)
+
+/// A fixed-capacity ring buffer of typed planner events. Recording is
+/// lock-free and may be done concurrently from any number of threads; when the
+/// buffer is full, the oldest events are overwritten. Recording into a disabled
+/// trace costs a single relaxed atomic load.
+///
+/// Events should be read (see events(), dumpJSON(), and dumpBinary()) while no
+/// thread is recording, e.g. after each query. Events still being written when
+/// read are skipped.
+class PlannerTrace
+{
+public:
+
+    explicit PlannerTrace(size_t capacity = 1 << 16);
+
+    void enable(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return capacity_; }
+
+    void record(
+        TraceEvent::Type type,
+        TraceEvent::Phase phase,
+        int iteration,
+        int64_t value = 0,
+        double real = 0.0)
+    {
+        if (enabled()) {
+            push(type, phase, iteration, value, real);
+        }
+    }
+
+    /// Return the number of events recorded since the last call to clear(),
+    /// including those that have been overwritten
+    uint64_t numRecorded() const { return head_.load(std::memory_order_acquire); }
+
+    /// Return the retained events, oldest first
+    std::vector<TraceEvent> events() const;
+
+    /// Discard all events and restart the epoch of the trace
+    void clear();
+
+    /// Write the retained events as a JSON document
+    bool dumpJSON(const std::string &path) const;
+
+    /// Write the retained events in a compact binary format: the magic bytes
+    /// "ADTR", a uint32 version, a uint64 event count, and the raw events
+    bool dumpBinary(const std::string &path) const;
+
+private:
+
+    struct Slot
+    {
+        std::atomic<uint64_t> seq; // 1 + index of the event stored here
+        TraceEvent event;
+    };
+
+    std::atomic<bool> enabled_;
+    size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> head_;
+    sbpl::clock::time_point epoch_;
+
+    void push(
+        TraceEvent::Type type,
+        TraceEvent::Phase phase,
+        int iteration,
+        int64_t value,
+        double real);
+};
+
+} // namespace adim
+
+#endif
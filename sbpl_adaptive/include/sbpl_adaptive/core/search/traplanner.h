@@ -4,23 +4,22 @@
 // standard includes
 #include <assert.h>
 #include <stdio.h>
-#include <time.h>
+#include <algorithm>
 #include <vector>
-#include <algorithm> 
 
 // system includes
-#include <sbpl/heuristics/heuristic.h>
-#include <sbpl/planners/planner.h>
+#include <sbpl/headers.h>
+#include <smpl/forward.h>
 #include <smpl/intrusive_heap.h>
 #include <smpl/time.h>
-#include <smpl/search/arastar.h>
-#include <smpl/ros/planner_allocator.h>
 
 // project includes
-#include <sbpl_adaptive/common.h>
+#include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/graph/adaptive_state_change_query.h>
 #include <sbpl_adaptive/core/search/adaptive_planner.h>
 
-namespace sbpl {
+namespace adim {
+
 // control of EPS
 
 // initial suboptimality bound (cost solution <= cost(eps*cost optimal solution)
@@ -30,65 +29,96 @@ namespace sbpl {
 // final epsilon bound
 #define TRA_FINAL_EPS               1.0
 
-#define TRA_INCONS_LIST_ID 0
-#define TRAMDP_STATEID2IND ARAMDP_STATEID2IND
+class ADTRAPlannerAllocator : public PlannerAllocator
+{
+public:
+
+    ADTRAPlannerAllocator(Heuristic *heuristic = nullptr);
+
+    SBPLPlanner *make(
+        AdaptiveDiscreteSpace *space,
+        bool forward_search) const override;
+
+private:
 
-struct TRAState : public heap_element
+    Heuristic *heuristic_;
+};
+
+struct TRAState : public sbpl::heap_element
 {
     int state_id;       // corresponding graph state
 
-    /// \brief TRA* relevant data
-    unsigned int E; // expansion time
-    unsigned int C; // creation time -- first put on open list
-    std::vector<TRAState*> parent_hist; // history of parents
+    /// \name TRA* relevant data
+    ///@{
+    unsigned int C; // creation step -- first put on open list
+    unsigned int E; // expansion step -- first expanded
 
-    // history of g-values associated with each of the parents in parent_hist
+    // history of updates to the cost-to-come of this state: the parent, the
+    // g-value, and the expansion step of each update, in increasing step order
+    std::vector<TRAState*> parent_hist;
     std::vector<unsigned int> gval_hist;
+    std::vector<unsigned int> step_hist;
+    ///@}
 
-    unsigned int v;
     unsigned int g;     // cost-to-come
     unsigned int h;     // estimated cost-to-go
     unsigned int f;     // (g + eps * h) at time of insertion into OPEN
     unsigned int eg;    // g-value at time of expansion
-            
+
     short unsigned int iteration_closed;
     short unsigned int call_number;
-    short unsigned int numofexpands;
 
     /// \brief best predecessor and the action from it, used only in forward searches
     TRAState *bestpredstate;
 
-    /// \brief the next state if executing best action
-    TRAState  *bestnextstate;
-    unsigned int costtobestnextstate;
     bool incons;
 
-    TRAState() {};
-    ~TRAState() {};
-
-    int getSize()
+    int getSize() const
     {
         return (int) (
                 sizeof(TRAState) +
                 sizeof(TRAState*) * parent_hist.size() +    // parent_hist
-                sizeof(unsigned int) * gval_hist.size() );  // gval_hist
+                sizeof(unsigned int) * gval_hist.size() +   // gval_hist
+                sizeof(unsigned int) * step_hist.size());   // step_hist
     }
 };
 
 struct SearchStateCompare
-    {
-        bool operator()(const TRAState& s1, const TRAState& s2) const {
-            return s1.f < s2.f;
-        }
-    };
-
+{
+    bool operator()(const TRAState& s1, const TRAState& s2) const {
+        return s1.f < s2.f;
+    }
+};
 
+SBPL_CLASS_FORWARD(TRAPlanner)
+
+/// An implementation of Tree-Restoring Weighted A* for the adaptive
+/// dimensionality framework. In addition to the usual search data, every
+/// search state records the step at which it was created and expanded, and
+/// the history of its parents. This allows the search tree to be restored to
+/// the state it was in before any given expansion step without re-expanding
+/// the states expanded prior to that step.
+///
+/// Between iterations of the adaptive planner, the environment reports the
+/// earliest expansion step affected by the introduction of new spheres (see
+/// AdaptiveDiscreteSpace::addSphere(int, int&)). Restoring the search tree to
+/// that step (see restoreSearchTree()) keeps all work upstream of the change
+/// and only repeats the expansions downstream of it. Successors are generated
+/// via AdaptiveDiscreteSpace::GetSuccs(int, int, ...) so that the environment
+/// may record the expansion step of each state.
+///
+/// Changes to edge costs (see costs_changed()) are handled the same way: the
+/// search tree is restored to the earliest expansion of a state whose outgoing
+/// edges changed, or to the expansion step reported via an
+/// AdaptiveStateChangeQuery, whichever comes first.
+///
+/// Only forward search is supported. The search tree may be restored to any
+/// step of the first search iteration; steps of subsequent (improvement)
+/// iterations are restored to the end of the first iteration.
 class TRAPlanner : public SBPLPlanner
 {
-
 public:
 
-
     // parameters for controlling how long the search runs
     struct TimeParameters
     {
@@ -97,12 +127,14 @@ public:
         enum TimingType { EXPANSIONS, TIME } type;
         int max_expansions_init;
         int max_expansions;
-        clock::duration max_allowed_time_init;
-        clock::duration max_allowed_time;
+        sbpl::clock::duration max_allowed_time_init;
+        sbpl::clock::duration max_allowed_time;
     };
 
-
-    TRAPlanner(DiscreteSpaceInformation* space, Heuristic* heuristic, bool bForwardSearch);
+    TRAPlanner(
+        AdaptiveDiscreteSpace* space,
+        Heuristic* heuristic,
+        bool bForwardSearch);
 
     ~TRAPlanner();
 
@@ -110,14 +142,22 @@ public:
     bool allowPartialSolutions() const { return m_allow_partial_solutions; }
 
     void setAllowedRepairTime(double allowed_time_secs)
-    { m_time_params.max_allowed_time = to_duration(allowed_time_secs); }
+    { m_time_params.max_allowed_time = sbpl::to_duration(allowed_time_secs); }
 
     double allowedRepairTime() const
-    { return to_seconds(m_time_params.max_allowed_time); }
+    { return sbpl::to_seconds(m_time_params.max_allowed_time); }
+
+    /// \brief restore the search tree to its state before the expansion at
+    /// step \p expansion_step. A negative step leaves the search untouched.
+    void restoreSearchTree(int expansion_step);
+
+    /// \brief the step of the next expansion
+    int expansionStep() const { return (int)m_expansion_step; }
 
     void costs_changed();
-    
-    int replan( const TimeParameters &params, std::vector<int>* solution, int* cost);
+
+    int replan(const TimeParameters &params, std::vector<int>* solution, int* cost);
+
     /// \name Required Functions from SBPLPlanner
     ///@{
     int replan(double allowed_time_secs, std::vector<int>* solution) override;
@@ -134,35 +174,20 @@ public:
     int replan(std::vector<int>* solution, ReplanParams params) override;
     int replan(std::vector<int>* solution, ReplanParams params, int* solcost) override;
     int force_planning_from_scratch_and_free_memory() override;
-    double get_solution_eps() const { return m_satisfied_eps; }
-    int get_n_expands() const  { return m_expand_count; }
-    double get_initial_eps() {return m_initial_eps;}
-    double get_initial_eps_planning_time() {  return to_seconds(m_search_time_init); }
-    double get_final_eps_planning_time() { return to_seconds(m_search_time); }
-    int get_n_expands_init_solution() {  return m_expand_count_init; }
-    double get_final_epsilon() { return m_final_eps;}
+    double get_solution_eps() const override { return m_satisfied_eps; }
+    int get_n_expands() const override { return m_expand_count; }
+    double get_initial_eps() override { return m_initial_eps; }
+    double get_initial_eps_planning_time() override { return sbpl::to_seconds(m_search_time_init); }
+    double get_final_eps_planning_time() override { return sbpl::to_seconds(m_search_time); }
+    int get_n_expands_init_solution() override { return m_expand_count_init; }
+    double get_final_epsilon() override { return m_final_eps; }
     void get_search_stats(std::vector<PlannerStats>* s) override;
-    void set_initialsolution_eps(double initialsolution_eps) {m_initial_eps = initialsolution_eps;}
+    void set_initialsolution_eps(double initialsolution_eps) override { m_initial_eps = initialsolution_eps; }
     ///@}
 
-  
-    /// \brief direct form of informing the search about the new edge costs
-    /// \param succsIDV array of successors of changed edges
-    /// \note this is used when the search is run forwards
-    void update_succs_of_changededges(std::vector<int>* succsIDV);
-
-
-    //TODO: implement!!!!!!!!!!!
-    /// \brief direct form of informing the search about the new edge costs
-    /// \param predsIDV array of predecessors of changed edges
-    /// \note this is used when the search is run backwards
-    void update_preds_of_changededges(std::vector<int>* predsIDV);
-
-   
 private:
 
-
-    DiscreteSpaceInformation* m_space;
+    AdaptiveDiscreteSpace* m_space;
     Heuristic* m_heur;
 
     TimeParameters m_time_params;
@@ -172,15 +197,8 @@ private:
     double m_delta_eps;
     double m_satisfied_eps;
 
-    double initial_eps_planning_time;
-    double final_eps_planning_time;
-    
-
     bool m_allow_partial_solutions;
     bool bforwardsearch;
-    // if true, then search until first solution (see planner.h for search
-    // modes)
-    bool bsearchuntilfirstsolution;
 
     std::vector<TRAState*> m_states;
 
@@ -193,7 +211,7 @@ private:
 
     // search state (not including the values of g, f, back pointers, and
     // closed list from m_stats)
-    intrusive_heap<TRAState, SearchStateCompare> m_open;
+    sbpl::intrusive_heap<TRAState, SearchStateCompare> m_open;
     std::vector<TRAState*> m_incons;
     double m_curr_eps;
     int m_iteration;
@@ -201,87 +219,53 @@ private:
     int m_call_number;          // for lazy reinitialization of search states
     int m_last_start_state_id;  // for lazy reinitialization of the search tree
     int m_last_goal_state_id;   // for updating the search tree when the goal changes
-    double m_last_eps;          // for updating the search tree when heuristics change
 
     int m_expand_count_init;
-    clock::duration m_search_time_init;
+    sbpl::clock::duration m_search_time_init;
     int m_expand_count;
-    clock::duration m_search_time;
-    int MaxMemoryCounter;
-    FILE *fDeb;
-
-    unsigned int expansion_step;
-
-    bool bReevaluatefvals;
-    bool bReinitializeSearchStateSpace;
-    bool bRebuildOpenList;
+    sbpl::clock::duration m_search_time;
 
-    bool bNewSearchIteration;
-
-    std::vector<TRAState*> seen_states;
+    /// \name Tree Restoration
+    ///@{
+    unsigned int m_expansion_step;          // step of the next expansion
+    unsigned int m_first_iteration_end;     // step at which the first iteration ended
+    std::vector<TRAState*> m_seen_states;   // states created in this search
+    ///@}
 
+    SuccessorBuffer m_succs;
 
-    void convertTimeParamsToReplanParams(const TimeParameters& t,ReplanParams& r) const;
+    void convertTimeParamsToReplanParams(const TimeParameters& t, ReplanParams& r) const;
     void convertReplanParamsToTimeParams(const ReplanParams& r, TimeParameters& t);
 
-    bool timedOut(int elapsed_expansions, const clock::duration& elapsed_time) const;
+    bool timedOut(int elapsed_expansions, const sbpl::clock::duration& elapsed_time) const;
 
-    int improvePath(const clock::time_point& start_time, TRAState* goal_state, int& elapsed_expansions, clock::duration& elapsed_time);
+    int improvePath(
+        const sbpl::clock::time_point& start_time,
+        TRAState* goal_state,
+        int& elapsed_expansions,
+        sbpl::clock::duration& elapsed_time);
 
     void expand(TRAState* s);
 
-    void recomputeHeuristics();
     void reorderOpen();
-    int computeKey(TRAState* s) const;
+    unsigned int computeKey(TRAState* s) const;
+    unsigned int computeHeuristic(int state_id) const;
 
     TRAState* getSearchState(int state_id);
     TRAState* createState(int state_id);
     void reinitSearchState(TRAState* state);
 
-    void extractPath(TRAState* to_state, std::vector<int>& solution, int& cost) const;
-
-    bool RestoreSearchTree(unsigned int expansionStep);
-
-    bool updateParents(TRAState* state, unsigned int expansionStep, TRAState* latestParent, unsigned int *latestGVal);
-
-    bool storeParent(TRAState* succ_state, TRAState* state, unsigned int gVal, unsigned int expansionStep);
-
-    void heuristicChanged();
-
-    unsigned int GetStateCreationTime(int stateID)
-    {
-        TRAState* state = getSearchState(stateID);
-        return state->C;
-    };
-
-    // initialization of the start state
+    // initialization of the search tree from the start state
     void InitializeSearch();
 
-    void Recomputegval(TRAState* state);
-
-    // used for backward search
-    void UpdatePreds(TRAState* state);
+    void storeParent(TRAState* succ_state, TRAState* state, unsigned int gVal);
 
-    //used for forward search
-    void UpdateSuccs(TRAState* state);
-    
-    void BuildNewOPENList();
+    void extractPath(TRAState* to_state, std::vector<int>& solution, int& cost) const;
 
     // debugging
     void PrintSearchState(TRAState* state, FILE* fOut);
-
 };
 
-namespace motion 
-{
-class TRAPlannerAllocator : public PlannerAllocator
-{
-public:
+} // namespace adim
 
-    SBPLPlannerPtr allocate(
-        const RobotPlanningSpacePtr& pspace,
-        const RobotHeuristicPtr& heuristic) override;
-};
-}//motion
-} //sbpl
 #endif
@@ -47,6 +47,10 @@ public:
     ///@}
 
     /// \name Transitions
+    ///
+    /// The output vectors are owned by the search and reused across
+    /// expansions. Implementations append transitions to them and should
+    /// keep any intermediate storage as members rather than locals.
     ///@{
 
     virtual void GetSuccs(
@@ -64,9 +68,46 @@ public:
         std::vector<int> *preds,
         std::vector<int> *costs) = 0;
 
+    /// Generate successors with lower bounds on the costs of edges that are
+    /// expensive to validate, flagging the costs that are exact. By default,
+    /// all successors are generated by GetSuccs with exact costs.
+    virtual void GetLazySuccs(
+        int state_id,
+        std::vector<int> *succs,
+        std::vector<int> *costs,
+        std::vector<bool> *true_costs);
+
+    /// Return the exact cost of the edge from \p src_id to \p dst_id, or -1
+    /// if the edge is invalid
+    virtual int EvaluateEdge(int src_id, int dst_id);
+
     virtual bool IsExecutableAction(int src_id, int dst_id) {
         return isExecutable(); }
 
+    /// Return whether the transition functions and GetGoalHeuristic may be
+    /// called from multiple threads concurrently. Representations that keep
+    /// intermediate storage as members, as suggested above, must keep it per
+    /// thread before opting in.
+    virtual bool SupportsConcurrentExpansions() const { return false; }
+
+    ///@}
+
+    /// \name State Translation
+    ///
+    /// Used by MultiRepAdaptiveDiscreteSpace::translateStateID() to exchange
+    /// states between replicas of the space, whose representations are
+    /// registered in the same order.
+    ///@{
+
+    /// Return the id of the state of this representation whose state data is
+    /// equivalent to \p state, the state data of a state of this
+    /// representation's counterpart in a replica space, creating the state if
+    /// necessary. Returns -1 if unsupported.
+    virtual int FindOrCreateState(const AdaptiveState *state) { return -1; }
+
+    /// Return whether FindOrCreateState is implemented
+    virtual bool SupportsStateTranslation() const { return false; }
+
     ///@}
 
     virtual bool IsValidStateData(const AdaptiveState *state) const = 0;
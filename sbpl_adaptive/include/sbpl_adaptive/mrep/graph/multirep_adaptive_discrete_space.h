@@ -3,7 +3,13 @@
 
 // standard includes
 #include <stdlib.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
 #include <vector>
 
 // system includes
@@ -11,11 +17,15 @@
 #include <smpl/forward.h>
 
 // project includes
+#include <sbpl_adaptive/chunked_arena.h>
 #include <sbpl_adaptive/common.h>
 #include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/graph/adaptive_state_change_query.h>
 #include <sbpl_adaptive/mrep/graph/state.h>
 #include <sbpl_adaptive/mrep/graph/adaptive_state_representation.h>
 #include <sbpl_adaptive/mrep/graph/projection.h>
+#include <sbpl_adaptive/mrep/graph/state_table.h>
+#include <sbpl_adaptive/thread_pool.h>
 
 namespace adim {
 
@@ -51,16 +61,86 @@ public:
     ///@}
 
     /// \name State Management
+    ///
+    /// The state table may be accessed concurrently, e.g. by representations
+    /// generating successors for a parallel search. Representations that may
+    /// be expanded concurrently should create states via FindOrInsertHashEntry
+    /// so that two threads never insert the same state twice. Accesses are
+    /// synchronized only during concurrent expansions (see
+    /// beginConcurrentExpansions()) and during ParallelFor with more than one
+    /// worker; other threads that access the state table must bracket their
+    /// accesses in the same way.
     ///@{
     int InsertHashEntry(AdaptiveHashEntry *entry, size_t binID);
 
     template <typename Equal>
     adim::AdaptiveHashEntry *FindHashEntry(size_t binID, int dimID, Equal eq);
 
+    template <typename Equal, typename Create>
+    adim::AdaptiveHashEntry *FindOrInsertHashEntry(
+        size_t binID,
+        int dimID,
+        Equal eq,
+        Create create,
+        bool *inserted = nullptr);
+
     AdaptiveHashEntry *GetState(int stateID) const;
     int GetDimID(int stateID);
     ///@}
 
+    /// \name Arena-Allocated States
+    ///
+    /// Instead of allocating hash entries and state data individually and
+    /// inserting them via InsertHashEntry, representations may have the space
+    /// construct them in place, in an arena of hash entries and an arena of
+    /// state data per representation, typed on the representation's concrete
+    /// AdaptiveState subtype, which must be trivially destructible.
+    /// Arena-allocated states are not passed to the representation's
+    /// deleteStateData() and their destructors are never run.
+    ///
+    /// ClearStates() removes all states, including the abstract goal, between
+    /// queries by resetting the arenas in one step, keeping the memory for
+    /// reuse; only entries inserted via InsertHashEntry or
+    /// FindOrInsertHashEntry are deleted individually. Representations must drop any state ids
+    /// they hold, and planners must be reset, e.g. via
+    /// force_planning_from_scratch_and_free_memory(), before the state ids
+    /// are reused.
+    ///@{
+    template <typename T, typename... Args>
+    adim::AdaptiveHashEntry *InsertState(size_t binID, int dimID, Args&&... args);
+
+    template <typename T, typename Equal>
+    adim::AdaptiveHashEntry *FindOrInsertState(
+        size_t binID,
+        int dimID,
+        Equal eq,
+        const T &state,
+        bool *inserted = nullptr);
+
+    void ClearStates(bool free_memory = false);
+    ///@}
+
+    /// \name Search Tree Restoration
+    ///
+    /// The space records the earliest step at which each state was expanded
+    /// by a search that reports expansion steps, e.g. TRAPlanner, and reports
+    /// the earliest step among the states modified by a new sphere via
+    /// addSphere(int, int&). The states modified by addSphere(int,
+    /// std::vector<int>*) must include every state whose transitions change;
+    /// if none are reported, the affected step is unknown.
+    ///@{
+    using AdaptiveDiscreteSpace::addSphere;
+    void addSphere(int StateID, int &first_mod_step) override;
+
+    /// \return The earliest step at which any of the states was expanded, or
+    ///     INT_MAX if none was
+    int GetEarliestExpansionStep(const std::vector<int> &state_ids) const;
+
+    /// Fill in the expansion step of a change to the outgoing edges of the
+    /// query's predecessors, to be passed to SBPLPlanner::costs_changed()
+    void FillExpansionStep(AdaptiveStateChangeQuery *query) const;
+    ///@}
+
     /// \name Start State and Goal Condition
     ///@{
     int SetStartCoords(int dimID, const AdaptiveState *state);
@@ -99,11 +179,47 @@ public:
     bool IsProjectionExecutable(int fromID, int toID) const;
     ///@}
 
+    /// \name Parallel Successor Validation
+    ///
+    /// Representations may validate the candidate successors of an expansion
+    /// concurrently via ParallelFor, e.g. by checking each motion primitive
+    /// for collisions in the task and recording the result in a per-index
+    /// slot, then creating the valid successors in index order, so that the
+    /// successors do not depend on the schedule. Tasks are passed the index of
+    /// the worker running them so that they can use per-worker instances of
+    /// non-thread-safe checkers (see ParallelCollisionChecker). Without a
+    /// thread pool, tasks run sequentially on the calling thread as worker 0.
+    ///
+    /// Calls from concurrent expansions are serialized. The pool must not be
+    /// one that runs the search itself, e.g. the pool of a parallel planner.
+    ///@{
+    void SetThreadPool(const ThreadPoolPtr &pool) { thread_pool_ = pool; }
+    const ThreadPoolPtr &GetThreadPool() const { return thread_pool_; }
+
+    /// \return The number of workers that may run tasks passed to ParallelFor
+    int NumWorkers() const { return thread_pool_ ? thread_pool_->numWorkers() : 1; }
+
+    void ParallelFor(size_t n, const ThreadPool::Task &task);
+    ///@}
+
     /// \name Required Public Functions From AdaptiveDiscreteSpaceInformation
     ///@{
 
     bool isExecutablePath(const std::vector<int> &path) override;
 
+    bool sharesMutableState(const AdaptiveDiscreteSpace &other) const override;
+
+    bool supportsConcurrentExpansions() const override;
+
+    void beginConcurrentExpansions() override;
+    void endConcurrentExpansions() override;
+
+    int translateStateID(
+        const AdaptiveDiscreteSpace &src,
+        int src_state_id) override;
+
+    bool supportsStateTranslation() const override;
+
     void GetSuccs_Plan(
         int state_id,
         std::vector<int> *succs,
@@ -147,6 +263,14 @@ public:
         int expansion_step,
         std::vector<int> *preds,
         std::vector<int> *costs) override;
+
+    void GetLazySuccs_Plan(
+        int state_id,
+        std::vector<int> *succs,
+        std::vector<int> *costs,
+        std::vector<bool> *true_costs) override;
+
+    int EvaluateEdge(int src_id, int dst_id) override;
     ///@}
 
 protected:
@@ -160,20 +284,104 @@ protected:
     AdaptiveHashEntry *goal_hash_entry_;
     AdaptiveHashEntry *start_hash_entry_;
 
-    // hash tables
-    size_t hash_table_size_;
-    std::vector<std::vector<std::vector<AdaptiveHashEntry *>>> hash_tables_;
+    // hash tables, one per representation
+    std::vector<AdaptiveStateTable> hash_tables_;
 
-    // vector that maps from stateID to coords
-    std::vector<AdaptiveHashEntry *> state_id_to_hash_entry_;
+    // maps from stateID to coords; may be read without holding
+    // state_table_mutex_
+    ChunkedArena<AdaptiveHashEntry *> state_id_to_hash_entry_;
 
     std::vector<ProjectionPtr> proj_matrix_;
 
-    int InsertMetaGoalHashEntry(AdaptiveHashEntry *entry);
+    ThreadPoolPtr thread_pool_;
+
+    // serializes calls to ParallelFor, since the pool runs one loop at a time
+    // and workers index per-worker checkers
+    std::mutex thread_pool_mutex_;
+
+    // number of spans of concurrent expansions in progress
+    std::atomic<int> concurrent_expansions_;
+
+    // guards hash_tables_, insertions into state_id_to_hash_entry_,
+    // StateID2IndexMapping, and the state arenas while concurrent expansions
+    // are in progress; acquired via LockStateTable()
+    mutable std::mutex state_table_mutex_;
+
+    std::unique_lock<std::mutex> LockStateTable() const;
+
+    AdaptiveHashEntry *InsertMetaGoalHashEntry();
+
+    /// Called when the transitions of a state are requested at a known
+    /// expansion step, as done by TRAPlanner. Records the step for the state;
+    /// environments may additionally record it for the region covered by the
+    /// state (e.g. via ExpansionGrid3D::setExpansionStep), in which case they
+    /// must call this implementation as well.
+    virtual void onExpansionStep(int state_id, int expansion_step);
 
     bool IsValidStateID(int stateID) const;
     bool IsValidRepID(int dimID) const;
     int GetProjectionIndex(int srep, int trep) const;
+
+private:
+
+    struct PlannerIndices
+    {
+        int data[NUMOFINDICES_STATEID2IND];
+    };
+
+    // type-erased arena of the state data of one representation; type is the
+    // state data type the arena was created for
+    struct StateDataArena
+    {
+        explicit StateDataArena(const std::type_info &type) : type(&type) { }
+        virtual ~StateDataArena() { }
+        virtual void clear() = 0;
+        virtual void release() = 0;
+        const std::type_info *type;
+    };
+
+    template <typename T>
+    struct TypedStateDataArena : public StateDataArena
+    {
+        TypedStateDataArena() : StateDataArena(typeid(T)) { }
+        ChunkedArena<T> states;
+        void clear() override { states.clear(); }
+        void release() override { states.release(); }
+    };
+
+    // clearing the arenas must not need to visit their objects (state data
+    // types derived from AdaptiveState have a virtual destructor under
+    // STATE_CAST_DEBUG)
+    static_assert(STATE_CAST_DEBUG ||
+            std::is_trivially_destructible<AdaptiveState>::value,
+            "AdaptiveState must be trivially destructible");
+    static_assert(std::is_trivially_destructible<AdaptiveHashEntry>::value,
+            "AdaptiveHashEntry must be trivially destructible");
+
+    // storage for the rows of StateID2IndexMapping, which point into it
+    ChunkedArena<PlannerIndices> planner_indices_;
+
+    // storage for arena-allocated states, and state data arenas indexed by
+    // representation id
+    ChunkedArena<AdaptiveHashEntry> hash_entries_;
+    std::vector<std::unique_ptr<StateDataArena>> state_data_;
+
+    // entries inserted via InsertHashEntry, owned by the space
+    std::vector<AdaptiveHashEntry *> heap_entries_;
+
+    // earliest expansion step of each state, INT_MAX if never expanded
+    std::vector<int> expansion_steps_;
+
+    template <typename Equal>
+    AdaptiveHashEntry *FindHashEntryUnlocked(size_t binID, int dimID, Equal eq);
+
+    int InsertHashEntryUnlocked(AdaptiveHashEntry *entry, size_t binID);
+
+    template <typename T, typename... Args>
+    AdaptiveHashEntry *CreateStateUnlocked(int dimID, Args&&... args);
+
+    void InsertPlannerIndices();
+    void DeleteHeapEntries();
 };
 
 inline
@@ -240,6 +448,18 @@ MultiRepAdaptiveDiscreteSpace::GetRepresentation(int dimID) const
     return (const T *)representations_[dimID].get();
 }
 
+// Lock the state table if concurrent expansions are in progress. The count
+// only changes outside of concurrent expansions, before the threads that
+// access the state table are started and after they finish.
+inline
+std::unique_lock<std::mutex> MultiRepAdaptiveDiscreteSpace::LockStateTable() const
+{
+    if (concurrent_expansions_.load(std::memory_order_relaxed) > 0) {
+        return std::unique_lock<std::mutex>(state_table_mutex_);
+    }
+    return std::unique_lock<std::mutex>();
+}
+
 /// Lookup a hash entry for a state
 /// \param binID The hash value of the state being looked up
 /// \param dimID The representation id of the state being looked up
@@ -251,16 +471,147 @@ adim::AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::FindHashEntry(
     int dimID,
     Equal eq)
 {
-    size_t bin = binID & (hash_table_size_ - 1);
-    const auto &state_table = hash_tables_[dimID];
-    for (size_t i = 0; i < state_table[bin].size(); ++i) {
-        adim::AdaptiveHashEntry *entry = state_table[bin][i];
-        if (eq(entry)) {
-            return entry;
-        }
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    return FindHashEntryUnlocked(binID, dimID, eq);
+}
+
+/// Lookup a hash entry for a state, inserting a new entry if none is found.
+/// The lookup and insertion are atomic with respect to other threads.
+/// \param binID The hash value of the state being looked up
+/// \param dimID The representation id of the state being looked up
+/// \param eq The equivalence condition for a state
+/// \param create Called to construct the new entry if none is found; its
+///     dimID must equal \p dimID
+/// \param inserted Set to whether a new entry was inserted, if not null
+/// \return A pointer to an equivalent or the inserted state, or nullptr if
+///     the inserted state's dimID is invalid
+template <typename Equal, typename Create>
+adim::AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::FindOrInsertHashEntry(
+    size_t binID,
+    int dimID,
+    Equal eq,
+    Create create,
+    bool *inserted)
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    AdaptiveHashEntry *entry = FindHashEntryUnlocked(binID, dimID, eq);
+    if (inserted) {
+        *inserted = !entry;
+    }
+    if (entry) {
+        return entry;
+    }
+
+    entry = create();
+    if (InsertHashEntryUnlocked(entry, binID) < 0) {
+        delete entry;
+        return nullptr;
+    }
+    heap_entries_.push_back(entry);
+    return entry;
+}
+
+/// Construct a new state, of the representation's state data type T, in place
+/// and insert it into the state table. As with InsertHashEntry, the state
+/// should not currently exist in the state table.
+/// \param binID The hash value of the state to be inserted
+/// \param dimID The representation id of the state to be inserted
+/// \param args The arguments to T's constructor
+/// \return A pointer to the inserted state, or nullptr if \p dimID is invalid
+template <typename T, typename... Args>
+adim::AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::InsertState(
+    size_t binID,
+    int dimID,
+    Args&&... args)
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    AdaptiveHashEntry *entry = CreateStateUnlocked<T>(dimID, std::forward<Args>(args)...);
+    if (entry) {
+        InsertHashEntryUnlocked(entry, binID);
+    }
+    return entry;
+}
+
+/// Lookup a hash entry for a state, inserting a copy of \p state, constructed
+/// in place, if none is found. The lookup and insertion are atomic with
+/// respect to other threads.
+/// \param binID The hash value of the state being looked up
+/// \param dimID The representation id of the state being looked up
+/// \param eq The equivalence condition for a state
+/// \param state The state data of the state being looked up
+/// \param inserted Set to whether a new entry was inserted, if not null
+/// \return A pointer to an equivalent or the inserted state, or nullptr if
+///     \p dimID is invalid
+template <typename T, typename Equal>
+adim::AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::FindOrInsertState(
+    size_t binID,
+    int dimID,
+    Equal eq,
+    const T &state,
+    bool *inserted)
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    AdaptiveHashEntry *entry = nullptr;
+    if (IsValidRepID(dimID)) {
+        entry = FindHashEntryUnlocked(binID, dimID, eq);
+    }
+    if (inserted) {
+        *inserted = false;
+    }
+    if (entry) {
+        return entry;
     }
 
-    return nullptr;
+    entry = CreateStateUnlocked<T>(dimID, state);
+    if (!entry) {
+        return nullptr;
+    }
+    InsertHashEntryUnlocked(entry, binID);
+    if (inserted) {
+        *inserted = true;
+    }
+    return entry;
+}
+
+template <typename T, typename... Args>
+AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::CreateStateUnlocked(
+    int dimID,
+    Args&&... args)
+{
+    if (!IsValidRepID(dimID)) {
+        ROS_ERROR_NAMED("mrep", "dimID %d does not have a hash table!", dimID);
+        return nullptr;
+    }
+
+    if (state_data_.size() < representations_.size()) {
+        state_data_.resize(representations_.size());
+    }
+    static_assert(STATE_CAST_DEBUG || std::is_trivially_destructible<T>::value,
+            "arena-allocated state data must be trivially destructible");
+
+    std::unique_ptr<StateDataArena> &arena = state_data_[dimID];
+    if (!arena) {
+        arena.reset(new TypedStateDataArena<T>);
+    }
+    if (*arena->type != typeid(T)) {
+        ROS_ERROR_NAMED("mrep", "States of representation %d must all have the same state data type", dimID);
+        throw std::runtime_error("bad state data type");
+    }
+    auto *typed_arena = static_cast<TypedStateDataArena<T> *>(arena.get());
+
+    AdaptiveHashEntry *entry = hash_entries_.create();
+    entry->dimID = dimID;
+    entry->stateData = typed_arena->states.create(std::forward<Args>(args)...);
+    return entry;
+}
+
+template <typename Equal>
+adim::AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::FindHashEntryUnlocked(
+    size_t binID,
+    int dimID,
+    Equal eq)
+{
+    return hash_tables_[dimID].find(binID, eq);
 }
 
 } // namespace adim
@@ -0,0 +1,112 @@
+#ifndef SBPL_ADAPTIVE_STATE_TABLE_H
+#define SBPL_ADAPTIVE_STATE_TABLE_H
+
+// standard includes
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// project includes
+#include <sbpl_adaptive/core/graph/state.h>
+
+namespace adim {
+
+/// An open-addressing hash table of the states of a single representation,
+/// keyed by the hash values provided by the representation.
+///
+/// Each slot stores a 32-bit fingerprint of the hash value of its state inline
+/// next to the entry pointer, so that a lookup only dereferences entries, and
+/// calls the equivalence condition, for states whose fingerprints match.
+/// Collisions are resolved by linear probing with robin hood insertion, which
+/// keeps probe sequences short and lets unsuccessful lookups stop early, and
+/// the table doubles its capacity when the load factor would exceed
+/// max_load_factor().
+/// Entries are never removed individually; clear() removes all entries in
+/// constant time by advancing the table's epoch, which invalidates every slot
+/// stamped with an earlier epoch. The table does not own its entries.
+class AdaptiveStateTable
+{
+public:
+
+    /// \param capacity The initial number of slots, rounded up to a power of
+    ///     two
+    explicit AdaptiveStateTable(size_t capacity = 1024);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+    static double max_load_factor() { return 0.75; }
+
+    template <typename Equal>
+    AdaptiveHashEntry *find(size_t hash, Equal eq) const;
+
+    /// Insert an entry without checking for an equivalent entry
+    void insert(AdaptiveHashEntry *entry, size_t hash);
+
+    /// Remove all entries, keeping the table's capacity
+    void clear();
+
+private:
+
+    struct Slot
+    {
+        uint32_t hash;
+        uint32_t epoch; // the slot is empty unless this equals epoch_
+        AdaptiveHashEntry *entry;
+    };
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t size_;
+    uint32_t epoch_;
+
+    bool occupied(const Slot &slot) const { return slot.epoch == epoch_; }
+
+    // the distance of the slot at pos from the home slot of hash
+    size_t probe_distance(uint32_t hash, size_t pos) const {
+        return (pos - hash) & mask_;
+    }
+
+    void insert_slot(Slot slot);
+    void grow();
+
+    // representations commonly hash into the low bits only (e.g. grid
+    // indices), so mix every bit into the bits used to select a slot
+    static uint32_t fingerprint(size_t hash);
+};
+
+inline uint32_t AdaptiveStateTable::fingerprint(size_t hash)
+{
+    uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+/// \param hash The hash value of the state being looked up
+/// \param eq The equivalence condition for a state
+/// \return A pointer to an equivalent state, or nullptr if none is found
+template <typename Equal>
+AdaptiveHashEntry *AdaptiveStateTable::find(size_t hash, Equal eq) const
+{
+    const uint32_t fp = fingerprint(hash);
+    size_t pos = fp & mask_;
+    for (size_t dist = 0; ; ++dist) {
+        const Slot &slot = slots_[pos];
+        // a robin hood table never places an entry past an entry closer to
+        // its home slot
+        if (!occupied(slot) || probe_distance(slot.hash, pos) < dist) {
+            return nullptr;
+        }
+        if (slot.hash == fp && eq(slot.entry)) {
+            return slot.entry;
+        }
+        pos = (pos + 1) & mask_;
+    }
+}
+
+} // namespace adim
+
+#endif
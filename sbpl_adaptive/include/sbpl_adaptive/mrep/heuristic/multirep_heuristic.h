@@ -18,6 +18,10 @@ public:
     { }
 
     virtual bool IsDefinedForRepresentation(int dim_id) const = 0;
+
+    /// Return whether GetGoalHeuristic may be called from multiple threads
+    /// concurrently
+    virtual bool SupportsConcurrentEvaluation() const { return false; }
 };
 
 SBPL_CLASS_FORWARD(MultiRepEmbeddedHeuristic)
@@ -2,17 +2,25 @@
 #define sbpl_MHAPlanner_AD_h
 
 // standard includes
-#include <unordered_map>
+#include <stdint.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 // system includes
 #include <sbpl/headers.h>
 #include <smpl/time.h>
 
 // project includes
+#include <sbpl_adaptive/chunked_arena.h>
 #include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
 #include <sbpl_adaptive/core/search/adaptive_planner.h>
+#include <sbpl_adaptive/core/search/open_list.h>
 #include <sbpl_adaptive/mrep/graph/multirep_adaptive_discrete_space.h>
 #include <sbpl_adaptive/mrep/heuristic/multirep_heuristic.h>
+#include <sbpl_adaptive/mrep/search/queue_scheduler.h>
+#include <sbpl_adaptive/thread_pool.h>
 
 namespace adim {
 
@@ -20,7 +28,13 @@ class ADMHAPlannerAllocator : public PlannerAllocator
 {
 public:
 
-    ADMHAPlannerAllocator(MultiRepHeuristic *aheur, MultiRepHeuristic **heurs, int h_count);
+    ADMHAPlannerAllocator(
+        MultiRepHeuristic *aheur,
+        MultiRepHeuristic **heurs,
+        int h_count,
+        OpenListType open_list_type = OpenListType::BINARY_HEAP,
+        int num_threads = 1,
+        QueueSchedulerType scheduler_type = QueueSchedulerType::ROUND_ROBIN);
 
     SBPLPlanner *make(
         AdaptiveDiscreteSpace *space,
@@ -31,8 +45,75 @@ private:
     MultiRepHeuristic *aheur_;
     MultiRepHeuristic **heurs_;
     int h_count_;
+    OpenListType open_list_type_;
+    int num_threads_;
+    QueueSchedulerType scheduler_type_;
 };
 
+struct MHAState_AD
+{
+    int call_number;
+    int state_id;
+    int dim_id;         // representation of the graph state
+    int g;
+    MHAState_AD* bp;
+
+    bool closed_in_anc;
+    bool closed_in_add;
+
+    uint64_t h_valid;   // bit i is set iff od[i].h is up to date
+
+    struct HeapData
+    {
+        AbstractSearchState open_state;
+        int h;
+    };
+
+    // one entry per heuristic, the anchor first; allocated past the end of
+    // the struct for the inadmissible heuristics
+    HeapData od[1];
+};
+
+/// Multi-Heuristic A* for multi-representation spaces.
+///
+/// Heuristic values are computed lazily, the first time a search needs the
+/// key of a state. The anchor heuristic is evaluated for states inserted into
+/// the anchor queue. The inadmissible heuristics are evaluated for states
+/// whose key is compared against w_2 times their anchor key, which happens
+/// when their cost-to-come improves while they are closed in neither the
+/// anchor nor the inadmissible searches, unless the cost-to-come alone
+/// exceeds that bound. They may therefore be evaluated for states that are then not
+/// inserted into their queues.
+///
+/// With more than one thread (see set_num_threads()), the inadmissible queues
+/// are divided among the threads, each of which runs the MHA* selection rule
+/// against its own queues and the shared anchor queue. The search states and
+/// open lists are shared and guarded by a single lock, while successors are
+/// generated outside of it (concurrently if the space supports concurrent
+/// expansions; see AdaptiveDiscreteSpace::supportsConcurrentExpansions()), as
+/// are the heuristic values needed to update them (concurrently if all
+/// heuristics support concurrent evaluation).
+///
+/// The suboptimality bound of the anchor search is kept by treating states
+/// being expanded as still open in the anchor search: a state is only
+/// expanded from the anchor queue if its anchor key is no greater than that
+/// of every state being expanded, and the termination conditions compare
+/// against the smallest anchor key among the anchor queue and the states
+/// being expanded.
+///
+/// The inadmissible queue to expand a state from next is chosen by a
+/// QueueScheduler, among the queues that are not empty. An expansion from a
+/// queue is considered to make progress if it improves the best heuristic
+/// value seen in that queue.
+///
+/// Unless searching until the first solution, the search is anytime: after a
+/// solution is found, both weights are lowered by the decrement epsilon
+/// towards their final values and the search continues from the states
+/// generated so far, as in ARA*, until the final weights or the time limit are
+/// reached. Subsequent calls to replan() with the same start and goal resume
+/// the search where the previous call left off. If only the goal changed, the
+/// search is continued from the states generated so far, with their
+/// heuristic values recomputed for the new goal.
 class MHAPlanner_AD : public SBPLPlanner
 {
 public:
@@ -41,7 +122,10 @@ public:
             MultiRepAdaptiveDiscreteSpace* space,
             MultiRepHeuristic* hanchor,
             MultiRepHeuristic** heurs,
-            int hcount);
+            int hcount,
+            OpenListType open_list_type = OpenListType::BINARY_HEAP,
+            int num_threads = 1,
+            QueueSchedulerType scheduler_type = QueueSchedulerType::ROUND_ROBIN);
 
     virtual ~MHAPlanner_AD();
 
@@ -124,6 +208,7 @@ public:
     void    set_initial_eps(double eps) { return set_initialsolution_eps(eps); }
     void    set_initial_mha_eps(double eps_mha);
     void    set_final_eps(double eps);
+    void    set_final_mha_eps(double eps_mha);
     void    set_dec_eps(double eps);
     void    set_max_expansions(int expansion_count);
     void    set_max_time(double max_time);
@@ -131,14 +216,29 @@ public:
     // double get_initial_eps();
     double  get_initial_mha_eps() const;
     double  get_final_eps() const;
+    double  get_final_mha_eps() const;
     double  get_dec_eps() const;
     int     get_max_expansions() const;
     double  get_max_time() const;
 
     ///@}
 
+    /// Set the number of threads driving the inadmissible queues. At most one
+    /// thread is used per inadmissible heuristic; 0 selects the number of
+    /// hardware threads and 1 runs the search sequentially.
+    void    set_num_threads(int num_threads);
+    int     get_num_threads() const;
+
+    /// Set the policy selecting the inadmissible queue to expand from next
+    void    set_queue_scheduler(std::unique_ptr<QueueScheduler> scheduler);
+
 private:
 
+    enum SearchStatus { SEARCHING, FOUND, TIMED_OUT, EXHAUSTED };
+
+    // limited by the width of MHAState_AD::h_valid
+    static const int MAX_HEURISTICS = 64;
+
     MultiRepAdaptiveDiscreteSpace *space_;
 
     // Related objects
@@ -148,6 +248,7 @@ private:
 
     ReplanParams m_params;
     double m_initial_eps_mha;
+    double m_final_eps_mha;
     int m_max_expansions;
 
     double m_eps;           ///< current w_1
@@ -158,6 +259,12 @@ private:
     /// suboptimality bound satisfied by the last search
     double m_eps_satisfied;
 
+    /// best solution found for the current query, kept across calls to
+    /// replan() so that a resumed iteration that runs out of time still
+    /// returns it; empty if no solution has been found yet
+    std::vector<int> m_best_path;
+    int m_best_cost;
+
     int m_num_expansions;               ///< current number of expansion
     sbpl::clock::duration m_elapsed;    ///< current amount of seconds
 
@@ -167,41 +274,112 @@ private:
 
     bool set_heur_;
 
-    MHASearchState* m_start_state;
-    MHASearchState* m_goal_state;
+    MHAState_AD* m_start_state;
+    MHAState_AD* m_goal_state;
 
-    std::vector<MHASearchState*> m_search_states;
+    std::vector<MHAState_AD*> m_search_states;
+    ChunkedArena<MHAState_AD> m_state_arena;
 
-    CHeap* m_open; ///< sequence of (m_hcount + 1) open lists
+    /// sequence of (m_hcount + 1) open lists
+    std::vector<std::unique_ptr<OpenList>> m_open;
 
     std::vector<int> m_graph_to_search_state;
 
-    std::unordered_map<int, std::vector<int>> m_heuristic_list;
+    /// indices of the heuristics, the anchor first, that apply to each
+    /// representation; those of representation i (-1 for the abstract goal)
+    /// are [m_heuristic_offsets[i + 1], m_heuristic_offsets[i + 2])
+    std::vector<int> m_heuristic_ids;
+    std::vector<int> m_heuristic_offsets;
+
+    struct HeuristicRange
+    {
+        const int* first;
+        const int* last;
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+    };
+
+    SuccessorBuffer m_succs; ///< reused by every expansion
+
+    ThreadPoolPtr m_pool;   ///< null if the search is sequential
+
+    /// \name Shared Search State
+    ///
+    /// Guarded by m_mutex while a parallel search is running.
+    ///@{
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<MHAState_AD*> m_being_expanded;
+    SearchStatus m_search_status;
+    sbpl::clock::time_point m_search_start;
+    ///@}
+
+    // serializes successor generation and heuristic evaluation in spaces and
+    // heuristics that are not thread safe
+    std::mutex m_expand_mutex;
+
+    // a heuristic value to be computed outside of the lock
+    struct HeuristicRequest
+    {
+        MHAState_AD* state;
+        int hidx;
+        int h;
+    };
+
+    std::unique_ptr<QueueScheduler> m_scheduler;
+    std::vector<int> m_queues;      ///< indices of the inadmissible queues
+    std::vector<int> m_candidates;  ///< non-empty queues; reused by selection
+    std::vector<int> m_best_h;      ///< best heuristic value seen per queue
+
+    /// states whose cost-to-come improved after they were closed
+    std::vector<MHAState_AD*> m_incons;
 
     bool check_params(const ReplanParams& params);
 
     bool time_limit_reached() const;
 
     int num_heuristics() const { return m_hcount + 1; }
-    MHASearchState* get_state(int state_id);
-    void init_state(MHASearchState* state, size_t mha_state_idx, int state_id);
-    void reinit_state(MHASearchState* state);
+    HeuristicRange heuristics(int dim_id) const;
+    MHAState_AD* get_state(int state_id);
+    void init_state(MHAState_AD* state, size_t mha_state_idx, int state_id);
+    void reinit_state(MHAState_AD* state);
     void reinit_search();
     void clear_open_lists();
     void clear();
-    long int compute_key(MHASearchState* state, int hidx);
-    void expand(MHASearchState* state, int hidx);
-    MHASearchState* state_from_open_state(AbstractSearchState* open_state);
+    long int compute_key(MHAState_AD* state, int hidx);
+    void expand(MHAState_AD* state, int hidx);
+    void begin_expansion(MHAState_AD* state, int hidx);
+    bool update_succs(MHAState_AD* state, const SuccessorBuffer& succs, int expand_hidx);
+    bool being_expanded(MHAState_AD* state) const;
+    void get_heuristic_requests(
+        MHAState_AD* state,
+        const SuccessorBuffer& succs,
+        std::vector<HeuristicRequest>* requests);
+
+    int num_search_threads() const;
+    bool concurrent_heuristics() const;
+    bool update_open_lists(MHAState_AD* state, int expand_hidx);
+    void reuse_search();
+    void retarget_search();
+    void invalidate_heuristics();
+    bool lower_weights();
+    bool search();
+    bool parallel_search();
+    void search_loop(int thread_idx, int num_threads);
+    int select_queue(const std::vector<int>& queues, long int anchor_f, std::vector<int>* candidates);
+    long int get_anchor_bound();
+    MHAState_AD* state_from_open_state(AbstractSearchState* open_state);
+    int get_heuristic(MHAState_AD* state, int hidx);
     int compute_heuristic(int state_id, int hidx);
-    long int get_minf(CHeap& pq) const;
-    void insert_or_update(MHASearchState* state, int hidx, int f);
+    long int get_minf(OpenList& pq) const;
+    void insert_or_update(MHAState_AD* state, int hidx, long int f);
 
     void extract_path(std::vector<int>* solution_path, int* solcost);
-    void extract_partial_path(std::vector<int>* solution_path, int* solcost, MHASearchState* best_seen_state);
+    void extract_partial_path(std::vector<int>* solution_path, int* solcost, MHAState_AD* best_seen_state);
 
-    bool closed_in_anc_search(MHASearchState* state) const;
-    bool closed_in_add_search(MHASearchState* state) const;
-    bool closed_in_any_search(MHASearchState* state) const;
+    bool closed_in_anc_search(MHAState_AD* state) const;
+    bool closed_in_add_search(MHAState_AD* state) const;
+    bool closed_in_any_search(MHAState_AD* state) const;
 };
 
 } // namespace adim
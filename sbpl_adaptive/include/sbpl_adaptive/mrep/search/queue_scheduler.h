@@ -0,0 +1,89 @@
+#ifndef SBPL_ADAPTIVE_QUEUE_SCHEDULER_H
+#define SBPL_ADAPTIVE_QUEUE_SCHEDULER_H
+
+// standard includes
+#include <random>
+#include <vector>
+
+namespace adim {
+
+enum class QueueSchedulerType
+{
+    ROUND_ROBIN,
+    THOMPSON_SAMPLING
+};
+
+const char *to_string(QueueSchedulerType type);
+
+/// Chooses the inadmissible queue of a multi-heuristic search to expand a
+/// state from next, and learns from the outcome of each expansion.
+///
+/// Queues are identified by their heuristic index, in [0, num_queues).
+class QueueScheduler
+{
+public:
+
+    virtual ~QueueScheduler() { }
+
+    /// Forget everything learned, e.g. at the start of a new search
+    virtual void reset(int num_queues) = 0;
+
+    /// Select one of a non-empty set of candidate queues
+    virtual int selectQueue(const std::vector<int> &queues) = 0;
+
+    /// Report whether an expansion from a queue made progress, i.e. improved
+    /// the best heuristic value seen in that queue
+    virtual void update(int queue, bool progress) = 0;
+};
+
+QueueScheduler *MakeQueueScheduler(QueueSchedulerType type);
+
+/// Visits the queues in cyclic order of their indices.
+class RoundRobinScheduler : public QueueScheduler
+{
+public:
+
+    RoundRobinScheduler();
+
+    void reset(int num_queues) override;
+    int selectQueue(const std::vector<int> &queues) override;
+    void update(int queue, bool progress) override { }
+
+private:
+
+    int m_last;
+};
+
+/// Dynamic Thompson Sampling over the queues: the probability that an
+/// expansion from a queue makes progress is modeled by a Beta distribution,
+/// from which a sample is drawn for each candidate, and the queue with the
+/// largest sample is selected. Once the parameters of a distribution sum to
+/// more than the history bound, they are rescaled, so that the distribution
+/// tracks a rate of progress that changes over the course of the search.
+class ThompsonSamplingScheduler : public QueueScheduler
+{
+public:
+
+    explicit ThompsonSamplingScheduler(
+        double history_bound = 10.0,
+        unsigned int seed = 0);
+
+    void reset(int num_queues) override;
+    int selectQueue(const std::vector<int> &queues) override;
+    void update(int queue, bool progress) override;
+
+private:
+
+    double m_history_bound;
+    unsigned int m_seed;
+
+    std::mt19937 m_rng;
+    std::vector<double> m_alpha;
+    std::vector<double> m_beta;
+
+    double sampleBeta(double alpha, double beta);
+};
+
+} // namespace adim
+
+#endif
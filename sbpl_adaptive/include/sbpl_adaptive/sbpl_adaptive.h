@@ -4,17 +4,28 @@
 #include <sbpl_adaptive/SCVStat.h>
 #include <sbpl_adaptive/adaptive_grid.h>
 #include <sbpl_adaptive/adaptive_grid_3d.h>
+#include <sbpl_adaptive/chunked_arena.h>
 #include <sbpl_adaptive/common.h>
 #include <sbpl_adaptive/sparse_adaptive_grid_3d.h>
+#include <sbpl_adaptive/thread_pool.h>
 #include <sbpl_adaptive/core/graph/adaptive_discrete_space.h>
+#include <sbpl_adaptive/core/graph/successor_buffer.h>
+#include <sbpl_adaptive/core/search/adaptive_budget_controller.h>
 #include <sbpl_adaptive/core/search/adaptive_planner.h>
+#include <sbpl_adaptive/core/search/adaptive_planner_pool.h>
+#include <sbpl_adaptive/core/search/adaptive_planner_portfolio.h>
 #include <sbpl_adaptive/core/search/araplanner_ad.h>
+#include <sbpl_adaptive/core/search/open_list.h>
+#include <sbpl_adaptive/core/search/paseplanner_ad.h>
+#include <sbpl_adaptive/core/search/planner_trace.h>
 #include <sbpl_adaptive/core/search/traplanner.h>
 #include <sbpl_adaptive/mrep/graph/adaptive_state_representation.h>
 #include <sbpl_adaptive/mrep/graph/adaptive_state_representation_3d.h>
 #include <sbpl_adaptive/mrep/graph/multirep_adaptive_discrete_space.h>
 #include <sbpl_adaptive/mrep/graph/multirep_adaptive_discrete_space_3d.h>
 #include <sbpl_adaptive/mrep/graph/state.h>
+#include <sbpl_adaptive/mrep/graph/state_table.h>
 #include <sbpl_adaptive/mrep/search/mhaplanner_ad.h>
+#include <sbpl_adaptive/mrep/search/queue_scheduler.h>
 
 #endif
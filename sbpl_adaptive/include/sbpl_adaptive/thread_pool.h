@@ -0,0 +1,86 @@
+#ifndef SBPL_ADAPTIVE_THREAD_POOL_H
+#define SBPL_ADAPTIVE_THREAD_POOL_H
+
+// standard includes
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// system includes
+#include <smpl/forward.h>
+
+namespace adim {
+
+SBPL_CLASS_FORWARD(ThreadPool)
+
+/// A persistent pool of worker threads for fine-grained data-parallel loops,
+/// such as recomputing the heuristics of all search states, or for running
+/// one search loop per worker.
+///
+/// Each call to parallelFor() splits the index range evenly among the workers;
+/// a worker that finishes its share steals indices from the others. The
+/// calling thread participates as worker 0, so a pool of n workers runs n - 1
+/// threads of its own. Workers are identified by index so that callers can
+/// give each worker its own instance of non-thread-safe resources, e.g.
+/// collision checkers. Results written to per-index slots are independent of
+/// the schedule, so loops remain deterministic.
+class ThreadPool
+{
+public:
+
+    typedef std::function<void(size_t index, int worker)> Task;
+
+    /// \param num_workers The number of workers, including the calling
+    ///     thread; defaults to the number of hardware threads
+    explicit ThreadPool(int num_workers = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int numWorkers() const { return num_workers_; }
+
+    /// Run task(i, worker) for all i in [0, n) and return once all calls
+    /// completed. If a call throws, the remaining indices are skipped, and the
+    /// first exception is rethrown once every worker has stopped running the
+    /// task. Not reentrant: task must not call parallelFor() on the same
+    /// pool, and only one thread may call parallelFor() at a time.
+    void parallelFor(size_t n, const Task &task);
+
+private:
+
+    // padded to avoid false sharing between workers
+    struct Range
+    {
+        std::atomic<size_t> next;
+        size_t end;
+        char pad[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    };
+
+    int num_workers_;
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Range[]> ranges_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const Task *task_;
+    std::exception_ptr error_;
+    unsigned int generation_;
+    int active_;
+    bool stop_;
+
+    void workerLoop(int worker);
+    void run(int worker);
+};
+
+} // namespace adim
+
+#endif
@@ -0,0 +1,94 @@
+#include <sbpl_adaptive/core/search/adaptive_budget_controller.h>
+
+// standard includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace adim {
+
+AdaptiveBudgetController::AdaptiveBudgetController() :
+    window_size_(50),
+    min_samples_(5),
+    quantile_(0.95),
+    slack_(1.5),
+    min_budget_(0.01),
+    mutex_(),
+    samples_()
+{
+    std::fill(growth_, growth_ + NUM_PHASES, 1.0);
+}
+
+void AdaptiveBudgetController::setWindowSize(size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_size_ = std::max(size, (size_t)1);
+    for (std::deque<double> &samples : samples_) {
+        while (samples.size() > window_size_) {
+            samples.pop_front();
+        }
+    }
+}
+
+double AdaptiveBudgetController::budget(Phase phase, double max_budget) const
+{
+    std::vector<double> samples;
+    double growth;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (samples_[phase].size() < min_samples_ || samples_[phase].empty()) {
+            return max_budget;
+        }
+        samples.assign(samples_[phase].begin(), samples_[phase].end());
+        growth = growth_[phase];
+    }
+
+    const double q = std::min(std::max(quantile_, 0.0), 1.0);
+    const size_t n = (size_t)std::ceil(q * (double)samples.size());
+    const size_t k = std::min(std::max(n, (size_t)1), samples.size()) - 1;
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+
+    const double learned = growth * slack_ * samples[k];
+    return std::min(max_budget, std::max(min_budget_, learned));
+}
+
+void AdaptiveBudgetController::recordSuccess(Phase phase, double elapsed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    push(phase, elapsed);
+    growth_[phase] = 1.0;
+}
+
+void AdaptiveBudgetController::recordFailure(Phase phase, double elapsed)
+{
+    // the search needed at least the time it was given, and likely more; the
+    // growth is bounded so that it stays finite over long runs of failures
+    std::lock_guard<std::mutex> lock(mutex_);
+    push(phase, elapsed);
+    growth_[phase] = std::min(growth_[phase] * std::max(slack_, 1.0), 1e6);
+}
+
+size_t AdaptiveBudgetController::numSamples(Phase phase) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_[phase].size();
+}
+
+void AdaptiveBudgetController::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::deque<double> &samples : samples_) {
+        samples.clear();
+    }
+    std::fill(growth_, growth_ + NUM_PHASES, 1.0);
+}
+
+void AdaptiveBudgetController::push(Phase phase, double sample)
+{
+    samples_[phase].push_back(sample);
+    if (samples_[phase].size() > window_size_) {
+        samples_[phase].pop_front();
+    }
+}
+
+} // namespace adim
@@ -1,9 +1,13 @@
 #include <sbpl_adaptive/core/search/adaptive_planner.h>
 
 // standard includes
+#include <limits.h>
 #include <cmath>
 #include <algorithm>
 
+// project includes
+#include <sbpl_adaptive/core/search/traplanner.h>
+
 namespace adim {
 
 static const char *LOG = "adaptive_planner";
@@ -24,9 +28,13 @@ AdaptivePlanner::AdaptivePlanner(
     forward_search_(forward_search),
     time_per_retry_plan_(5.0),
     time_per_retry_track_(5.0),
+    budget_controller_(),
+    plan_budget_(5.0),
+    track_budget_(5.0),
     target_eps_(-1.0),
     planning_eps_(1.0),
     tracking_eps_(1.0),
+    incremental_planning_(false),
     start_state_id_(-1),
     goal_state_id_(-1),
     stat_(),
@@ -34,6 +42,7 @@ AdaptivePlanner::AdaptivePlanner(
     final_eps_(-1.0),
     search_expands_(0),
     num_iterations_(0),
+    trace_(),
     plan_mode_(PLANNING),
     iteration_(-1),
     plan_sol_(),
@@ -48,21 +57,38 @@ AdaptivePlanner::AdaptivePlanner(
     last_start_state_id_(-1),
     last_goal_state_id_(-1),
     last_plan_iter_(-1),
-    last_track_iter_(-1)
+    last_track_iter_(-1),
+    spec_environment_(nullptr),
+    spec_planner_(),
+    spec_interrupt_(),
+    spec_probe_time_(0.0),
+    sphere_history_(),
+    spec_future_(),
+    spec_iter_(-1),
+    spec_sphere_(-1),
+    spec_adopt_(false),
+    refine_callback_(),
+    refine_time_limit_(0.0),
+    refine_dec_eps_(0.2),
+    refine_thread_(),
+    refine_interrupt_(environment),
+    refine_snapshot_()
 {
     stat_.reset(new AdaptivePlannerCSVStat_c);
 
-    ROS_INFO("Initialize planners...");
+    ROS_DEBUG_NAMED(LOG, "Initialize planners...");
     planner_.reset(plan_search_alloc.make(environment, forward_search));
     planner_->set_search_mode(false);
 
     tracker_.reset(track_search_alloc.make(environment, forward_search));
     tracker_->set_search_mode(false);
-    ROS_INFO("done!");
+    ROS_DEBUG_NAMED(LOG, "done!");
 }
 
 AdaptivePlanner::~AdaptivePlanner()
 {
+    stopRefinement();
+    discardSpeculativePlan();
 }
 
 /// \brief replan a path within the allocated time
@@ -83,13 +109,18 @@ int AdaptivePlanner::replan(
     std::vector<int>* solution,
     int* psolcost)
 {
-    ROS_INFO("Begin Adaptive Planning...");
+    ROS_DEBUG_NAMED(LOG, "Begin Adaptive Planning...");
+
+    stopRefinement();
+
+    // a speculative search still running belongs to the previous query
+    discardSpeculativePlan();
 
     auto start_t = sbpl::clock::now();
     time_per_retry_plan_ = allocated_time_per_retry_plan_;
     time_per_retry_track_ = allocated_time_per_retry_track_;
 
-    ROS_INFO("Retry time limits: (Planning: %.4f) (Tracking: %.4f)", allocated_time_per_retry_plan_, allocated_time_per_retry_track_);
+    ROS_DEBUG_NAMED(LOG, "Retry time limits: (Planning: %.4f) (Tracking: %.4f)", allocated_time_per_retry_plan_, allocated_time_per_retry_track_);
 
     const auto allowed_time = sbpl::to_duration(allocated_time_secs);
     auto time_elapsed = [&](){ return sbpl::clock::now() - start_t; };
@@ -98,10 +129,10 @@ int AdaptivePlanner::replan(
 
     auto it = std::find(track_sol_.begin(), track_sol_.end(), start_state_id_);
     if (last_goal_state_id_ == goal_state_id_ && (
-            (last_start_state_id_ != start_state_id_ && it != plan_sol_.end()) ||
+            (last_start_state_id_ != start_state_id_ && it != track_sol_.end()) ||
             last_start_state_id_ == start_state_id_))
     {
-        ROS_INFO("Skip planning phase and resume tracking from new start state on previous plan solution");
+        ROS_DEBUG_NAMED(LOG, "Skip planning phase and resume tracking from new start state on previous plan solution");
         // in the case where the start has changed, but the goal hasn't, and on
         // a previous tracking iteration we found a (partial) path to the goal=
         // through this new start state, then we skip the planning phase and
@@ -117,7 +148,7 @@ int AdaptivePlanner::replan(
         }
     }
     else {
-        ROS_INFO("Begin plan phase on the first iteration");
+        ROS_DEBUG_NAMED(LOG, "Begin plan phase on the first iteration");
 
         // in all other instances, we begin a new with the first planning
         // iteration
@@ -134,8 +165,13 @@ int AdaptivePlanner::replan(
         time_elapsed_ = sbpl::clock::duration::zero();
         last_plan_iter_ = -1;
         last_track_iter_ = -1;
+        sphere_history_.clear();
+        spec_iter_ = -1;
+        spec_sphere_ = -1;
+        spec_adopt_ = false;
 
         adaptive_environment_->reset();
+        planner_->force_planning_from_scratch();
         pending_spheres_.push_back(start_state_id_);
         pending_spheres_.push_back(goal_state_id_);
 
@@ -158,11 +194,15 @@ int AdaptivePlanner::replan(
     last_goal_state_id_ = goal_state_id_;
     last_start_state_id_ = start_state_id_;
 
+    traceEvent(TraceEvent::QUERY_START, start_state_id_, goal_state_id_);
+
     do {
-        if (time_expired()) {
-            ROS_INFO("Search ran out of time!");
+        if (time_expired() || adaptive_environment_->interruptRequested()) {
+            ROS_DEBUG_NAMED(LOG, "Search ran out of time!");
             solution->clear();
-            ROS_INFO("Done in: %.3f sec", sbpl::to_seconds(time_elapsed()));
+            discardSpeculativePlan();
+            ROS_INFO_NAMED(LOG, "Done in: %.3f sec", sbpl::to_seconds(time_elapsed()));
+            traceEvent(TraceEvent::QUERY_END, 0, sbpl::to_seconds(time_elapsed()));
             num_iterations_ = iteration_;
 
             stat_->setTotalPlanningTime(sbpl::to_seconds(time_elapsed()));
@@ -174,18 +214,24 @@ int AdaptivePlanner::replan(
         case PlanMode::PLANNING: {
             if (onPlanningState(time_remaining(), *solution)) {
                 *psolcost = plan_cost_;
+                discardSpeculativePlan();
+                traceEvent(TraceEvent::QUERY_END, 1, sbpl::to_seconds(time_elapsed()));
+                launchRefinement(*solution, plan_cost_);
                 return true;
             }
         }   break;
         case PlanMode::TRACKING: {
             if (onTrackingState(time_remaining(), *solution)) {
                 *psolcost = track_cost_;
+                discardSpeculativePlan();
+                traceEvent(TraceEvent::QUERY_END, 1, sbpl::to_seconds(time_elapsed()));
+                launchRefinement(*solution, track_cost_);
                 return true;
             }
         }   break;
         }
 
-        ROS_INFO("Total Time so far: %.3f sec", sbpl::to_seconds(time_elapsed()));
+        ROS_DEBUG_NAMED(LOG, "Total Time so far: %.3f sec", sbpl::to_seconds(time_elapsed()));
     } while (true);
 
     stat_->setFinalEps(-1);
@@ -216,13 +262,11 @@ bool AdaptivePlanner::onPlanningState(
     const sbpl::clock::duration time_remaining,
     std::vector<int> &sol)
 {
+    bool try_adopt = false;
     if (iteration_ != last_plan_iter_) {
-        ROS_INFO("=======================================");
-        ROS_INFO("||          Iteration %03d            ||", iteration_);
-        ROS_INFO("=======================================");
-        ROS_INFO("  =======================================");
-        ROS_INFO("  ||          Planning Phase           ||");
-        ROS_INFO("  =======================================");
+        ROS_DEBUG_NAMED(LOG, "Iteration %d: planning phase", iteration_);
+        traceEvent(TraceEvent::ITERATION_START, (int64_t)pending_spheres_.size());
+        traceEvent(TraceEvent::PHASE_START);
 
         plan_sol_.clear();
         plan_cost_ = -1;
@@ -233,33 +277,96 @@ bool AdaptivePlanner::onPlanningState(
 
         planner_->set_initialsolution_eps(planning_eps_);
 
-        planner_->force_planning_from_scratch(); // updated G^ad
+        plan_budget_ = phaseBudget(
+                AdaptiveBudgetController::PLANNING, time_per_retry_plan_);
+
+        // iterations without new spheres follow a change in edge costs, which
+        // the planner has already been informed of
+        if (!incremental_planning_ && !pending_spheres_.empty()) {
+            planner_->force_planning_from_scratch(); // updated G^ad
+        }
 
         adaptive_environment_->setPlanMode();
 
         // add pending new spheres
-        ROS_INFO("Add %zd pending spheres...", pending_spheres_.size());
+        ROS_DEBUG_NAMED(LOG, "Add %zd pending spheres...", pending_spheres_.size());
+        int first_mod_step = INT_MAX;
         for (int stateID : pending_spheres_) {
-            adaptive_environment_->addSphere(stateID, nullptr);
+            if (incremental_planning_) {
+                int mod_step;
+                adaptive_environment_->addSphere(stateID, mod_step);
+                if (mod_step < 0 || first_mod_step < 0) {
+                    first_mod_step = -1; // affected steps unknown
+                }
+                else {
+                    first_mod_step = std::min(first_mod_step, mod_step);
+                }
+            }
+            else {
+                adaptive_environment_->addSphere(stateID, nullptr);
+            }
+            sphere_history_.push_back(stateID);
+            traceEvent(TraceEvent::SPHERE_INSERTED, stateID);
         }
         pending_spheres_.clear();
 
+        if (incremental_planning_ && first_mod_step != INT_MAX) {
+            // discard the search effort affected by the new spheres
+            TRAPlanner *tra = dynamic_cast<TRAPlanner *>(planner_.get());
+            if (tra && first_mod_step >= 0) {
+                ROS_DEBUG_NAMED(LOG, "Restore planning search tree to expansion step %d", first_mod_step);
+                tra->restoreSearchTree(first_mod_step);
+            }
+            else {
+                ROS_DEBUG_NAMED(LOG, "Expansion steps affected by new spheres unknown; plan from scratch");
+                planner_->force_planning_from_scratch();
+            }
+        }
+
         last_plan_iter_ = iteration_;
+        try_adopt = spec_adopt_;
     }
 
     auto plan_start = sbpl::clock::now();
-    ROS_INFO("Still have time (%.3fs)...planning", sbpl::to_seconds(time_remaining));
-    plan_sol_.clear();
-    double allowed_plan_time = time_per_retry_plan_;
+    ROS_DEBUG_NAMED(LOG, "Still have time (%.3fs)...planning", sbpl::to_seconds(time_remaining));
+    double allowed_plan_time = plan_budget_;
     allowed_plan_time = std::min(allowed_plan_time, sbpl::to_seconds(time_remaining));
     allowed_plan_time = std::max(allowed_plan_time, 0.0);
-    int p_ret = planner_->replan(allowed_plan_time, &plan_sol_, &plan_cost_);
+    int p_ret;
+    bool adopted = false;
+    if (try_adopt && adoptSpeculativePlan()) {
+        ROS_DEBUG_NAMED(LOG, "Adopted speculative plan for iteration %d", iteration_);
+        p_ret = 1;
+        adopted = true;
+    }
+    else {
+        plan_sol_.clear();
+        p_ret = planner_->replan(allowed_plan_time, &plan_sol_, &plan_cost_);
+    }
     auto plan_time = sbpl::clock::now() - plan_start;
     stat_->addPlanningPhaseTime(sbpl::to_seconds(plan_time));
     plan_elapsed_ += plan_time;
     iter_elapsed_ += plan_time;
     time_elapsed_ += plan_time;
-    ROS_INFO("Planner done in %.3fs...", sbpl::to_seconds(plan_time));
+    ROS_DEBUG_NAMED(LOG, "Planner done in %.3fs...", sbpl::to_seconds(plan_time));
+    if (!adopted) {
+        traceEvent(TraceEvent::SEARCH, planner_->get_n_expands(), sbpl::to_seconds(plan_time));
+    }
+
+    if (budget_controller_ && !adopted &&
+        !adaptive_environment_->interruptRequested())
+    {
+        if (p_ret && !plan_sol_.empty()) {
+            budget_controller_->recordSuccess(
+                    AdaptiveBudgetController::PLANNING,
+                    sbpl::to_seconds(plan_time));
+        }
+        else if (allowed_plan_time >= plan_budget_) {
+            budget_controller_->recordFailure(
+                    AdaptiveBudgetController::PLANNING,
+                    sbpl::to_seconds(plan_time));
+        }
+    }
 
     // TODO: should distinguish 'no solution exists' here
 
@@ -267,6 +374,7 @@ bool AdaptivePlanner::onPlanningState(
         // TODO: an empty solution may be the correct solution and should
         // report success and a correct suboptimality bound
         ROS_ERROR("Solution could not be found within the allowed time (%.3fs.) after %d iterations", allowed_plan_time, iteration_);
+        traceEvent(TraceEvent::PHASE_END, 0, sbpl::to_seconds(plan_elapsed_));
         adaptive_environment_->visualizeEnvironment();
         num_iterations_ = iteration_;
         stat_->setFinalEps(-1.0);
@@ -277,12 +385,13 @@ bool AdaptivePlanner::onPlanningState(
 
     adaptive_environment_->visualizeEnvironment();
     adaptive_environment_->visualizeStatePath(&plan_sol_, 0, 120, "planning_path");
+    traceEvent(TraceEvent::PHASE_END, 1, sbpl::to_seconds(plan_elapsed_));
 
     if (adaptive_environment_->isExecutablePath(plan_sol_)) {
         sol = plan_sol_;
 
-        ROS_INFO("Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(time_elapsed_) / (iteration_ + 1.0));
-        ROS_INFO("Done in: %.3f sec", sbpl::to_seconds(time_elapsed_));
+        ROS_DEBUG_NAMED(LOG, "Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(time_elapsed_) / (iteration_ + 1.0));
+        ROS_INFO_NAMED(LOG, "Done in: %.3f sec", sbpl::to_seconds(time_elapsed_));
         num_iterations_ = iteration_;
 
         stat_->setFinalEps(planner_->get_final_epsilon());
@@ -295,7 +404,7 @@ bool AdaptivePlanner::onPlanningState(
         return true;
     }
 
-    ROS_INFO("Signal tracking phase");
+    ROS_DEBUG_NAMED(LOG, "Signal tracking phase");
     plan_mode_ = PlanMode::TRACKING;
     return false;
 }
@@ -323,9 +432,8 @@ bool AdaptivePlanner::onTrackingState(
     std::vector<int> &sol)
 {
     if (iteration_ != last_track_iter_) {
-        ROS_INFO("  =======================================");
-        ROS_INFO("  ||          Tracking Phase           ||");
-        ROS_INFO("  =======================================");
+        ROS_DEBUG_NAMED(LOG, "Iteration %d: tracking phase", iteration_);
+        traceEvent(TraceEvent::PHASE_START);
 
         track_sol_.clear();
         track_cost_ = -1;
@@ -334,6 +442,9 @@ bool AdaptivePlanner::onTrackingState(
 
         tracker_->set_initialsolution_eps(tracking_eps_);
 
+        track_budget_ = phaseBudget(
+                AdaptiveBudgetController::TRACKING, time_per_retry_track_);
+
         tracker_->force_planning_from_scratch(); // updated G^ad
 
         adaptive_environment_->setTrackMode(plan_sol_, plan_cost_, nullptr);
@@ -342,18 +453,34 @@ bool AdaptivePlanner::onTrackingState(
     }
 
     auto track_start = sbpl::clock::now();
-    ROS_INFO("Still have time (%.3fs)...tracking", sbpl::to_seconds(time_remaining));
+    ROS_DEBUG_NAMED(LOG, "Still have time (%.3fs)...tracking", sbpl::to_seconds(time_remaining));
     track_sol_.clear();
-    double allowed_track_time = time_per_retry_track_ - sbpl::to_seconds(track_elapsed_);
+    double allowed_track_time = track_budget_ - sbpl::to_seconds(track_elapsed_);
     allowed_track_time = std::min(allowed_track_time, sbpl::to_seconds(time_remaining));
     allowed_track_time = std::max(allowed_track_time, 0.0);
+
+    // run the tracker for a short probe before predicting where it will fail
+    const bool probe = spec_planner_ && spec_iter_ != iteration_ + 1;
+    if (probe) {
+        const double probe_time = spec_probe_time_ > 0.0 ?
+                spec_probe_time_ : 0.25 * track_budget_;
+        allowed_track_time = std::min(allowed_track_time, probe_time);
+    }
+
     int t_ret = tracker_->replan(allowed_track_time, &track_sol_, &track_cost_);
     auto track_time = sbpl::clock::now() - track_start;
-    stat_->addTrackingPhaseTime(sbpl::to_seconds(track_elapsed_));
     track_elapsed_ += track_time;
     iter_elapsed_ += track_time;
     time_elapsed_ += track_time;
-    ROS_INFO("Tracker done in %.3fs...", sbpl::to_seconds(track_time));
+    stat_->addTrackingPhaseTime(sbpl::to_seconds(track_time));
+    ROS_DEBUG_NAMED(LOG, "Tracker done in %.3fs...", sbpl::to_seconds(track_time));
+    traceEvent(TraceEvent::SEARCH, tracker_->get_n_expands(), sbpl::to_seconds(track_time));
+
+    if (probe && !t_ret &&
+        sbpl::to_seconds(track_elapsed_) < track_budget_)
+    {
+        launchSpeculativePlan();
+    }
 
     adaptive_environment_->visualizeEnvironment();
     adaptive_environment_->visualizeStatePath(&track_sol_, 240, 300, "tracking_path");
@@ -361,10 +488,11 @@ bool AdaptivePlanner::onTrackingState(
     if (t_ret) {
         const double target_eps = tracking_eps_ * planning_eps_;
         const double cost_ratio = (double)track_cost_ / (double)plan_cost_;
+        traceEvent(TraceEvent::COST_RATIO, track_cost_, cost_ratio);
         if (cost_ratio <= target_eps) {
-            ROS_INFO("Tracking succeeded! - good path found! tCost %d / pCost %d (eps: %.3f, target: %.3f)", track_cost_, plan_cost_, cost_ratio, target_eps);
+            ROS_DEBUG_NAMED(LOG, "Tracking succeeded! - good path found! tCost %d / pCost %d (eps: %.3f, target: %.3f)", track_cost_, plan_cost_, cost_ratio, target_eps);
             sol = track_sol_;
-            ROS_INFO("Done in: %.3f sec", sbpl::to_seconds(time_elapsed_));
+            ROS_INFO_NAMED(LOG, "Done in: %.3f sec", sbpl::to_seconds(time_elapsed_));
             num_iterations_ = iteration_;
             stat_->setFinalEps(planner_->get_final_epsilon() * tracker_->get_final_epsilon());
             stat_->setFinalPlanCost(plan_cost_);
@@ -374,41 +502,52 @@ bool AdaptivePlanner::onTrackingState(
             stat_->setTotalPlanningTime(sbpl::to_seconds(time_elapsed_));
             stat_->setPlanSize(sol.size());
             if (track_sol_.back() == goal_state_id_) {
-                ROS_INFO("[Planning] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(plan_elapsed_), 100.0 * sbpl::to_seconds(plan_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-                ROS_INFO("[Tracking] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(track_elapsed_), 100.0 * sbpl::to_seconds(track_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-                ROS_INFO("Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(iter_elapsed_) / (iteration_ + 1.0));
+                if (budget_controller_) {
+                    budget_controller_->recordSuccess(
+                            AdaptiveBudgetController::TRACKING,
+                            sbpl::to_seconds(track_elapsed_));
+                }
+                traceEvent(TraceEvent::PHASE_END, 1, sbpl::to_seconds(track_elapsed_));
+                logIterationTimes();
             }
-            else if (sbpl::to_seconds(track_elapsed_) >= time_per_retry_track_) {
+            else if (sbpl::to_seconds(track_elapsed_) >= track_budget_) {
                 // partial solution and time for tracking has expired
+                traceEvent(TraceEvent::PARTIAL_PATH, (int64_t)track_sol_.size(), track_sol_.back());
+                traceEvent(TraceEvent::PHASE_END, 0, sbpl::to_seconds(track_elapsed_));
                 iteration_++;
-                ROS_INFO("Signal planning phase");
+                ROS_DEBUG_NAMED(LOG, "Signal planning phase");
                 plan_mode_ = PlanMode::PLANNING;
-                ROS_INFO("[Planning] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(plan_elapsed_), 100.0 * sbpl::to_seconds(plan_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-                ROS_INFO("[Tracking] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(track_elapsed_), 100.0 * sbpl::to_seconds(track_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-                ROS_INFO("Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(iter_elapsed_) / (iteration_ + 1.0));
+                logIterationTimes();
             }
             return true;
         }
 
-        if (sbpl::to_seconds(track_elapsed_) >= time_per_retry_track_) {
+        if (sbpl::to_seconds(track_elapsed_) >= track_budget_) {
             // introduce new spheres since tracker found a costly path
-            ROS_INFO("Tracking succeeded - costly path found! tCost %d / pCost %d (eps: %.3f, target: %.3f)", track_cost_, plan_cost_, cost_ratio, target_eps);
+            ROS_DEBUG_NAMED(LOG, "Tracking succeeded - costly path found! tCost %d / pCost %d (eps: %.3f, target: %.3f)", track_cost_, plan_cost_, cost_ratio, target_eps);
             adaptive_environment_->processCostlyPath(plan_sol_, track_sol_, &pending_spheres_);
             if (pending_spheres_.empty()) {
                 ROS_ERROR("No new spheres added during this planning episode!!!");
                 throw SBPL_Exception();
             }
+            traceEvent(TraceEvent::PHASE_END, 0, sbpl::to_seconds(track_elapsed_));
             iteration_++;
-            ROS_INFO("Signal planning phase");
+            ROS_DEBUG_NAMED(LOG, "Signal planning phase");
             plan_mode_ = PlanMode::PLANNING;
-            ROS_INFO("[Planning] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(plan_elapsed_), 100.0 * sbpl::to_seconds(plan_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-            ROS_INFO("[Tracking] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(track_elapsed_), 100.0 * sbpl::to_seconds(track_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-            ROS_INFO("Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(iter_elapsed_) / (iteration_ + 1.0));
+            logIterationTimes();
         }
     }
     else {
-        ROS_WARN("Tracking Failed!");
-        if (sbpl::to_seconds(track_elapsed_) >= time_per_retry_track_) {
+        ROS_DEBUG_NAMED(LOG, "Tracking Failed!");
+        if (sbpl::to_seconds(track_elapsed_) >= track_budget_) {
+            if (budget_controller_ &&
+                !adaptive_environment_->interruptRequested())
+            {
+                budget_controller_->recordFailure(
+                        AdaptiveBudgetController::TRACKING,
+                        sbpl::to_seconds(track_elapsed_));
+            }
+
             if (track_sol_.empty()) {
                 ROS_ERROR("No new spheres added during this planning episode!!!");
                 throw SBPL_Exception();
@@ -420,24 +559,72 @@ bool AdaptivePlanner::onTrackingState(
             // a complete path to the goal was not found
             int TrackFail_StateID = track_sol_.back();
             pending_spheres_.push_back(TrackFail_StateID);
-            ROS_INFO("Signal planning phase");
+            traceEvent(TraceEvent::PARTIAL_PATH, (int64_t)track_sol_.size(), TrackFail_StateID);
+            traceEvent(TraceEvent::PHASE_END, 0, sbpl::to_seconds(track_elapsed_));
+            spec_adopt_ =
+                    spec_iter_ == iteration_ + 1 &&
+                    spec_sphere_ == TrackFail_StateID;
+            ROS_DEBUG_NAMED(LOG, "Signal planning phase");
             plan_mode_ = PlanMode::PLANNING;
             iteration_++;
-            ROS_INFO("[Planning] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(plan_elapsed_), 100.0 * sbpl::to_seconds(plan_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-            ROS_INFO("[Tracking] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(track_elapsed_), 100.0 * sbpl::to_seconds(track_elapsed_) / sbpl::to_seconds(iter_elapsed_));
-            ROS_INFO("Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(iter_elapsed_) / (iteration_ + 1.0));
+            logIterationTimes();
         }
     }
 
     return false;
 }
 
+// Log the breakdown of the time consumed by the current iteration.
+void AdaptivePlanner::logIterationTimes() const
+{
+    ROS_DEBUG_NAMED(LOG, "[Planning] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(plan_elapsed_), 100.0 * sbpl::to_seconds(plan_elapsed_) / sbpl::to_seconds(iter_elapsed_));
+    ROS_DEBUG_NAMED(LOG, "[Tracking] Time: %.3fs (%.1f%% of iter time)", sbpl::to_seconds(track_elapsed_), 100.0 * sbpl::to_seconds(track_elapsed_) / sbpl::to_seconds(iter_elapsed_));
+    ROS_DEBUG_NAMED(LOG, "Iteration Time: %.3f sec (avg: %.3f)", sbpl::to_seconds(iter_elapsed_), sbpl::to_seconds(iter_elapsed_) / (iteration_ + 1.0));
+}
+
+/// Record events of the search into \p trace. A null trace disables tracing.
+/// Events are only recorded while the trace is enabled (see
+/// PlannerTrace::enable()).
+void AdaptivePlanner::set_trace(const PlannerTracePtr &trace)
+{
+    trace_ = trace;
+}
+
+/// Inform the planner of a change in edge costs. The spheres introduced so far
+/// are kept and the change is forwarded to the planning and tracking searches
+/// so that they may repair their search trees. If a query is in progress or
+/// was solved, the next call to replan() with the same goal begins a new
+/// iteration, from the planning phase, to repair the solution.
+void AdaptivePlanner::costs_changed(const StateChangeQuery &stateChange)
+{
+    stopRefinement();
+
+    // the speculative search ran on the old costs
+    discardSpeculativePlan();
+    spec_iter_ = -1;
+    spec_sphere_ = -1;
+
+    planner_->costs_changed(stateChange);
+    tracker_->costs_changed(stateChange);
+
+    if (iteration_ < 0) {
+        return;
+    }
+
+    if (plan_mode_ == PlanMode::TRACKING || iteration_ == last_plan_iter_) {
+        iteration_++;
+    }
+    plan_mode_ = PlanMode::PLANNING;
+    ROS_DEBUG_NAMED(LOG, "Costs changed; repair from iteration %d", iteration_);
+}
+
 /// Set the goal state for the search
 /// \return 1 if successful; 0 otherwise
 int AdaptivePlanner::set_goal(int goal_stateID)
 {
+    stopRefinement();
     goal_state_id_ = goal_stateID;
-    ROS_INFO("goal set (StateID: %d)", goal_stateID);
+    ROS_DEBUG_NAMED(LOG, "goal set (StateID: %d)", goal_stateID);
     return 1;
 }
 
@@ -445,8 +632,9 @@ int AdaptivePlanner::set_goal(int goal_stateID)
 /// \return 1 if successful; 0 otherwise
 int AdaptivePlanner::set_start(int start_stateID)
 {
+    stopRefinement();
     start_state_id_ = start_stateID;
-    ROS_INFO("start set (StateID: %d)", start_stateID);
+    ROS_DEBUG_NAMED(LOG, "start set (StateID: %d)", start_stateID);
     return 1;
 }
 
@@ -455,7 +643,8 @@ int AdaptivePlanner::set_start(int start_stateID)
 /// \return 1 if successful; 0 otherwise
 int AdaptivePlanner::force_planning_from_scratch()
 {
-    ROS_INFO("Reset planner and tracker_!");
+    stopRefinement();
+    ROS_DEBUG_NAMED(LOG, "Reset planner and tracker_!");
     last_start_state_id_ = -1;
     last_goal_state_id_ = -1;
     stat_->reset();
@@ -468,6 +657,7 @@ int AdaptivePlanner::force_planning_from_scratch()
 /// solution as time allows.
 int AdaptivePlanner::set_search_mode(bool bSearchUntilFirstSolution)
 {
+    stopRefinement();
     planner_->set_search_mode(bSearchUntilFirstSolution);
     tracker_->set_search_mode(bSearchUntilFirstSolution);
     return 1;
@@ -482,11 +672,463 @@ bool AdaptivePlanner::set_time_per_retry(double t_plan, double t_track)
     return true;
 }
 
+/// Set the controller used to tune the time limits of the planning and
+/// tracking searches of each iteration. The time limits given via
+/// set_time_per_retry() or replan() bound the tuned limits from above. A null
+/// controller restores the fixed time limits.
+void AdaptivePlanner::set_budget_controller(
+    const AdaptiveBudgetControllerPtr &controller)
+{
+    budget_controller_ = controller;
+}
+
+// Return the time limit for the search of a phase of the current iteration.
+double AdaptivePlanner::phaseBudget(
+    AdaptiveBudgetController::Phase phase,
+    double limit) const
+{
+    if (!budget_controller_) {
+        return limit;
+    }
+    const double budget = budget_controller_->budget(phase, limit);
+    ROS_DEBUG_NAMED(LOG, "%s budget: %.3fs (limit: %.3fs)", phase == AdaptiveBudgetController::PLANNING ? "Planning" : "Tracking", budget, limit);
+    return budget;
+}
+
+/// Enable speculative planning. While the tracking phase of an iteration is
+/// running, the planning phase of the next iteration is searched on a second
+/// thread, assuming that tracking will fail at the best state the tracker has
+/// seen after an initial probe of \p probe_time seconds.
+///
+/// \param spec_space A replica of the planner's environment, used exclusively
+///     by the speculative search. Both environments must support
+///     translateStateID() with respect to each other; if either does not,
+///     speculative planning is not enabled and tracking runs unchanged.
+/// \param spec_search_alloc The allocator for the speculative planning search
+/// \param probe_time The time the tracker runs before a speculative search is
+///     launched. If non-positive, a quarter of the tracking time limit is used.
+/// \return true if speculative planning was enabled; false otherwise
+bool AdaptivePlanner::enableSpeculativePlanning(
+    AdaptiveDiscreteSpace *spec_space,
+    const PlannerAllocator &spec_search_alloc,
+    double probe_time)
+{
+    if (!spec_space || spec_space == adaptive_environment_) {
+        ROS_ERROR_NAMED(LOG, "Speculative planning requires a separate replica of the environment");
+        return false;
+    }
+
+    if (!adaptive_environment_->supportsStateTranslation() ||
+        !spec_space->supportsStateTranslation())
+    {
+        ROS_ERROR_NAMED(LOG, "Speculative planning requires environments that support state translation");
+        return false;
+    }
+
+    stopRefinement();
+    disableSpeculativePlanning();
+
+    spec_planner_.reset(spec_search_alloc.make(spec_space, forward_search_));
+    if (!spec_planner_) {
+        ROS_ERROR_NAMED(LOG, "Failed to allocate speculative planner");
+        return false;
+    }
+    spec_planner_->set_search_mode(false);
+    spec_environment_ = spec_space;
+    spec_interrupt_.reset(spec_space);
+    spec_probe_time_ = probe_time;
+    return true;
+}
+
+void AdaptivePlanner::disableSpeculativePlanning()
+{
+    discardSpeculativePlan();
+    spec_planner_.reset();
+    spec_environment_ = nullptr;
+    spec_interrupt_.reset(nullptr);
+    spec_iter_ = -1;
+    spec_sphere_ = -1;
+}
+
+// Launch a planning search for the next iteration on the replica environment,
+// assuming a sphere will be introduced at the best state seen by the tracker.
+// Must be called from the thread running the tracker, while it is not running.
+bool AdaptivePlanner::launchSpeculativePlan()
+{
+    // the replica may only be used by one speculative search at a time
+    discardSpeculativePlan();
+
+    // mark this iteration as attempted, whether or not the launch succeeds
+    spec_iter_ = iteration_ + 1;
+    spec_sphere_ = -1;
+
+    const int best_state_id = adaptive_environment_->getBestSeenState();
+    if (best_state_id < 0) {
+        return false;
+    }
+
+    auto translate = [&](int state_id) {
+        return spec_environment_->translateStateID(
+                *adaptive_environment_, state_id);
+    };
+
+    const int spec_start_id = translate(start_state_id_);
+    const int spec_goal_id = translate(goal_state_id_);
+    if (spec_start_id < 0 || spec_goal_id < 0) {
+        ROS_WARN_NAMED(LOG, "Failed to translate start/goal to the speculative environment");
+        return false;
+    }
+
+    std::vector<int> spheres;
+    spheres.reserve(sphere_history_.size() + 1);
+    for (int state_id : sphere_history_) {
+        spheres.push_back(translate(state_id));
+    }
+    spheres.push_back(translate(best_state_id));
+    if (std::find(spheres.begin(), spheres.end(), -1) != spheres.end()) {
+        ROS_WARN_NAMED(LOG, "Failed to translate spheres to the speculative environment");
+        return false;
+    }
+
+    spec_sphere_ = best_state_id;
+
+    const double eps = planning_eps_;
+    const double time_limit = plan_budget_;
+    spec_future_ = std::async(std::launch::async,
+            [this, spheres, spec_start_id, spec_goal_id, eps, time_limit]()
+    {
+        SpeculativePlan plan;
+        plan.ret = 0;
+        plan.cost = -1;
+
+        spec_environment_->reset();
+        spec_environment_->setPlanMode();
+        for (int state_id : spheres) {
+            spec_environment_->addSphere(state_id, nullptr);
+        }
+
+        spec_planner_->set_initialsolution_eps(eps);
+        spec_planner_->force_planning_from_scratch();
+        if (!spec_planner_->set_start(spec_start_id) ||
+            !spec_planner_->set_goal(spec_goal_id))
+        {
+            return plan;
+        }
+
+        plan.ret = spec_planner_->replan(time_limit, &plan.sol, &plan.cost);
+        return plan;
+    });
+
+    ROS_DEBUG_NAMED(LOG, "Launched speculative planning for iteration %d (predicted sphere: %d)", spec_iter_, spec_sphere_);
+    return true;
+}
+
+// Wait for the speculative planning search for the current iteration and
+// store its solution, if any, as the planning phase solution.
+bool AdaptivePlanner::adoptSpeculativePlan()
+{
+    spec_adopt_ = false;
+    if (spec_iter_ != iteration_ || !spec_future_.valid()) {
+        return false;
+    }
+
+    SpeculativePlan plan;
+    try {
+        plan = spec_future_.get();
+    }
+    catch (const std::exception &ex) {
+        ROS_WARN_NAMED(LOG, "Speculative planning failed: %s", ex.what());
+        return false;
+    }
+
+    if (!plan.ret || plan.sol.empty()) {
+        return false;
+    }
+
+    std::vector<int> sol;
+    sol.reserve(plan.sol.size());
+    for (int spec_state_id : plan.sol) {
+        int state_id = adaptive_environment_->translateStateID(
+                *spec_environment_, spec_state_id);
+        if (state_id < 0) {
+            return false;
+        }
+        sol.push_back(state_id);
+    }
+
+    plan_sol_ = std::move(sol);
+    plan_cost_ = plan.cost;
+    return true;
+}
+
+// Stop any running speculative search and drop its result.
+void AdaptivePlanner::discardSpeculativePlan()
+{
+    spec_adopt_ = false;
+    if (spec_future_.valid()) {
+        spec_interrupt_.raise();
+        spec_future_.wait();
+        spec_interrupt_.clear();
+        spec_future_ = std::future<SpeculativePlan>();
+    }
+}
+
+/// Enable background refinement. Once replan() returns a solution, the search
+/// continues on a background thread for up to \p time_limit seconds, and each
+/// cheaper solution found is passed to \p callback, from that thread.
+///
+/// The refinement first continues the tracking search that produced the
+/// solution, allowing it to lower its suboptimality bound. Then, for as long as
+/// time allows, the bounds of both phases are lowered by \p dec_eps (down to
+/// 1), new spheres are introduced along the costly stretches of the best
+/// solution, and iterations are run until a solution satisfying the tightened
+/// bound is found.
+///
+/// The refinement modifies the state and statistics of the planner and the
+/// spheres of the environment, and is stopped before any call that modifies
+/// the planner, or explicitly via stopRefinement(). The planner state and
+/// statistics from before the refinement are then restored, the environment
+/// is reset to the spheres introduced before the refinement, and the phase
+/// searches start from scratch.
+void AdaptivePlanner::enableBackgroundRefinement(
+    const SolutionCallback &callback,
+    double time_limit,
+    double dec_eps)
+{
+    stopRefinement();
+    refine_callback_ = callback;
+    refine_time_limit_ = time_limit;
+    refine_dec_eps_ = dec_eps > 0.0 ? dec_eps : 0.2;
+}
+
+void AdaptivePlanner::disableBackgroundRefinement()
+{
+    stopRefinement();
+    refine_callback_ = SolutionCallback();
+}
+
+/// Block until the background refinement has finished on its own.
+void AdaptivePlanner::waitForRefinement()
+{
+    if (!refine_thread_.joinable()) {
+        return;
+    }
+    refine_thread_.join();
+    restoreRefinementSnapshot();
+}
+
+/// Interrupt the background refinement and wait for it to stop.
+void AdaptivePlanner::stopRefinement()
+{
+    if (!refine_thread_.joinable()) {
+        return;
+    }
+    refine_interrupt_.raise();
+    refine_thread_.join();
+    refine_interrupt_.clear();
+    restoreRefinementSnapshot();
+}
+
+void AdaptivePlanner::launchRefinement(const std::vector<int> &solution, int cost)
+{
+    if (!refine_callback_ || refine_time_limit_ <= 0.0 || solution.empty()) {
+        return;
+    }
+    saveRefinementSnapshot();
+    refine_thread_ = std::thread(&AdaptivePlanner::refine, this, solution, cost);
+}
+
+void AdaptivePlanner::saveRefinementSnapshot()
+{
+    RefinementSnapshot &snap = refine_snapshot_;
+    snap.plan_budget = plan_budget_;
+    snap.track_budget = track_budget_;
+    snap.planning_eps = planning_eps_;
+    snap.tracking_eps = tracking_eps_;
+    snap.stat = *stat_;
+    snap.final_eps_planning_time = final_eps_planning_time_;
+    snap.final_eps = final_eps_;
+    snap.search_expands = search_expands_;
+    snap.num_iterations = num_iterations_;
+    snap.plan_mode = plan_mode_;
+    snap.iteration = iteration_;
+    snap.plan_sol = plan_sol_;
+    snap.plan_cost = plan_cost_;
+    snap.track_sol = track_sol_;
+    snap.track_cost = track_cost_;
+    snap.pending_spheres = pending_spheres_;
+    snap.iter_elapsed = iter_elapsed_;
+    snap.plan_elapsed = plan_elapsed_;
+    snap.track_elapsed = track_elapsed_;
+    snap.time_elapsed = time_elapsed_;
+    snap.last_plan_iter = last_plan_iter_;
+    snap.last_track_iter = last_track_iter_;
+    snap.sphere_history = sphere_history_;
+}
+
+// Undo the effects of the refinement once its thread has been joined
+void AdaptivePlanner::restoreRefinementSnapshot()
+{
+    // speculative searches launched by the refinement plan for its iterations
+    discardSpeculativePlan();
+    spec_iter_ = -1;
+    spec_sphere_ = -1;
+
+    RefinementSnapshot &snap = refine_snapshot_;
+    plan_budget_ = snap.plan_budget;
+    track_budget_ = snap.track_budget;
+    planning_eps_ = snap.planning_eps;
+    tracking_eps_ = snap.tracking_eps;
+    *stat_ = snap.stat;
+    final_eps_planning_time_ = snap.final_eps_planning_time;
+    final_eps_ = snap.final_eps;
+    search_expands_ = snap.search_expands;
+    num_iterations_ = snap.num_iterations;
+    plan_mode_ = snap.plan_mode;
+    iteration_ = snap.iteration;
+    plan_sol_.swap(snap.plan_sol);
+    plan_cost_ = snap.plan_cost;
+    track_sol_.swap(snap.track_sol);
+    track_cost_ = snap.track_cost;
+    pending_spheres_.swap(snap.pending_spheres);
+    iter_elapsed_ = snap.iter_elapsed;
+    plan_elapsed_ = snap.plan_elapsed;
+    track_elapsed_ = snap.track_elapsed;
+    time_elapsed_ = snap.time_elapsed;
+    last_plan_iter_ = snap.last_plan_iter;
+    last_track_iter_ = snap.last_track_iter;
+    sphere_history_.swap(snap.sphere_history);
+
+    // the environment has no means to remove spheres; rebuild it from the
+    // spheres introduced before the refinement
+    adaptive_environment_->reset();
+    for (int state_id : sphere_history_) {
+        adaptive_environment_->addSphere(state_id, nullptr);
+    }
+    if (plan_mode_ == PlanMode::TRACKING && last_track_iter_ == iteration_) {
+        adaptive_environment_->setTrackMode(plan_sol_, plan_cost_, nullptr);
+    }
+    else {
+        adaptive_environment_->setPlanMode();
+    }
+
+    // the search trees were grown on the refined graph
+    planner_->force_planning_from_scratch();
+    tracker_->force_planning_from_scratch();
+}
+
+// Improve upon a solution to the current query until time runs out or the
+// refinement is interrupted. Runs on refine_thread_.
+void AdaptivePlanner::refine(std::vector<int> best_sol, int best_cost)
+{
+    const auto start = sbpl::clock::now();
+    const auto allowed_time = sbpl::to_duration(refine_time_limit_);
+    auto time_remaining = [&]() { return allowed_time - (sbpl::clock::now() - start); };
+    auto stopped = [&]() {
+        return time_remaining() <= sbpl::clock::duration::zero() ||
+                adaptive_environment_->interruptRequested();
+    };
+
+    auto publish = [&](const std::vector<int> &sol, int cost) {
+        if (sol.empty() || sol.back() != goal_state_id_ || cost >= best_cost) {
+            return;
+        }
+        best_sol = sol;
+        best_cost = cost;
+        ROS_DEBUG_NAMED(LOG, "Refinement found a solution of cost %d", cost);
+        refine_callback_(best_sol, best_cost);
+    };
+
+    try {
+        // continue the tracking search that produced the solution
+        if (plan_mode_ == PlanMode::TRACKING && !stopped()) {
+            std::vector<int> sol;
+            int cost;
+            double allowed_track_time = std::min(
+                    time_per_retry_track_, sbpl::to_seconds(time_remaining()));
+            if (tracker_->replan(allowed_track_time, &sol, &cost) &&
+                !sol.empty() && sol.back() == goal_state_id_)
+            {
+                track_sol_ = sol;
+                track_cost_ = cost;
+                publish(sol, cost);
+            }
+        }
+
+        // tighten the bounds and introduce spheres along costly stretches
+        while (!stopped() && (planning_eps_ > 1.0 || tracking_eps_ > 1.0)) {
+            planning_eps_ = std::max(1.0, planning_eps_ - refine_dec_eps_);
+            tracking_eps_ = std::max(1.0, tracking_eps_ - refine_dec_eps_);
+
+            if (plan_mode_ == PlanMode::TRACKING) {
+                adaptive_environment_->processCostlyPath(
+                        plan_sol_, track_sol_, &pending_spheres_);
+            }
+            iteration_++;
+            plan_mode_ = PlanMode::PLANNING;
+
+            std::vector<int> sol;
+            bool found = false;
+            while (!found && !stopped()) {
+                if (plan_mode_ == PlanMode::PLANNING) {
+                    found = onPlanningState(time_remaining(), sol);
+                }
+                else {
+                    found = onTrackingState(time_remaining(), sol);
+                }
+            }
+            if (!found) {
+                break;
+            }
+            publish(sol, plan_mode_ == PlanMode::PLANNING ? plan_cost_ : track_cost_);
+        }
+    }
+    catch (const std::exception &ex) {
+        ROS_WARN_NAMED(LOG, "Background refinement failed: %s", ex.what());
+    }
+
+    ROS_DEBUG_NAMED(LOG, "Refinement done in %.3f sec (best cost: %d)", sbpl::to_seconds(sbpl::clock::now() - start), best_cost);
+}
+
+/// Enable or disable incremental planning. When enabled, the planning search
+/// tree is restored to the earliest expansion step affected by the spheres
+/// introduced between iterations, rather than discarded. This requires the
+/// planning search to be a TRAPlanner and the environment to report affected
+/// expansion steps via addSphere(int, int&).
+/// \return true if successful; false otherwise
+bool AdaptivePlanner::set_incremental_planning(bool enabled)
+{
+    if (enabled && !dynamic_cast<TRAPlanner *>(planner_.get())) {
+        ROS_ERROR_NAMED(LOG, "Incremental planning requires a TRAPlanner planning search");
+        return false;
+    }
+    incremental_planning_ = enabled;
+    return true;
+}
+
+/// Set the suboptimality bounds of the planning and tracking searches
+/// individually. The bound for the search as a whole is their product.
+/// \return true if successful; false otherwise
+bool AdaptivePlanner::set_phase_eps(double planning_eps, double tracking_eps)
+{
+    if (planning_eps < 1.0 || tracking_eps < 1.0) {
+        return false;
+    }
+    stopRefinement();
+    target_eps_ = planning_eps * tracking_eps;
+    planning_eps_ = planning_eps;
+    tracking_eps_ = tracking_eps;
+    planner_->set_initialsolution_eps(planning_eps_);
+    tracker_->set_initialsolution_eps(tracking_eps_);
+    return true;
+}
+
 /// Set the desired suboptimality bound for search as a whole. Each underlying
 /// search will have its suboptimality bound set to the sqrt(\p
 /// initialsolution_eps)
 void AdaptivePlanner::set_initialsolution_eps(double initialsolution_eps)
 {
+    stopRefinement();
     target_eps_ = initialsolution_eps;
     planning_eps_ = std::sqrt(initialsolution_eps);
     tracking_eps_ = std::sqrt(initialsolution_eps);
@@ -0,0 +1,133 @@
+#include <sbpl_adaptive/core/search/adaptive_planner_pool.h>
+
+// standard includes
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// system includes
+#include <ros/console.h>
+
+namespace adim {
+
+static const char *LOG = "adaptive_planner_pool";
+
+AdaptivePlannerPool::AdaptivePlannerPool(bool forward_search) :
+    forward_search_(forward_search),
+    workers_()
+{
+}
+
+int AdaptivePlannerPool::addWorker(
+    AdaptiveDiscreteSpace *space,
+    const PlannerAllocator &plan_search_alloc,
+    const PlannerAllocator &track_search_alloc)
+{
+    for (const Worker &worker : workers_) {
+        if (space->sharesMutableState(*worker.space) ||
+            worker.space->sharesMutableState(*space))
+        {
+            ROS_ERROR_NAMED(LOG, "Pool workers may not share an environment or its mutable parts");
+            return -1;
+        }
+    }
+
+    Worker worker;
+    worker.space = space;
+    worker.planner.reset(new AdaptivePlanner(
+            space, plan_search_alloc, track_search_alloc, forward_search_));
+    workers_.push_back(std::move(worker));
+    return (int)workers_.size() - 1;
+}
+
+int AdaptivePlannerPool::replanBatch(
+    size_t num_queries,
+    const QuerySetupFn &setup,
+    double allocated_time_secs,
+    std::vector<BatchResult> *results,
+    const QueryDoneFn &done)
+{
+    results->assign(num_queries, BatchResult());
+    for (BatchResult &result : *results) {
+        result.ret = 0;
+        result.cost = -1;
+        result.worker = -1;
+        result.time = 0.0;
+    }
+
+    if (workers_.empty()) {
+        ROS_ERROR_NAMED(LOG, "Pool has no workers");
+        return 0;
+    }
+
+    std::atomic<size_t> next_query(0);
+    std::atomic<int> num_solved(0);
+    auto work = [&](int i) {
+        for (size_t q = next_query++; q < num_queries; q = next_query++) {
+            BatchResult &result = (*results)[q];
+            runQuery(i, q, setup, allocated_time_secs, result);
+            if (result.ret) {
+                ++num_solved;
+            }
+            if (done) {
+                done(workers_[i].space, q, result);
+            }
+        }
+    };
+
+    const int num_threads = (int)std::min(workers_.size(), num_queries);
+    std::vector<std::thread> threads;
+    threads.reserve(std::max(num_threads - 1, 0));
+    for (int i = 1; i < num_threads; ++i) {
+        threads.emplace_back(work, i);
+    }
+    if (num_threads > 0) {
+        work(0);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    ROS_INFO_NAMED(LOG, "Solved %d/%zu queries with %d workers", (int)num_solved, num_queries, num_threads);
+    return num_solved;
+}
+
+void AdaptivePlannerPool::runQuery(
+    int i,
+    size_t query,
+    const QuerySetupFn &setup,
+    double allocated_time_secs,
+    BatchResult &result)
+{
+    Worker &worker = workers_[i];
+    result.worker = i;
+
+    auto start = sbpl::clock::now();
+    try {
+        int start_id = -1;
+        int goal_id = -1;
+        if (!setup(worker.space, query, start_id, goal_id)) {
+            ROS_WARN_NAMED(LOG, "Failed to set up query %zu", query);
+            return;
+        }
+
+        // queries are independent; never resume the search of the previous one
+        worker.planner->force_planning_from_scratch();
+        if (!worker.planner->set_start(start_id) ||
+            !worker.planner->set_goal(goal_id))
+        {
+            ROS_WARN_NAMED(LOG, "Failed to set start and goal of query %zu", query);
+            return;
+        }
+
+        result.ret = worker.planner->replan(
+                allocated_time_secs, &result.solution, &result.cost);
+    }
+    catch (const std::exception &ex) {
+        ROS_WARN_NAMED(LOG, "Query %zu failed: %s", query, ex.what());
+        result.ret = 0;
+    }
+    result.time = sbpl::to_seconds(sbpl::clock::now() - start);
+}
+
+} // namespace adim
@@ -0,0 +1,117 @@
+#include <sbpl_adaptive/core/search/adaptive_planner_portfolio.h>
+
+// standard includes
+#include <mutex>
+#include <thread>
+
+// system includes
+#include <ros/console.h>
+
+namespace adim {
+
+static const char *LOG = "adaptive_planner_portfolio";
+
+AdaptivePlannerPortfolio::AdaptivePlannerPortfolio(bool forward_search) :
+    forward_search_(forward_search),
+    configs_(),
+    winner_(-1)
+{
+}
+
+int AdaptivePlannerPortfolio::addConfiguration(
+    AdaptiveDiscreteSpace *space,
+    const PlannerAllocator &plan_search_alloc,
+    const PlannerAllocator &track_search_alloc)
+{
+    for (const Configuration &config : configs_) {
+        if (space->sharesMutableState(*config.space) ||
+            config.space->sharesMutableState(*space))
+        {
+            ROS_ERROR_NAMED(LOG, "Portfolio configurations may not share an environment or its mutable parts");
+            return -1;
+        }
+    }
+
+    Configuration config;
+    config.space = space;
+    config.planner.reset(new AdaptivePlanner(
+            space, plan_search_alloc, track_search_alloc, forward_search_));
+    config.interrupt.reset(new InterruptToken(space));
+    config.cost = -1;
+    config.ret = 0;
+    configs_.push_back(std::move(config));
+    return (int)configs_.size() - 1;
+}
+
+int AdaptivePlannerPortfolio::replan(
+    double allocated_time_secs,
+    std::vector<int> *solution,
+    int *solcost)
+{
+    winner_ = -1;
+    if (configs_.empty()) {
+        ROS_ERROR_NAMED(LOG, "Portfolio has no configurations");
+        return 0;
+    }
+
+    for (Configuration &config : configs_) {
+        config.interrupt->clear();
+        config.solution.clear();
+        config.cost = -1;
+        config.ret = 0;
+    }
+
+    std::mutex winner_mutex;
+    auto race = [&](size_t i) {
+        Configuration &config = configs_[i];
+        try {
+            config.ret = config.planner->replan(
+                    allocated_time_secs, &config.solution, &config.cost);
+        }
+        catch (const std::exception &ex) {
+            ROS_WARN_NAMED(LOG, "Configuration %zu failed: %s", i, ex.what());
+            config.ret = 0;
+        }
+
+        if (!config.ret) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(winner_mutex);
+        if (winner_ != -1) {
+            return;
+        }
+        winner_ = (int)i;
+        for (size_t j = 0; j < configs_.size(); ++j) {
+            if (j != i) {
+                configs_[j].interrupt->raise();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(configs_.size() - 1);
+    for (size_t i = 1; i < configs_.size(); ++i) {
+        threads.emplace_back(race, i);
+    }
+    race(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (Configuration &config : configs_) {
+        config.interrupt->clear();
+    }
+
+    if (winner_ == -1) {
+        ROS_INFO_NAMED(LOG, "No configuration found a solution");
+        return 0;
+    }
+
+    ROS_INFO_NAMED(LOG, "Configuration %d won the race (cost: %d)", winner_, configs_[winner_].cost);
+    *solution = configs_[winner_].solution;
+    *solcost = configs_[winner_].cost;
+    return 1;
+}
+
+} // namespace adim
@@ -2,11 +2,11 @@
 
 // standard includes
 #include <assert.h>
+#include <algorithm>
 
 // project includes
 #include <sbpl_adaptive/common.h>
 
-#define ARAMDP_STATEID2IND_AD STATEID2IND_SLOT1
 #define ARA_AD_INCONS_LIST_ID 1
 
 namespace adim {
@@ -15,14 +15,19 @@ SBPLPlanner *ADARAPlannerAllocator::make(
     adim::AdaptiveDiscreteSpace *space,
     bool forward_search) const
 {
-    return new ARAPlanner_AD(space, forward_search);
+    ARAPlanner_AD* planner =
+            new ARAPlanner_AD(space, forward_search, open_list_type_);
+    planner->set_lazy_evaluation(lazy_evaluation_);
+    return planner;
 }
 
 ARAPlanner_AD::ARAPlanner_AD(
     AdaptiveDiscreteSpace* environment,
-    bool bSearchForward)
+    bool bSearchForward,
+    OpenListType open_list_type)
 :
     environment_(environment),
+    open_list_type_(open_list_type),
     finitial_eps(ARA_DEFAULT_INITIAL_EPS),
     finitial_eps_planning_time(-1.0),
     final_eps(-1.0),
@@ -31,10 +36,15 @@ ARAPlanner_AD::ARAPlanner_AD(
     searchexpands(0),
     bforwardsearch(bSearchForward),
     bsearchuntilfirstsolution(false),
+    blazy(false),
+    num_edge_evaluations(0),
+    bbidirectional(false),
     pSearchStateSpace_(NULL),
+    pBackwardSearchStateSpace_(NULL),
+    env_heur_epoch(environment->heuristicEpoch()),
     MaxMemoryCounter(0)
 {
-    pSearchStateSpace_ = new ARASearchStateSpace_t;
+    pSearchStateSpace_ = new ARASearchStateSpace_AD;
 
     // create the ARA planner
     SBPL_INFO("Creating search state space...");
@@ -60,76 +70,86 @@ ARAPlanner_AD::~ARAPlanner_AD()
         DeleteSearchStateSpace(pSearchStateSpace_);
         delete pSearchStateSpace_;
     }
+    if (pBackwardSearchStateSpace_ != NULL) {
+        DeleteSearchStateSpace(pBackwardSearchStateSpace_);
+        delete pBackwardSearchStateSpace_;
+    }
 }
 
-void ARAPlanner_AD::Initialize_searchinfo(
-    CMDPSTATE* state,
-    ARASearchStateSpace_t* pSearchStateSpace)
-{
-    ARAState* searchstateinfo = (ARAState*)state->PlannerSpecificData;
-    searchstateinfo->MDPstate = state;
-    InitializeSearchStateInfo(searchstateinfo, pSearchStateSpace);
-}
-
-CMDPSTATE* ARAPlanner_AD::CreateState(
+ARAState_AD* ARAPlanner_AD::CreateState(
     int stateID,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    CMDPSTATE* state = NULL;
-
-    assert(environment_->StateID2IndexMapping[stateID][ARAMDP_STATEID2IND_AD] == -1);
-
-    // adds to the tail a state
-    state = pSearchStateSpace->searchMDP.AddState(stateID);
+    assert(pSearchStateSpace->state_index[stateID] == -1);
 
     // remember the index of the state
-    environment_->StateID2IndexMapping[stateID][ARAMDP_STATEID2IND_AD] =
-            pSearchStateSpace->searchMDP.StateArray.size() - 1;
+    pSearchStateSpace->state_index[stateID] = (int)pSearchStateSpace->states.size();
 
-    assert(state == pSearchStateSpace->searchMDP.StateArray[environment_->StateID2IndexMapping[stateID][ARAMDP_STATEID2IND_AD]]);
-
-    // create search specific info
-    state->PlannerSpecificData = (ARAState*)malloc(sizeof(ARAState));
-    Initialize_searchinfo(state, pSearchStateSpace);
-    MaxMemoryCounter += sizeof(ARAState);
+    ARAState_AD* state = pSearchStateSpace->states.create();
+    state->state_id = stateID;
+    InitializeSearchStateInfo(state, pSearchStateSpace);
+    MaxMemoryCounter += sizeof(ARAState_AD);
 
     return state;
 }
 
-CMDPSTATE* ARAPlanner_AD::GetState(
+ARAState_AD* ARAPlanner_AD::GetState(
     int stateID,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    if (stateID >= (int)environment_->StateID2IndexMapping.size()) {
+    if (stateID < 0 || stateID >= (int)environment_->StateID2IndexMapping.size()) {
         SBPL_ERROR("ERROR int GetState: stateID %d is invalid\n", stateID);
         throw SBPL_Exception();
     }
 
-    if (environment_->StateID2IndexMapping[stateID][ARAMDP_STATEID2IND_AD] == -1) {
+    if (stateID >= (int)pSearchStateSpace->state_index.size()) {
+        pSearchStateSpace->state_index.resize(
+                environment_->StateID2IndexMapping.size(), -1);
+    }
+
+    int index = pSearchStateSpace->state_index[stateID];
+    if (index == -1) {
         return CreateState(stateID, pSearchStateSpace);
     }
     else {
-        int index = environment_->StateID2IndexMapping[stateID][ARAMDP_STATEID2IND_AD];
-        return pSearchStateSpace->searchMDP.StateArray[index];
+        return &pSearchStateSpace->states[index];
     }
 }
 
+ARAState_AD* ARAPlanner_AD::FindState(
+    int stateID,
+    ARASearchStateSpace_AD* pSearchStateSpace)
+{
+    if (stateID < 0 || stateID >= (int)pSearchStateSpace->state_index.size()) {
+        return NULL;
+    }
+    int index = pSearchStateSpace->state_index[stateID];
+    if (index == -1) {
+        return NULL;
+    }
+    ARAState_AD* state = &pSearchStateSpace->states[index];
+    if (state->callnumberaccessed != pSearchStateSpace->callnumber) {
+        return NULL;
+    }
+    return state;
+}
+
 int ARAPlanner_AD::ComputeHeuristic(
-    CMDPSTATE* MDPstate,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    if (bforwardsearch) {
-        return environment_->GetGoalHeuristic(MDPstate->StateID);
+    if (bforwardsearch && pSearchStateSpace != pBackwardSearchStateSpace_) {
+        return environment_->GetGoalHeuristic(state->state_id);
     }
     else {
-        return environment_->GetStartHeuristic(MDPstate->StateID);
+        return environment_->GetStartHeuristic(state->state_id);
     }
 }
 
 // initialization of a state
 void ARAPlanner_AD::InitializeSearchStateInfo(
-    ARAState* state,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
     state->g = INFINITECOST;
     state->v = INFINITECOST;
@@ -140,21 +160,18 @@ void ARAPlanner_AD::InitializeSearchStateInfo(
     state->heapindex = 0;
     state->listelem[ARA_AD_INCONS_LIST_ID] = 0;
     state->bestpredstate = NULL;
-    // compute heuristics
-    if (pSearchStateSpace->searchgoalstate != NULL) {
-        state->h = ComputeHeuristic(state->MDPstate, pSearchStateSpace);
-    }
-    else {
-        state->h = 0;
-    }
+    state->lazy_preds.clear();
+    state->lazy_g = INFINITECOST;
+    state->heur_epoch = 0;
+    UpdateHeuristic(state, pSearchStateSpace);
 }
 
 // re-initialization of a state
 void ARAPlanner_AD::ReInitializeSearchStateInfo(
-    ARAState* state,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-//    SBPL_WARN("Reinitializing state %d!", state->MDPstate->StateID);
+//    SBPL_WARN("Reinitializing state %d!", state->state_id);
     state->g = INFINITECOST;
     state->v = INFINITECOST;
     state->iterationclosed = 0;
@@ -164,40 +181,75 @@ void ARAPlanner_AD::ReInitializeSearchStateInfo(
     state->heapindex = 0;
     state->listelem[ARA_AD_INCONS_LIST_ID] = 0;
     state->bestpredstate = NULL;
+    state->lazy_preds.clear();
+    state->lazy_g = INFINITECOST;
+    UpdateHeuristic(state, pSearchStateSpace);
+}
 
-    // compute heuristics
+void ARAPlanner_AD::UpdateHeuristic(
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
+{
+    if (state->heur_epoch == pSearchStateSpace->heur_epoch &&
+        environment_->heuristicsCacheable())
+    {
+        return;
+    }
 
     if (pSearchStateSpace->searchgoalstate != NULL) {
-        state->h = ComputeHeuristic(state->MDPstate, pSearchStateSpace);
+        state->h = ComputeHeuristic(state, pSearchStateSpace);
+        state->heur_epoch = pSearchStateSpace->heur_epoch;
     }
     else {
         state->h = 0;
+        state->heur_epoch = 0;
     }
 }
 
-void ARAPlanner_AD::DeleteSearchStateData(ARAState* state)
+void ARAPlanner_AD::InvalidateHeuristics(
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    // no memory was allocated
-    MaxMemoryCounter = 0;
-    return;
+    pSearchStateSpace->heur_epoch++;
+
+    // states used by the current search are not reinitialized before they
+    // are used again
+    for (size_t i = 0; i < pSearchStateSpace->states.size(); i++) {
+        ARAState_AD* state = &pSearchStateSpace->states[i];
+        if (state->callnumberaccessed == pSearchStateSpace->callnumber) {
+            UpdateHeuristic(state, pSearchStateSpace);
+        }
+    }
+
+    pSearchStateSpace->bReevaluatefvals = true;
+}
+
+void ARAPlanner_AD::CheckHeuristicEpoch()
+{
+    if (environment_->heuristicEpoch() == env_heur_epoch) {
+        return;
+    }
+
+    env_heur_epoch = environment_->heuristicEpoch();
+    InvalidateHeuristics(pSearchStateSpace_);
+    if (pBackwardSearchStateSpace_ != NULL) {
+        InvalidateHeuristics(pBackwardSearchStateSpace_);
+    }
 }
 
 // used for backward search
 void ARAPlanner_AD::UpdatePreds(
-    ARAState* state,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    std::vector<int> PredIDV;
-    std::vector<int> CostV;
-    CKey key;
-    ARAState* predstate;
+    ARAState_AD* predstate;
 
-    environment_->GetPreds(state->MDPstate->StateID, &PredIDV, &CostV);
+    environment_->GetPreds(state->state_id, &succs_);
+    const std::vector<int>& PredIDV = succs_.ids;
+    const std::vector<int>& CostV = succs_.costs;
 
     // iterate through predecessors of s
     for (int pind = 0; pind < (int)PredIDV.size(); pind++) {
-        CMDPSTATE* PredMDPState = GetState(PredIDV[pind], pSearchStateSpace);
-        predstate = (ARAState*)(PredMDPState->PlannerSpecificData);
+        predstate = GetState(PredIDV[pind], pSearchStateSpace);
         if (predstate->callnumberaccessed != pSearchStateSpace->callnumber) {
             ReInitializeSearchStateInfo(predstate, pSearchStateSpace);
         }
@@ -205,19 +257,16 @@ void ARAPlanner_AD::UpdatePreds(
         // see if we can improve the value of predstate
         if (predstate->g > state->v + CostV[pind]) {
             predstate->g = state->v + CostV[pind];
-            predstate->bestnextstate = state->MDPstate;
+            predstate->bestnextstate = state;
             predstate->costtobestnextstate = CostV[pind];
 
-            // re-insert into heap if not closed yet
-            if (predstate->iterationclosed != pSearchStateSpace->searchiteration) {
-                key.key[0] = predstate->g + (int)(pSearchStateSpace->eps*predstate->h);
-//                key.key[1] = predstate->h;
-                if (predstate->heapindex != 0) {
-                    pSearchStateSpace->heap->updateheap(predstate,key);
-                }
-                else {
-                    pSearchStateSpace->heap->insertheap(predstate,key);
-                }
+            // re-insert into heap if not closed yet (bidirectional search
+            // reopens closed states)
+            if (predstate->iterationclosed != pSearchStateSpace->searchiteration ||
+                bbidirectional)
+            {
+                pSearchStateSpace->open->insertOrUpdate(
+                        predstate, ComputeKey(predstate, pSearchStateSpace));
             }
             else if (predstate->listelem[ARA_AD_INCONS_LIST_ID] == NULL) {
                 // take care of incons list
@@ -229,45 +278,64 @@ void ARAPlanner_AD::UpdatePreds(
 
 // used for forward search
 void ARAPlanner_AD::UpdateSuccs(
-    ARAState* state,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    std::vector<int> SuccIDV;
-    std::vector<int> CostV;
-    CKey key;
-    ARAState* succstate;
+    ARAState_AD* succstate;
 
-    environment_->GetSuccs(state->MDPstate->StateID, &SuccIDV, &CostV);
+    if (blazy) {
+        environment_->GetLazySuccs(state->state_id, &succs_);
+    }
+    else {
+        environment_->GetSuccs(state->state_id, &succs_);
+    }
+    const std::vector<int>& SuccIDV = succs_.ids;
+    const std::vector<int>& CostV = succs_.costs;
 
     // iterate through predecessors of s
     for (int sind = 0; sind < (int)SuccIDV.size(); sind++) {
-        CMDPSTATE* SuccMDPState = GetState(SuccIDV[sind], pSearchStateSpace);
+        succstate = GetState(SuccIDV[sind], pSearchStateSpace);
         int cost = CostV[sind];
 
-        succstate = (ARAState*)(SuccMDPState->PlannerSpecificData);
         if (succstate->callnumberaccessed != pSearchStateSpace->callnumber) {
             ReInitializeSearchStateInfo(succstate, pSearchStateSpace);
         }
 
-        // update generated index
+        // defer the evaluation of the edge until succstate is expanded
+        if (blazy && !succs_.true_costs[sind]) {
+            const unsigned int lazy_g = state->v + cost;
+            if (lazy_g < succstate->g) {
+                ARAState_AD::LazyPred lp;
+                lp.pred = state;
+                lp.g = lazy_g;
+                succstate->lazy_preds.push_back(lp);
+                if (lazy_g < succstate->lazy_g) {
+                    succstate->lazy_g = lazy_g;
+                    if (succstate->iterationclosed != pSearchStateSpace->searchiteration) {
+                        pSearchStateSpace->open->insertOrUpdate(
+                                succstate, ComputeKey(succstate, pSearchStateSpace));
+                    }
+                    else if (succstate->listelem[ARA_AD_INCONS_LIST_ID] == NULL) {
+                        pSearchStateSpace->inconslist->insert(succstate, ARA_AD_INCONS_LIST_ID);
+                    }
+                }
+            }
+            continue;
+        }
 
         // see if we can improve the value of succstate
         // taking into account the cost of action
         if (succstate->g > state->v + cost) {
             succstate->g = state->v + cost;
-            succstate->bestpredstate = state->MDPstate;
-
-            // re-insert into heap if not closed yet
-            if (succstate->iterationclosed != pSearchStateSpace->searchiteration) {
-                key.key[0] = succstate->g + (int)(pSearchStateSpace->eps*succstate->h);
-//                key.key[1] = succstate->h;
-
-                if (succstate->heapindex != 0) {
-                    pSearchStateSpace->heap->updateheap(succstate,key);
-                }
-                else {
-                    pSearchStateSpace->heap->insertheap(succstate,key);
-                }
+            succstate->bestpredstate = state;
+
+            // re-insert into heap if not closed yet (bidirectional search
+            // reopens closed states)
+            if (succstate->iterationclosed != pSearchStateSpace->searchiteration ||
+                bbidirectional)
+            {
+                pSearchStateSpace->open->insertOrUpdate(
+                        succstate, ComputeKey(succstate, pSearchStateSpace));
             }
             else if (succstate->listelem[ARA_AD_INCONS_LIST_ID] == NULL) {
                 // take care of incons list
@@ -278,25 +346,71 @@ void ARAPlanner_AD::UpdateSuccs(
     } // for actions
 }
 
+bool ARAPlanner_AD::EvaluateLazyPreds(
+    ARAState_AD* state,
+    ARASearchStateSpace_AD* pSearchStateSpace)
+{
+    while (state->lazy_g < state->g) {
+        // evaluate the edge from the most promising pending predecessor
+        std::vector<ARAState_AD::LazyPred>& lazy_preds = state->lazy_preds;
+        size_t best = 0;
+        for (size_t i = 1; i < lazy_preds.size(); ++i) {
+            if (lazy_preds[i].g < lazy_preds[best].g) {
+                best = i;
+            }
+        }
+        ARAState_AD* pred = lazy_preds[best].pred;
+        lazy_preds[best] = lazy_preds.back();
+        lazy_preds.pop_back();
+
+        const int cost = environment_->EvaluateEdge(pred->state_id, state->state_id);
+        ++num_edge_evaluations;
+        if (cost >= 0 && pred->v + cost < state->g) {
+            state->g = pred->v + cost;
+            state->bestpredstate = pred;
+        }
+
+        state->lazy_g = INFINITECOST;
+        for (const ARAState_AD::LazyPred& lp : lazy_preds) {
+            state->lazy_g = std::min(state->lazy_g, lp.g);
+        }
+
+        if (std::min(state->g, state->lazy_g) == INFINITECOST) {
+            return false; // no valid edges into this state
+        }
+
+        // return the state to OPEN if it is no longer the most promising
+        const int key = ComputeKey(state, pSearchStateSpace);
+        if (key > pSearchStateSpace->open->minKey()) {
+            pSearchStateSpace->open->insert(state, key);
+            return false;
+        }
+    }
+
+    // the remaining pending edges cannot improve g
+    state->lazy_preds.clear();
+    state->lazy_g = INFINITECOST;
+    return true;
+}
+
 // TODO-debugmax - add obsthresh and other thresholds to other environments in 3dkin
-int ARAPlanner_AD::GetGVal(int StateID, ARASearchStateSpace_t* pSearchStateSpace)
+int ARAPlanner_AD::GetGVal(int StateID, ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    CMDPSTATE* cmdp_state = GetState(StateID, pSearchStateSpace);
-    ARAState* state = (ARAState*)cmdp_state->PlannerSpecificData;
+    ARAState_AD* state = GetState(StateID, pSearchStateSpace);
     return state->g;
 }
 
 // returns 1 if the solution is found, 0 if the solution does not exist and 2
 // if it ran out of time
 int ARAPlanner_AD::ImprovePath(
-    ARASearchStateSpace_t* pSearchStateSpace,
+    ARASearchStateSpace_AD* pSearchStateSpace,
     double MaxNumofSecs)
 {
     int expands;
-    ARAState* state;
-    ARAState* searchgoalstate;
-    CKey key, minkey;
-    CKey goalkey;
+    ARAState_AD* state;
+    ARAState_AD* searchgoalstate;
+    int minkey;
+    int goalkey;
 
     expands = 0;
 
@@ -306,31 +420,39 @@ int ARAPlanner_AD::ImprovePath(
     }
 
     // goal state
-    searchgoalstate = (ARAState*)(pSearchStateSpace->searchgoalstate->PlannerSpecificData);
+    searchgoalstate = pSearchStateSpace->searchgoalstate;
     if (searchgoalstate->callnumberaccessed != pSearchStateSpace->callnumber) {
         ReInitializeSearchStateInfo(searchgoalstate, pSearchStateSpace);
     }
 
     // set goal key
-    goalkey.key[0] = searchgoalstate->g;
-//    goalkey.key[1] = searchgoalstate->h;
+    goalkey = searchgoalstate->g;
 
     // expand states until done
-    minkey = pSearchStateSpace->heap->getminkeyheap();
-    CKey oldkey = minkey;
-    while (!pSearchStateSpace->heap->emptyheap() &&
-        minkey.key[0] < INFINITECOST &&
+    minkey = pSearchStateSpace->open->minKey();
+#if DEBUG
+    int oldkey = minkey;
+#endif
+    while (!pSearchStateSpace->open->empty() &&
+        minkey < INFINITECOST &&
         goalkey > minkey &&
-        sbpl::to_seconds(sbpl::clock::now() - TimeStarted) < MaxNumofSecs)
+        sbpl::to_seconds(sbpl::clock::now() - TimeStarted) < MaxNumofSecs &&
+        !environment_->interruptRequested())
     {
         //get the state
-        state = (ARAState*)pSearchStateSpace->heap->deleteminheap();
+        state = (ARAState_AD*)pSearchStateSpace->open->deleteMin();
 
         // assert that we're not expanding a state in the incons list
         assert(state->listelem[ARA_AD_INCONS_LIST_ID] == NULL);
 
+        if (blazy && !EvaluateLazyPreds(state, pSearchStateSpace)) {
+            minkey = pSearchStateSpace->open->minKey();
+            goalkey = searchgoalstate->g;
+            continue;
+        }
+
 #if DEBUG
-        if (minkey.key[0] < oldkey.key[0] &&
+        if (minkey < oldkey &&
             fabs(this->finitial_eps - 1.0) < ERR_EPS)
         {
             //SBPL_PRINTF("WARN in search: the sequence of keys decreases\n");
@@ -346,7 +468,7 @@ int ARAPlanner_AD::ImprovePath(
         // new expand
         expands++;
 
-        environment_->expandingState(state->MDPstate->StateID);
+        environment_->expandingState(state->state_id);
 
         if (bforwardsearch == false) {
             UpdatePreds(state, pSearchStateSpace);
@@ -356,35 +478,31 @@ int ARAPlanner_AD::ImprovePath(
         }
 
         // recompute minkey
-        minkey = pSearchStateSpace->heap->getminkeyheap();
+        minkey = pSearchStateSpace->open->minKey();
 
-        // recompute goalkey if necessary
-        if (goalkey.key[0] != (int)searchgoalstate->g) {
-            // recompute the goal key (heuristics should be zero)
-            goalkey.key[0] = searchgoalstate->g;
-//            goalkey.key[1] = searchgoalstate->h;
-        }
+        // recompute goalkey if necessary (heuristics should be zero)
+        goalkey = searchgoalstate->g;
 
         if (expands % 100000 == 0 && expands > 0) {
-            SBPL_PRINTF("expands so far=%u\n", expands);
+            SBPL_DEBUG("expands so far=%u", expands);
         }
     }
 
     int retv = 1;
-    if (searchgoalstate->g == INFINITECOST && pSearchStateSpace->heap->emptyheap()) {
-        printf("solution does not exist: search exited because heap is empty\n");
+    if (searchgoalstate->g == INFINITECOST && pSearchStateSpace->open->empty()) {
+        SBPL_DEBUG("solution does not exist: search exited because heap is empty");
         retv = 0;
     }
-    else if (!pSearchStateSpace->heap->emptyheap() && goalkey > minkey) {
-        printf("search exited because it ran out of time\n");
+    else if (!pSearchStateSpace->open->empty() && goalkey > minkey) {
+        SBPL_DEBUG("search exited because it ran out of time");
         retv = 2;
     }
-    else if (searchgoalstate->g == INFINITECOST && !pSearchStateSpace->heap->emptyheap()) {
-        printf("solution does not exist: search exited because all candidates for expansion have infinite heuristics\n");
+    else if (searchgoalstate->g == INFINITECOST && !pSearchStateSpace->open->empty()) {
+        SBPL_DEBUG("solution does not exist: search exited because all candidates for expansion have infinite heuristics");
         retv = 0;
     }
     else {
-        printf("search exited with a solution for eps=%.3f\n", pSearchStateSpace->eps);
+        SBPL_DEBUG("search exited with a solution for eps=%.3f", pSearchStateSpace->eps);
         retv = 1;
     }
 
@@ -393,57 +511,46 @@ int ARAPlanner_AD::ImprovePath(
     return retv;
 }
 
-void ARAPlanner_AD::BuildNewOPENList(ARASearchStateSpace_t* pSearchStateSpace)
+void ARAPlanner_AD::BuildNewOPENList(ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    ARAState* state;
-    CKey key;
-    CHeap* pheap = pSearchStateSpace->heap;
+    ARAState_AD* state;
+    OpenList* open = pSearchStateSpace->open;
     CList* pinconslist = pSearchStateSpace->inconslist;
 
     // move incons into open
     while (pinconslist->firstelement != NULL) {
-        state = (ARAState*)pinconslist->firstelement->liststate;
+        state = (ARAState_AD*)pinconslist->firstelement->liststate;
 
-        // compute f-value
-        key.key[0] = state->g + (int)(pSearchStateSpace->eps * state->h);
-//        key.key[1] = state->h;
-
-        // insert into OPEN
-        pheap->insertheap(state, key);
+        // insert into OPEN with its f-value
+        open->insert(state, ComputeKey(state, pSearchStateSpace));
         // remove from INCONS
         pinconslist->remove(state, ARA_AD_INCONS_LIST_ID);
     }
 }
 
-void ARAPlanner_AD::Reevaluatefvals(ARASearchStateSpace_t* pSearchStateSpace)
+void ARAPlanner_AD::Reevaluatefvals(ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    CKey key;
-    int i;
-    CHeap* pheap = pSearchStateSpace->heap;
-
     //recompute priorities for states in OPEN and reorder it
-    for (i = 1; i <= pheap->currentsize; ++i) {
-        ARAState* state = (ARAState*)pheap->heap[i].heapstate;
-        pheap->heap[i].key.key[0] = state->g + (int)(pSearchStateSpace->eps*state->h);
-//        pheap->heap[i].key.key[1] = state->h;
-    }
-    pheap->makeheap();
+    pSearchStateSpace->open->rekey([&](AbstractSearchState* s) {
+        return ComputeKey((ARAState_AD*)s, pSearchStateSpace);
+    });
 
     pSearchStateSpace->bReevaluatefvals = false;
 }
 
 // creates (allocates memory) search state space
 // does not initialize search statespace
-int ARAPlanner_AD::CreateSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpace)
+int ARAPlanner_AD::CreateSearchStateSpace(ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    // create a heap
-    pSearchStateSpace->heap = new CHeap;
+    // create the open list
+    pSearchStateSpace->open = MakeOpenList(open_list_type_);
     pSearchStateSpace->inconslist = new CList;
-    MaxMemoryCounter += sizeof(CHeap);
+    MaxMemoryCounter += sizeof(OpenList);
     MaxMemoryCounter += sizeof(CList);
 
     pSearchStateSpace->searchgoalstate = NULL;
     pSearchStateSpace->searchstartstate = NULL;
+    pSearchStateSpace->heur_epoch = 1;
 
     searchexpands = 0;
 
@@ -454,12 +561,12 @@ int ARAPlanner_AD::CreateSearchStateSpace(ARASearchStateSpace_t* pSearchStateSpa
 
 // deallocates memory used by SearchStateSpace
 void ARAPlanner_AD::DeleteSearchStateSpace(
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    if (pSearchStateSpace->heap != NULL) {
-        pSearchStateSpace->heap->makeemptyheap();
-        delete pSearchStateSpace->heap;
-        pSearchStateSpace->heap = NULL;
+    if (pSearchStateSpace->open != NULL) {
+        pSearchStateSpace->open->clear();
+        delete pSearchStateSpace->open;
+        pSearchStateSpace->open = NULL;
     }
 
     if (pSearchStateSpace->inconslist != NULL) {
@@ -469,24 +576,18 @@ void ARAPlanner_AD::DeleteSearchStateSpace(
     }
 
     // delete the states themselves
-    int iend = (int)pSearchStateSpace->searchMDP.StateArray.size();
-    for (int i = 0; i < iend; i++) {
-        CMDPSTATE* state = pSearchStateSpace->searchMDP.StateArray[i];
-        if (state != NULL && state->PlannerSpecificData != NULL) {
-            DeleteSearchStateData((ARAState*)state->PlannerSpecificData);
-            free((ARAState*)state->PlannerSpecificData);
-            state->PlannerSpecificData = NULL;
-        }
-    }
-    pSearchStateSpace->searchMDP.Delete();
+    pSearchStateSpace->states.release();
+    pSearchStateSpace->state_index.clear();
+    pSearchStateSpace->searchgoalstate = NULL;
+    pSearchStateSpace->searchstartstate = NULL;
 }
 
 // reset properly search state space
 // needs to be done before deleting states
 int ARAPlanner_AD::ResetSearchStateSpace(
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    pSearchStateSpace->heap->makeemptyheap();
+    pSearchStateSpace->open->clear();
     pSearchStateSpace->inconslist->makeemptylist(ARA_AD_INCONS_LIST_ID);
 
     return 1;
@@ -494,10 +595,8 @@ int ARAPlanner_AD::ResetSearchStateSpace(
 
 // initialization before each search
 void ARAPlanner_AD::ReInitializeSearchStateSpace(
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    CKey key;
-
     // increase callnumber
     pSearchStateSpace->callnumber++;
 
@@ -505,7 +604,7 @@ void ARAPlanner_AD::ReInitializeSearchStateSpace(
     pSearchStateSpace->searchiteration = 0;
     pSearchStateSpace->bNewSearchIteration = true;
 
-    pSearchStateSpace->heap->makeemptyheap();
+    pSearchStateSpace->open->clear();
     pSearchStateSpace->inconslist->makeemptylist(ARA_AD_INCONS_LIST_ID);
 
     // reset
@@ -513,17 +612,16 @@ void ARAPlanner_AD::ReInitializeSearchStateSpace(
     pSearchStateSpace->eps_satisfied = INFINITECOST;
 
     // initialize start state
-    ARAState* startstateinfo = (ARAState*)(pSearchStateSpace->searchstartstate->PlannerSpecificData);
+    ARAState_AD* startstateinfo = pSearchStateSpace->searchstartstate;
     if (startstateinfo->callnumberaccessed != pSearchStateSpace->callnumber) {
         ReInitializeSearchStateInfo(startstateinfo, pSearchStateSpace);
     }
 
     startstateinfo->g = 0;
 
-    // insert start state into the heap
-    key.key[0] = (long int)(pSearchStateSpace->eps*startstateinfo->h);
-//    key.key[1] = startstateinfo->h;
-    pSearchStateSpace->heap->insertheap(startstateinfo, key);
+    // insert start state into the open list
+    pSearchStateSpace->open->insert(
+            startstateinfo, ComputeKey(startstateinfo, pSearchStateSpace));
 
     pSearchStateSpace->bReinitializeSearchStateSpace = false;
     pSearchStateSpace->bReevaluatefvals = false;
@@ -531,9 +629,9 @@ void ARAPlanner_AD::ReInitializeSearchStateSpace(
 
 // very first initialization
 int ARAPlanner_AD::InitializeSearchStateSpace(
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    if (pSearchStateSpace->heap->currentsize != 0 ||
+    if (!pSearchStateSpace->open->empty() ||
         pSearchStateSpace->inconslist->currentsize != 0)
     {
         SBPL_ERROR("ERROR in InitializeSearchStateSpace: heap or list is not empty\n");
@@ -552,7 +650,7 @@ int ARAPlanner_AD::InitializeSearchStateSpace(
 //    pSearchStateSpace->searchstartstate = GetState(SearchStartStateID, pSearchStateSpace);
     pSearchStateSpace->searchstartstate = NULL;
 
-    SBPL_ERROR("InitializeSearchStateSpace reInit!");
+    SBPL_DEBUG("InitializeSearchStateSpace reInit!");
     pSearchStateSpace->bReinitializeSearchStateSpace = true;
 
     return 1;
@@ -560,10 +658,10 @@ int ARAPlanner_AD::InitializeSearchStateSpace(
 
 int ARAPlanner_AD::SetSearchGoalState(
     int SearchGoalStateID,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
     if (pSearchStateSpace->searchgoalstate == NULL ||
-        pSearchStateSpace->searchgoalstate->StateID != SearchGoalStateID)
+        pSearchStateSpace->searchgoalstate->state_id != SearchGoalStateID)
     {
         pSearchStateSpace->searchgoalstate = GetState(SearchGoalStateID, pSearchStateSpace);
 
@@ -572,15 +670,8 @@ int ARAPlanner_AD::SetSearchGoalState(
         pSearchStateSpace->bNewSearchIteration = true;
         pSearchStateSpace_->eps = this->finitial_eps;
 
-
         // recompute heuristic for the heap if heuristics is used
-        for (int i = 0; i < (int)pSearchStateSpace->searchMDP.StateArray.size(); i++) {
-            CMDPSTATE* MDPstate = pSearchStateSpace->searchMDP.StateArray[i];
-            ARAState* state = (ARAState*)MDPstate->PlannerSpecificData;
-            state->h = ComputeHeuristic(MDPstate, pSearchStateSpace);
-        }
-
-        pSearchStateSpace->bReevaluatefvals = true;
+        InvalidateHeuristics(pSearchStateSpace);
     }
 
     return 1;
@@ -588,13 +679,13 @@ int ARAPlanner_AD::SetSearchGoalState(
 
 int ARAPlanner_AD::SetSearchStartState(
     int SearchStartStateID,
-    ARASearchStateSpace_t* pSearchStateSpace)
+    ARASearchStateSpace_AD* pSearchStateSpace)
 {
-    CMDPSTATE* MDPstate = GetState(SearchStartStateID, pSearchStateSpace);
+    ARAState_AD* state = GetState(SearchStartStateID, pSearchStateSpace);
 
-    if (MDPstate != pSearchStateSpace->searchstartstate) {
-        pSearchStateSpace->searchstartstate = MDPstate;
-        SBPL_ERROR("SetSearchStartState reInit!");
+    if (state != pSearchStateSpace->searchstartstate) {
+        pSearchStateSpace->searchstartstate = state;
+        SBPL_DEBUG("SetSearchStartState reInit!");
         pSearchStateSpace->bReinitializeSearchStateSpace = true;
     }
 
@@ -602,24 +693,21 @@ int ARAPlanner_AD::SetSearchStartState(
 }
 
 int ARAPlanner_AD::ReconstructPath(
-    ARASearchStateSpace_t* pSearchStateSpace,
-    CMDPSTATE* beststate)
+    ARASearchStateSpace_AD* pSearchStateSpace,
+    ARAState_AD* beststate)
 {
     // nothing to do, if search is backward
     if (bforwardsearch) {
-        CMDPSTATE* MDPstate;
+        ARAState_AD* stateinfo;
         if (beststate == NULL) {
-            MDPstate = pSearchStateSpace->searchgoalstate;
+            stateinfo = pSearchStateSpace->searchgoalstate;
         }
         else {
-            MDPstate = beststate;
+            stateinfo = beststate;
         }
-        CMDPSTATE* PredMDPstate;
-        ARAState* predstateinfo;
-        ARAState* stateinfo;
+        ARAState_AD* predstateinfo;
 
-        while (MDPstate != pSearchStateSpace->searchstartstate) {
-            stateinfo = (ARAState*)MDPstate->PlannerSpecificData;
+        while (stateinfo != pSearchStateSpace->searchstartstate) {
 
             if (stateinfo->g == INFINITECOST) {
                 SBPL_ERROR("ERROR in ReconstructPath: g of the state on the path is INFINITE\n");
@@ -633,11 +721,10 @@ int ARAPlanner_AD::ReconstructPath(
             }
 
             // get the parent state
-            PredMDPstate = stateinfo->bestpredstate;
-            predstateinfo = (ARAState*)PredMDPstate->PlannerSpecificData;
+            predstateinfo = stateinfo->bestpredstate;
 
             // set its best next info
-            predstateinfo->bestnextstate = MDPstate;
+            predstateinfo->bestnextstate = stateinfo;
 
             // check the decrease of g-values along the path
             if (predstateinfo->v >= stateinfo->g) {
@@ -646,7 +733,7 @@ int ARAPlanner_AD::ReconstructPath(
             }
 
             //transition back
-            MDPstate = PredMDPstate;
+            stateinfo = predstateinfo;
         }
     }
 
@@ -654,43 +741,38 @@ int ARAPlanner_AD::ReconstructPath(
 }
 
 void ARAPlanner_AD::PrintSearchPath(
-    ARASearchStateSpace_t* pSearchStateSpace,
+    ARASearchStateSpace_AD* pSearchStateSpace,
     FILE* fOut)
 {
-    ARAState* searchstateinfo;
-    CMDPSTATE* state;
+    ARAState_AD* searchstateinfo;
+    ARAState_AD* state;
     int goalID;
     int PathCost;
 
     if (bforwardsearch) {
         state  = pSearchStateSpace->searchstartstate;
-        goalID = pSearchStateSpace->searchgoalstate->StateID;
+        goalID = pSearchStateSpace->searchgoalstate->state_id;
     }
     else {
         state = pSearchStateSpace->searchgoalstate;
-        goalID = pSearchStateSpace->searchstartstate->StateID;
+        goalID = pSearchStateSpace->searchstartstate->state_id;
     }
     if (fOut == NULL) {
         fOut = stdout;
     }
 
-    PathCost = ((ARAState*)pSearchStateSpace->searchgoalstate->PlannerSpecificData)->g;
+    PathCost = pSearchStateSpace->searchgoalstate->g;
 
-    SBPL_FPRINTF(fOut, "Printing a path from state %d to the goal state %d\n", state->StateID, pSearchStateSpace->searchgoalstate->StateID);
+    SBPL_FPRINTF(fOut, "Printing a path from state %d to the goal state %d\n", state->state_id, pSearchStateSpace->searchgoalstate->state_id);
     SBPL_FPRINTF(fOut, "Path cost = %d:\n", PathCost);
 
-    environment_->PrintState(state->StateID, false, fOut);
+    environment_->PrintState(state->state_id, false, fOut);
 
     int costFromStart = 0;
-    while (state->StateID != goalID) {
-        SBPL_FPRINTF(fOut, "state %d ", state->StateID);
+    while (state->state_id != goalID) {
+        SBPL_FPRINTF(fOut, "state %d ", state->state_id);
 
-        if (state->PlannerSpecificData == NULL) {
-            SBPL_FPRINTF(fOut, "path does not exist since search data does not exist\n");
-            break;
-        }
-
-        searchstateinfo = (ARAState*)state->PlannerSpecificData;
+        searchstateinfo = state;
 
         if (searchstateinfo->bestnextstate == NULL) {
             SBPL_FPRINTF(fOut, "path does not exist since bestnextstate == NULL\n");
@@ -702,48 +784,47 @@ void ARAPlanner_AD::PrintSearchPath(
         }
 
         int costToGoal = PathCost - costFromStart;
-        int transcost = searchstateinfo->g - ((ARAState*)(searchstateinfo->bestnextstate->PlannerSpecificData))->v;
+        int transcost = searchstateinfo->g - searchstateinfo->bestnextstate->v;
         if (bforwardsearch) {
             transcost = -transcost;
         }
 
         costFromStart += transcost;
 
-        SBPL_FPRINTF(fOut, "g=%d-->state %d, h = %d ctg = %d  ", searchstateinfo->g, searchstateinfo->bestnextstate->StateID, searchstateinfo->h, costToGoal);
+        SBPL_FPRINTF(fOut, "g=%d-->state %d, h = %d ctg = %d  ", searchstateinfo->g, searchstateinfo->bestnextstate->state_id, searchstateinfo->h, costToGoal);
 
         state = searchstateinfo->bestnextstate;
 
-        environment_->PrintState(state->StateID, false, fOut);
+        environment_->PrintState(state->state_id, false, fOut);
     }
 }
 
-void ARAPlanner_AD::PrintSearchState(ARAState* state, FILE* fOut)
+void ARAPlanner_AD::PrintSearchState(ARAState_AD* state, FILE* fOut)
 {
-    SBPL_FPRINTF(fOut, "state %d: h=%d g=%u v=%u iterc=%d callnuma=%d heapind=%d inconslist=%d\n", state->MDPstate->StateID, state->h, state->g, state->v, state->iterationclosed, state->callnumberaccessed, state->heapindex, state->listelem[ARA_AD_INCONS_LIST_ID] ? 1 : 0);
-    environment_->PrintState(state->MDPstate->StateID, true, fOut);
+    SBPL_FPRINTF(fOut, "state %d: h=%d g=%u v=%u iterc=%d callnuma=%d heapind=%d inconslist=%d\n", state->state_id, state->h, state->g, state->v, state->iterationclosed, state->callnumberaccessed, state->heapindex, state->listelem[ARA_AD_INCONS_LIST_ID] ? 1 : 0);
+    environment_->PrintState(state->state_id, true, fOut);
 }
 
 int ARAPlanner_AD::getHeurValue(
-    ARASearchStateSpace_t* pSearchStateSpace,
+    ARASearchStateSpace_AD* pSearchStateSpace,
     int StateID)
 {
-    CMDPSTATE* MDPstate = GetState(StateID, pSearchStateSpace);
-    ARAState* searchstateinfo = (ARAState*)MDPstate->PlannerSpecificData;
+    ARAState_AD* searchstateinfo = GetState(StateID, pSearchStateSpace);
     return searchstateinfo->h;
 }
 
 std::vector<int> ARAPlanner_AD::GetSearchPath(
-    ARASearchStateSpace_t* pSearchStateSpace,
+    ARASearchStateSpace_AD* pSearchStateSpace,
     int& solcost,
-    CMDPSTATE* beststate)
+    ARAState_AD* beststate)
 {
-    std::vector<int> SuccIDV;
-    std::vector<int> CostV;
+    const std::vector<int>& SuccIDV = succs_.ids;
+    const std::vector<int>& CostV = succs_.costs;
     std::vector<int> wholePathIds;
-    ARAState* searchstateinfo;
-    CMDPSTATE* state = NULL;
-    CMDPSTATE* goalstate = NULL;
-    CMDPSTATE* startstate = NULL;
+    ARAState_AD* searchstateinfo;
+    ARAState_AD* state = NULL;
+    ARAState_AD* goalstate = NULL;
+    ARAState_AD* startstate = NULL;
 
     if (bforwardsearch) {
         startstate = pSearchStateSpace->searchstartstate;
@@ -770,7 +851,7 @@ std::vector<int> ARAPlanner_AD::GetSearchPath(
 
     state = startstate;
 
-    wholePathIds.push_back(state->StateID);
+    wholePathIds.push_back(state->state_id);
     solcost = 0;
 
     FILE* fOut = stdout;
@@ -778,13 +859,8 @@ std::vector<int> ARAPlanner_AD::GetSearchPath(
         SBPL_ERROR("ERROR: could not open file\n");
         throw SBPL_Exception();
     }
-    while (state->StateID != goalstate->StateID) {
-        if (state->PlannerSpecificData == NULL) {
-            SBPL_FPRINTF(fOut, "path does not exist since search data does not exist\n");
-            break;
-        }
-
-        searchstateinfo = (ARAState*)state->PlannerSpecificData;
+    while (state->state_id != goalstate->state_id) {
+        searchstateinfo = state;
 
         if (searchstateinfo->bestnextstate == NULL) {
             SBPL_FPRINTF(fOut, "path does not exist since bestnextstate == NULL\n");
@@ -795,10 +871,10 @@ std::vector<int> ARAPlanner_AD::GetSearchPath(
             break;
         }
 
-        environment_->GetSuccs(state->StateID, &SuccIDV, &CostV);
+        environment_->GetSuccs(state->state_id, &succs_);
         int actioncost = INFINITECOST;
         for (int i = 0; i < (int)SuccIDV.size(); i++) {
-            if (SuccIDV.at(i) == searchstateinfo->bestnextstate->StateID && CostV.at(i) < actioncost) {
+            if (SuccIDV.at(i) == searchstateinfo->bestnextstate->state_id && CostV.at(i) < actioncost) {
                 actioncost = CostV.at(i);
             }
         }
@@ -810,30 +886,29 @@ std::vector<int> ARAPlanner_AD::GetSearchPath(
 
         state = searchstateinfo->bestnextstate;
 
-        wholePathIds.push_back(state->StateID);
+        wholePathIds.push_back(state->state_id);
     }
 
     return wholePathIds;
 }
 
 bool ARAPlanner_AD::Search(
-    ARASearchStateSpace_t* pSearchStateSpace,
+    ARASearchStateSpace_AD* pSearchStateSpace,
     std::vector<int>& pathIds,
     int & PathCost,
     bool bFirstSolution,
     bool bOptimalSolution,
     double MaxNumofSecs)
 {
-    CKey key;
     TimeStarted = sbpl::clock::now();
     searchexpands = 0;
+    num_edge_evaluations = 0;
 
     if (pSearchStateSpace->bReinitializeSearchStateSpace == true ||
-        pSearchStateSpace_->heap->emptyheap())
+        pSearchStateSpace_->open->empty())
     {
         // re-initialize state space
 //        SBPL_ERROR("Reinit search state space!");
-//        SBPL_ERROR("Heap size: %d, force reInit = %b", pSearchStateSpace_->heap->currentsize, pSearchStateSpace->bReinitializeSearchStateSpace);
         ReInitializeSearchStateSpace(pSearchStateSpace);
     }
 
@@ -847,12 +922,14 @@ bool ARAPlanner_AD::Search(
 
     // ensure heuristics are up-to-date
     environment_->EnsureHeuristicsUpdated((bforwardsearch==true));
+    CheckHeuristicEpoch();
 
     // the main loop of ARA*
     int prevexpands = 0;
     sbpl::clock::time_point loop_time;
     while (pSearchStateSpace->eps_satisfied > ARA_FINAL_EPS &&
-        sbpl::to_seconds(sbpl::clock::now() - TimeStarted) < MaxNumofSecs)
+        sbpl::to_seconds(sbpl::clock::now() - TimeStarted) < MaxNumofSecs &&
+        !environment_->interruptRequested())
     {
         loop_time = sbpl::clock::now();
         // decrease eps for all subsequent iterations
@@ -890,7 +967,7 @@ bool ARAPlanner_AD::Search(
         }
 
         // print the solution cost and eps bound
-        SBPL_PRINTF("eps=%f expands=%d g(searchgoal)=%d time=%.3f\n", pSearchStateSpace->eps_satisfied, searchexpands - prevexpands, ((ARAState*)pSearchStateSpace->searchgoalstate->PlannerSpecificData)->g, sbpl::to_seconds(sbpl::clock::now() - loop_time));
+        SBPL_DEBUG("eps=%f expands=%d g(searchgoal)=%d time=%.3f", pSearchStateSpace->eps_satisfied, searchexpands - prevexpands, pSearchStateSpace->searchgoalstate->g, sbpl::to_seconds(sbpl::clock::now() - loop_time));
 
         if (pSearchStateSpace->eps_satisfied == finitial_eps &&
             pSearchStateSpace->eps == finitial_eps)
@@ -907,15 +984,15 @@ bool ARAPlanner_AD::Search(
         }
 
         // no solution exists
-        if (((ARAState*)pSearchStateSpace->searchgoalstate->PlannerSpecificData)->g == INFINITECOST) {
+        if (pSearchStateSpace->searchgoalstate->g == INFINITECOST) {
             break;
         }
     }
 
-    PathCost = ((ARAState*)pSearchStateSpace->searchgoalstate->PlannerSpecificData)->g;
-    MaxMemoryCounter += environment_->StateID2IndexMapping.size() * sizeof(int);
+    PathCost = pSearchStateSpace->searchgoalstate->g;
+    MaxMemoryCounter += pSearchStateSpace->state_index.size() * sizeof(int);
 
-    SBPL_PRINTF("MaxMemoryCounter = %d\n", MaxMemoryCounter);
+    SBPL_DEBUG("MaxMemoryCounter = %d", MaxMemoryCounter);
 
     int solcost = INFINITECOST;
     bool ret = false;
@@ -925,7 +1002,7 @@ bool ARAPlanner_AD::Search(
         SBPL_INFO("Best stateID: %d", BestStateID);
         if (BestStateID >= 0) {
             SBPL_WARN("Reconstructing partial path!");
-            CMDPSTATE* beststate = GetState(BestStateID, pSearchStateSpace);
+            ARAState_AD* beststate = GetState(BestStateID, pSearchStateSpace);
             pathIds = GetSearchPath(pSearchStateSpace, solcost, beststate);
         }
         ret = false;
@@ -936,13 +1013,178 @@ bool ARAPlanner_AD::Search(
         ret = true;
     }
 
-    SBPL_PRINTF("total expands this call = %d, planning time = %.3f secs, solution cost=%d\n", searchexpands, sbpl::to_seconds(sbpl::clock::now() - TimeStarted), solcost);
+    SBPL_DEBUG("total expands this call = %d, planning time = %.3f secs, solution cost=%d", searchexpands, sbpl::to_seconds(sbpl::clock::now() - TimeStarted), solcost);
     final_eps_planning_time = sbpl::to_seconds(sbpl::clock::now() - TimeStarted);
     final_eps = pSearchStateSpace->eps_satisfied;
 
     return ret;
 }
 
+// Bidirectional weighted A*. Both searches are reinitialized on every call and
+// run with the initial epsilon. Since closed states are reopened, OPEN always
+// contains a state on an optimal path with an optimal g-value, so the smallest
+// key in either OPEN list is at most eps times the optimal cost.
+bool ARAPlanner_AD::SearchBidirectional(
+    std::vector<int>& pathIds,
+    int& PathCost,
+    double MaxNumofSecs)
+{
+    TimeStarted = sbpl::clock::now();
+    searchexpands = 0;
+    num_edge_evaluations = 0;
+
+    ARASearchStateSpace_AD* fwd = pSearchStateSpace_;
+    ARASearchStateSpace_AD* bwd = pBackwardSearchStateSpace_;
+
+    if (fwd->searchstartstate == NULL || fwd->searchgoalstate == NULL) {
+        SBPL_ERROR("ERROR searching: start or goal state is not set\n");
+        throw SBPL_Exception();
+    }
+
+    const int StartStateID = fwd->searchstartstate->state_id;
+    const int GoalStateID = fwd->searchgoalstate->state_id;
+
+    // the backward search starts at the goal and searches toward the start
+    SetSearchGoalState(StartStateID, bwd);
+    SetSearchStartState(GoalStateID, bwd);
+
+    environment_->EnsureHeuristicsUpdated(true);
+    environment_->EnsureHeuristicsUpdated(false);
+    CheckHeuristicEpoch();
+
+    ReInitializeSearchStateSpace(fwd);
+    ReInitializeSearchStateSpace(bwd);
+    fwd->searchiteration++;
+    bwd->searchiteration++;
+    fwd->bNewSearchIteration = false;
+    bwd->bNewSearchIteration = false;
+
+    // the next unidirectional search must not resume this one
+    fwd->bReinitializeSearchStateSpace = true;
+
+    // the cheapest path found so far, through a state reached by both searches
+    unsigned int mu = INFINITECOST;
+    ARAState_AD* fmeet = NULL;
+    ARAState_AD* bmeet = NULL;
+
+    // the start and goal may already be connected
+    if (StartStateID == GoalStateID) {
+        mu = 0;
+        fmeet = fwd->searchstartstate;
+        bmeet = bwd->searchstartstate;
+    }
+
+    bool timed_out = false;
+    while (!fwd->open->empty() && !bwd->open->empty()) {
+        const unsigned int fminkey = fwd->open->minKey();
+        const unsigned int bminkey = bwd->open->minKey();
+        if (mu <= std::max(fminkey, bminkey)) {
+            break;
+        }
+
+        if (sbpl::to_seconds(sbpl::clock::now() - TimeStarted) >= MaxNumofSecs ||
+            environment_->interruptRequested())
+        {
+            timed_out = true;
+            break;
+        }
+
+        // expand the smaller frontier
+        const bool forward = fwd->open->size() <= bwd->open->size();
+        ARASearchStateSpace_AD* pSearchStateSpace = forward ? fwd : bwd;
+        ARASearchStateSpace_AD* pOtherSearchStateSpace = forward ? bwd : fwd;
+
+        ARAState_AD* state = (ARAState_AD*)pSearchStateSpace->open->deleteMin();
+        state->v = state->g;
+        state->iterationclosed = pSearchStateSpace->searchiteration;
+        searchexpands++;
+
+        if (forward) {
+            environment_->expandingState(state->state_id);
+            UpdateSuccs(state, pSearchStateSpace);
+        }
+        else {
+            UpdatePreds(state, pSearchStateSpace);
+        }
+
+        // look for cheaper paths through the generated states
+        for (int id : succs_.ids) {
+            ARAState_AD* s = FindState(id, pSearchStateSpace);
+            ARAState_AD* o = FindState(id, pOtherSearchStateSpace);
+            if (s == NULL || o == NULL || o->g == INFINITECOST) {
+                continue;
+            }
+            if (s->g + o->g < mu) {
+                mu = s->g + o->g;
+                fmeet = forward ? s : o;
+                bmeet = forward ? o : s;
+            }
+        }
+    }
+
+    if (fmeet != NULL) {
+        fwd->eps_satisfied = fwd->eps;
+    }
+
+    SBPL_DEBUG("bidirectional: eps=%f expands=%d cost=%u time=%.3f%s", fwd->eps, searchexpands, mu, sbpl::to_seconds(sbpl::clock::now() - TimeStarted), timed_out ? " (timed out)" : "");
+
+    finitial_eps_planning_time = sbpl::to_seconds(sbpl::clock::now() - TimeStarted);
+    final_eps_planning_time = finitial_eps_planning_time;
+    num_of_expands_initial_solution = searchexpands;
+    final_eps = fwd->eps_satisfied;
+    MaxMemoryCounter += (fwd->state_index.size() + bwd->state_index.size()) * sizeof(int);
+
+    pathIds.clear();
+    if (fmeet == NULL) {
+        PathCost = INFINITECOST;
+        SBPL_WARN("Tracking could not reach goal!");
+        int BestStateID = environment_->getBestSeenState();
+        SBPL_INFO("Best stateID: %d", BestStateID);
+        ARAState_AD* beststate = FindState(BestStateID, fwd);
+        if (beststate != NULL && beststate->g != INFINITECOST) {
+            SBPL_WARN("Reconstructing partial path!");
+            int solcost;
+            pathIds = GetSearchPath(fwd, solcost, beststate);
+        }
+        return false;
+    }
+
+    // forward search from the start up to the meeting state...
+    for (ARAState_AD* s = fmeet; s != NULL; s = s->bestpredstate) {
+        pathIds.push_back(s->state_id);
+    }
+    std::reverse(pathIds.begin(), pathIds.end());
+
+    // ...followed by the backward search from there to the goal
+    for (ARAState_AD* s = bmeet->bestnextstate; s != NULL; s = s->bestnextstate) {
+        pathIds.push_back(s->state_id);
+    }
+
+    PathCost = fmeet->g + bmeet->g;
+    SBPL_INFO("Tracking success!");
+    return true;
+}
+
+// Returns whether the backward search of a bidirectional search can make
+// progress from the goal. Abstract goals, such as the metagoal of a
+// MultiRepAdaptiveDiscreteSpace, and environments that do not implement
+// GetPreds report no predecessors, in which case a unidirectional search is
+// run instead.
+bool ARAPlanner_AD::CanSearchBackward()
+{
+    if (pSearchStateSpace_->searchgoalstate == NULL) {
+        return true; // reported by SearchBidirectional
+    }
+
+    const int GoalStateID = pSearchStateSpace_->searchgoalstate->state_id;
+    environment_->GetPreds(GoalStateID, &succs_);
+    if (succs_.empty()) {
+        SBPL_DEBUG("goal state %d has no predecessors; searching forward only", GoalStateID);
+        return false;
+    }
+    return true;
+}
+
 // returns 1 if found a solution, and 0 otherwise
 int ARAPlanner_AD::replan(
     double allocated_time_secs,
@@ -965,11 +1207,17 @@ int ARAPlanner_AD::replan(
     bool bOptimalSolution = false;
     *psolcost = 0;
 
-    SBPL_PRINTF("planner: replan called (bFirstSol=%d, bOptSol=%d)\n", bFirstSolution, bOptimalSolution);
+    SBPL_DEBUG("planner: replan called (bFirstSol=%d, bOptSol=%d)", bFirstSolution, bOptimalSolution);
 
     // plan
-    if ((bFound = Search(pSearchStateSpace_, pathIds, PathCost, bFirstSolution, bOptimalSolution, allocated_time_secs)) == false) {
-        SBPL_PRINTF("failed to find a solution\n");
+    if (bbidirectional && CanSearchBackward()) {
+        bFound = SearchBidirectional(pathIds, PathCost, allocated_time_secs);
+    }
+    else {
+        bFound = Search(pSearchStateSpace_, pathIds, PathCost, bFirstSolution, bOptimalSolution, allocated_time_secs);
+    }
+    if (!bFound) {
+        SBPL_DEBUG("failed to find a solution");
     }
 
     // copy the solution
@@ -1015,15 +1263,50 @@ int ARAPlanner_AD::set_start(int start_stateID)
     return 1;
 }
 
+// ARA* is not incremental, so the search is reinitialized if the change may
+// have affected it. Since the edges of a state are only used when it is
+// expanded, the search is unaffected if none of the states whose edges
+// changed (in the direction of the search) have been expanded.
 void ARAPlanner_AD::costs_changed(const StateChangeQuery& stateChange)
 {
-    SBPL_ERROR("costs_changed(..) reInit!");
-    pSearchStateSpace_->bReinitializeSearchStateSpace = true;
+    if (pSearchStateSpace_->bReinitializeSearchStateSpace) {
+        return;
+    }
+
+    const std::vector<int>* changed = bforwardsearch ?
+            stateChange.getPredecessors() : stateChange.getSuccessors();
+    if (!changed || IsSearchAffected(*changed, pSearchStateSpace_)) {
+        SBPL_DEBUG("costs_changed(..) reInit!");
+        pSearchStateSpace_->bReinitializeSearchStateSpace = true;
+    }
+}
+
+bool ARAPlanner_AD::IsSearchAffected(
+    const std::vector<int>& changed_state_ids,
+    ARASearchStateSpace_AD* pSearchStateSpace)
+{
+    for (int stateID : changed_state_ids) {
+        if (stateID < 0 ||
+            stateID >= (int)pSearchStateSpace->state_index.size() ||
+            pSearchStateSpace->state_index[stateID] == -1)
+        {
+            continue; // never seen by the search
+        }
+
+        int index = pSearchStateSpace->state_index[stateID];
+        ARAState_AD* state = &pSearchStateSpace->states[index];
+        if (state->callnumberaccessed == pSearchStateSpace->callnumber &&
+            state->v != INFINITECOST)
+        {
+            return true; // expanded by the current search
+        }
+    }
+    return false;
 }
 
 void ARAPlanner_AD::costs_changed()
 {
-    SBPL_ERROR("costs_changed() reInit!");
+    SBPL_DEBUG("costs_changed() reInit!");
     pSearchStateSpace_->bReinitializeSearchStateSpace = true;
 }
 
@@ -1033,9 +1316,70 @@ int ARAPlanner_AD::force_planning_from_scratch()
     return 1;
 }
 
+int ARAPlanner_AD::force_planning_from_scratch_and_free_memory()
+{
+    // the search states are destroyed in bulk, so the start and goal states
+    // must be set again before the next search. The backward search state
+    // space is kept, since bidirectional search remains enabled
+    ARASearchStateSpace_AD* spaces[] = {
+        pSearchStateSpace_, pBackwardSearchStateSpace_
+    };
+    for (ARASearchStateSpace_AD* pSearchStateSpace : spaces) {
+        if (pSearchStateSpace == NULL) {
+            continue;
+        }
+        pSearchStateSpace->open->clear();
+        pSearchStateSpace->inconslist->makeemptylist(ARA_AD_INCONS_LIST_ID);
+        pSearchStateSpace->states.release();
+        std::vector<int>().swap(pSearchStateSpace->state_index);
+        pSearchStateSpace->searchgoalstate = NULL;
+        pSearchStateSpace->searchstartstate = NULL;
+    }
+    pSearchStateSpace_->bReinitializeSearchStateSpace = true;
+    return 1;
+}
+
+void ARAPlanner_AD::set_lazy_evaluation(bool lazy)
+{
+    if (lazy && !bforwardsearch) {
+        SBPL_WARN("Lazy evaluation is only supported for forward search");
+        lazy = false;
+    }
+    if (lazy && bbidirectional) {
+        SBPL_WARN("Lazy evaluation is not supported by bidirectional search");
+        lazy = false;
+    }
+    if (lazy != blazy) {
+        blazy = lazy;
+        pSearchStateSpace_->bReinitializeSearchStateSpace = true;
+    }
+}
+
+void ARAPlanner_AD::set_bidirectional(bool bidirectional)
+{
+    if (bidirectional && !bforwardsearch) {
+        SBPL_WARN("Bidirectional search requires a forward search");
+        bidirectional = false;
+    }
+    if (bidirectional == bbidirectional) {
+        return;
+    }
+
+    bbidirectional = bidirectional;
+    if (bbidirectional) {
+        set_lazy_evaluation(false);
+        if (pBackwardSearchStateSpace_ == NULL) {
+            pBackwardSearchStateSpace_ = new ARASearchStateSpace_AD;
+            CreateSearchStateSpace(pBackwardSearchStateSpace_);
+            InitializeSearchStateSpace(pBackwardSearchStateSpace_);
+        }
+    }
+    pSearchStateSpace_->bReinitializeSearchStateSpace = true;
+}
+
 int ARAPlanner_AD::set_search_mode(bool bSearchUntilFirstSolution)
 {
-    SBPL_PRINTF("planner: search mode set to %d\n", bSearchUntilFirstSolution);
+    SBPL_DEBUG("planner: search mode set to %d", bSearchUntilFirstSolution);
 
     bsearchuntilfirstsolution = bSearchUntilFirstSolution;
 
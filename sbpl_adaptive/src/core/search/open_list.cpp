@@ -0,0 +1,555 @@
+#include <sbpl_adaptive/core/search/open_list.h>
+
+// standard includes
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <new>
+
+namespace adim {
+
+const char *to_string(OpenListType type)
+{
+    switch (type) {
+    case OpenListType::BINARY_HEAP:     return "BinaryHeap";
+    case OpenListType::BUCKET_QUEUE:    return "BucketQueue";
+    case OpenListType::QUATERNARY_HEAP: return "QuaternaryHeap";
+    default:                            return "Unknown";
+    }
+}
+
+OpenList *MakeOpenList(OpenListType type)
+{
+    switch (type) {
+    case OpenListType::BUCKET_QUEUE:
+        return new BucketOpenList;
+    case OpenListType::QUATERNARY_HEAP:
+        return new QuaternaryHeapOpenList;
+    case OpenListType::BINARY_HEAP:
+    default:
+        return new BinaryHeapOpenList;
+    }
+}
+
+////////////////////////
+// BinaryHeapOpenList //
+////////////////////////
+
+OpenList::Key BinaryHeapOpenList::minKey()
+{
+    if (heap_.emptyheap()) {
+        return INFINITECOST;
+    }
+    return heap_.getminkeyheap().key[0];
+}
+
+void BinaryHeapOpenList::insert(AbstractSearchState *state, Key key)
+{
+    CKey k;
+    k.key[0] = key;
+    heap_.insertheap(state, k);
+}
+
+void BinaryHeapOpenList::update(AbstractSearchState *state, Key key)
+{
+    CKey k;
+    k.key[0] = key;
+    heap_.updateheap(state, k);
+}
+
+AbstractSearchState *BinaryHeapOpenList::min()
+{
+    if (heap_.emptyheap()) {
+        return NULL;
+    }
+    return heap_.getminheap();
+}
+
+AbstractSearchState *BinaryHeapOpenList::deleteMin()
+{
+    if (heap_.emptyheap()) {
+        return NULL;
+    }
+    return heap_.deleteminheap();
+}
+
+void BinaryHeapOpenList::erase(AbstractSearchState *state)
+{
+    heap_.deleteheap(state);
+}
+
+void BinaryHeapOpenList::clear()
+{
+    heap_.makeemptyheap();
+}
+
+void BinaryHeapOpenList::rekey(const KeyFn &key)
+{
+    for (int i = 1; i <= heap_.currentsize; ++i) {
+        heap_.heap[i].key.key[0] = key(heap_.heap[i].heapstate);
+    }
+    heap_.makeheap();
+}
+
+////////////////////
+// BucketOpenList //
+////////////////////
+
+BucketOpenList::BucketOpenList(int max_span) :
+    nodes_(),
+    free_(-1),
+    buckets_(1, -1),
+    start_(0),
+    span_(0),
+    base_(0),
+    cursor_(0),
+    max_span_((size_t)std::max(max_span, 1)),
+    overflow_(-1),
+    size_(0)
+{
+}
+
+OpenList::Key BucketOpenList::minKey()
+{
+    if (size_ == 0) {
+        return INFINITECOST;
+    }
+    while (cursor_ < span_ && bucket(cursor_) == -1) {
+        ++cursor_;
+    }
+    if (cursor_ == span_ && !refill()) {
+        return INFINITECOST;
+    }
+    return base_ + (Key)cursor_;
+}
+
+void BucketOpenList::insert(AbstractSearchState *state, Key key)
+{
+    assert(state->heapindex == 0);
+
+    int n;
+    if (free_ != -1) {
+        n = free_;
+        free_ = nodes_[n].next;
+    } else {
+        n = (int)nodes_.size();
+        nodes_.push_back(Node());
+    }
+
+    Node &node = nodes_[n];
+    node.state = state;
+    node.key = key;
+    state->heapindex = n + 1;
+
+    if (size_ == 0) {
+        // start a new window at the first key; all buckets are empty
+        overflow_ = -1;
+        reset(key);
+    }
+    place(n);
+    ++size_;
+}
+
+void BucketOpenList::update(AbstractSearchState *state, Key key)
+{
+    assert(state->heapindex != 0);
+    const int n = state->heapindex - 1;
+    if (nodes_[n].key == key) {
+        return;
+    }
+    unlink(n);
+    nodes_[n].key = key;
+    place(n);
+}
+
+AbstractSearchState *BucketOpenList::min()
+{
+    if (size_ == 0) {
+        return NULL;
+    }
+    minKey(); // advance the cursor to the first non-empty bucket
+    return nodes_[bucket(cursor_)].state;
+}
+
+AbstractSearchState *BucketOpenList::deleteMin()
+{
+    AbstractSearchState *state = min();
+    if (state != NULL) {
+        release(state->heapindex - 1);
+    }
+    return state;
+}
+
+void BucketOpenList::erase(AbstractSearchState *state)
+{
+    assert(state->heapindex != 0);
+    release(state->heapindex - 1);
+}
+
+void BucketOpenList::clear()
+{
+    for (Node &node : nodes_) {
+        if (node.state != NULL) {
+            node.state->heapindex = 0;
+        }
+    }
+    nodes_.clear();
+    free_ = -1;
+    for (size_t i = 0; i < span_; ++i) {
+        bucket(i) = -1;
+    }
+    overflow_ = -1;
+    reset(0);
+    size_ = 0;
+}
+
+void BucketOpenList::rekey(const KeyFn &key)
+{
+    if (size_ == 0) {
+        return;
+    }
+
+    Key min_key = std::numeric_limits<Key>::max();
+    for (Node &node : nodes_) {
+        if (node.state != NULL) {
+            node.key = key(node.state);
+            min_key = std::min(min_key, node.key);
+        }
+    }
+
+    for (size_t i = 0; i < span_; ++i) {
+        bucket(i) = -1;
+    }
+    overflow_ = -1;
+    reset(min_key);
+    for (int n = 0; n < (int)nodes_.size(); ++n) {
+        if (nodes_[n].state != NULL) {
+            place(n);
+        }
+    }
+}
+
+// Start an empty window at the given key. The buckets must be empty.
+void BucketOpenList::reset(Key base)
+{
+    start_ = 0;
+    span_ = 0;
+    base_ = base;
+    cursor_ = 0;
+}
+
+// Make room for a window of the given number of buckets, moving the window to
+// the front of a larger ring if necessary
+void BucketOpenList::reserve(size_t span)
+{
+    if (span <= buckets_.size()) {
+        return;
+    }
+
+    size_t capacity = buckets_.size();
+    while (capacity < span) {
+        capacity <<= 1;
+    }
+
+    std::vector<int> buckets(capacity, -1);
+    for (size_t i = 0; i < span_; ++i) {
+        buckets[i] = bucket(i);
+    }
+    buckets_.swap(buckets);
+    start_ = 0;
+}
+
+// Move the window down to the given key, which lies so far below the window
+// that the window cannot be extended to it. Nodes that fall beyond the new
+// window are moved to the overflow list.
+void BucketOpenList::rebase(Key base)
+{
+    int moved = -1;
+    for (size_t i = 0; i < span_; ++i) {
+        int &h = bucket(i);
+        while (h != -1) {
+            const int n = h;
+            h = nodes_[n].next;
+            nodes_[n].next = moved;
+            moved = n;
+        }
+    }
+
+    reset(base);
+    while (moved != -1) {
+        const int next = nodes_[moved].next;
+        place(moved);
+        moved = next;
+    }
+}
+
+// Insert a node into the bucket of its key, extending the window downwards if
+// the key is below it. Keys beyond the window go to the overflow list.
+void BucketOpenList::place(int n)
+{
+    Node &node = nodes_[n];
+
+    if (node.key < base_) {
+        const unsigned long shift = (unsigned long)(base_ - node.key);
+        if (shift > max_span_ - span_) {
+            rebase(node.key);
+        } else {
+            reserve(span_ + shift);
+            start_ = (start_ - shift) & (buckets_.size() - 1);
+            span_ += shift;
+            base_ = node.key;
+            cursor_ += shift;
+        }
+    }
+
+    const unsigned long offset = (unsigned long)(node.key - base_);
+    if (offset >= max_span_) {
+        node.overflow = true;
+    } else {
+        node.overflow = false;
+        if (offset >= span_) {
+            reserve(offset + 1);
+            span_ = offset + 1;
+        }
+        cursor_ = std::min(cursor_, (size_t)offset);
+    }
+    link(n);
+}
+
+// Remove a node from its bucket and return it to the free list
+void BucketOpenList::release(int n)
+{
+    unlink(n);
+    --size_;
+    nodes_[n].state->heapindex = 0;
+    nodes_[n].state = NULL;
+    nodes_[n].next = free_;
+    free_ = n;
+}
+
+void BucketOpenList::link(int n)
+{
+    Node &node = nodes_[n];
+    int &h = head(node);
+    node.prev = -1;
+    node.next = h;
+    if (h != -1) {
+        nodes_[h].prev = n;
+    }
+    h = n;
+}
+
+void BucketOpenList::unlink(int n)
+{
+    Node &node = nodes_[n];
+    if (node.prev != -1) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        head(node) = node.next;
+    }
+    if (node.next != -1) {
+        nodes_[node.next].prev = node.prev;
+    }
+}
+
+// Start a new window at the smallest key in the overflow list and move the
+// overflowed nodes that fit into it. Returns false if there are none.
+bool BucketOpenList::refill()
+{
+    if (overflow_ == -1) {
+        return false;
+    }
+
+    Key min_key = std::numeric_limits<Key>::max();
+    for (int n = overflow_; n != -1; n = nodes_[n].next) {
+        min_key = std::min(min_key, nodes_[n].key);
+    }
+
+    // all buckets are empty
+    reset(min_key);
+
+    int n = overflow_;
+    overflow_ = -1;
+    while (n != -1) {
+        const int next = nodes_[n].next;
+        place(n);
+        n = next;
+    }
+    return true;
+}
+
+////////////////////////////
+// QuaternaryHeapOpenList //
+////////////////////////////
+
+QuaternaryHeapOpenList::QuaternaryHeapOpenList() :
+    raw_(NULL),
+    data_(NULL),
+    capacity_(0),
+    size_(0)
+{
+}
+
+QuaternaryHeapOpenList::~QuaternaryHeapOpenList()
+{
+    ::operator delete(raw_);
+}
+
+OpenList::Key QuaternaryHeapOpenList::minKey()
+{
+    return size_ == 0 ? INFINITECOST : at(0).key;
+}
+
+void QuaternaryHeapOpenList::insert(AbstractSearchState *state, Key key)
+{
+    assert(state->heapindex == 0);
+    if (size_ == capacity_) {
+        grow();
+    }
+    Node n;
+    n.state = state;
+    n.key = key;
+    set(size_, n);
+    siftUp(size_++);
+}
+
+void QuaternaryHeapOpenList::update(AbstractSearchState *state, Key key)
+{
+    assert(state->heapindex != 0);
+    const size_t i = state->heapindex - 1;
+    const Key old_key = at(i).key;
+    at(i).key = key;
+    if (key < old_key) {
+        siftUp(i);
+    } else if (key > old_key) {
+        siftDown(i);
+    }
+}
+
+AbstractSearchState *QuaternaryHeapOpenList::min()
+{
+    return size_ == 0 ? NULL : at(0).state;
+}
+
+AbstractSearchState *QuaternaryHeapOpenList::deleteMin()
+{
+    if (size_ == 0) {
+        return NULL;
+    }
+    AbstractSearchState *state = at(0).state;
+    state->heapindex = 0;
+    if (--size_ > 0) {
+        set(0, at(size_));
+        siftDown(0);
+    }
+    return state;
+}
+
+void QuaternaryHeapOpenList::erase(AbstractSearchState *state)
+{
+    assert(state->heapindex != 0);
+    const size_t i = state->heapindex - 1;
+    state->heapindex = 0;
+    if (--size_ == i) {
+        return;
+    }
+    const Key old_key = at(i).key;
+    set(i, at(size_));
+    if (at(i).key < old_key) {
+        siftUp(i);
+    } else {
+        siftDown(i);
+    }
+}
+
+void QuaternaryHeapOpenList::clear()
+{
+    for (size_t i = 0; i < size_; ++i) {
+        at(i).state->heapindex = 0;
+    }
+    size_ = 0;
+}
+
+void QuaternaryHeapOpenList::rekey(const KeyFn &key)
+{
+    if (size_ == 0) {
+        return;
+    }
+    for (size_t i = 0; i < size_; ++i) {
+        at(i).key = key(at(i).state);
+    }
+    if (size_ < 2) {
+        return;
+    }
+    for (size_t i = (size_ - 2) / 4 + 1; i-- > 0; ) {
+        siftDown(i);
+    }
+}
+
+void QuaternaryHeapOpenList::grow()
+{
+    const size_t align = 64;
+    const size_t capacity = std::max<size_t>(64, 2 * capacity_);
+
+    void *raw = ::operator new((capacity + OFFSET) * sizeof(Node) + align);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(raw);
+    addr = (addr + align - 1) & ~(uintptr_t)(align - 1);
+    Node *data = reinterpret_cast<Node *>(addr);
+
+    if (size_ > 0) {
+        memcpy(data + OFFSET, data_ + OFFSET, size_ * sizeof(Node));
+    }
+    ::operator delete(raw_);
+
+    raw_ = raw;
+    data_ = data;
+    capacity_ = capacity;
+}
+
+void QuaternaryHeapOpenList::set(size_t i, const Node &n)
+{
+    at(i) = n;
+    n.state->heapindex = (int)i + 1;
+}
+
+void QuaternaryHeapOpenList::siftUp(size_t i)
+{
+    const Node n = at(i);
+    while (i > 0) {
+        const size_t p = (i - 1) >> 2;
+        if (at(p).key <= n.key) {
+            break;
+        }
+        set(i, at(p));
+        i = p;
+    }
+    set(i, n);
+}
+
+void QuaternaryHeapOpenList::siftDown(size_t i)
+{
+    const Node n = at(i);
+    for (;;) {
+        const size_t first = (i << 2) + 1;
+        if (first >= size_) {
+            break;
+        }
+        const size_t last = std::min(first + 4, size_);
+        size_t best = first;
+        for (size_t c = first + 1; c < last; ++c) {
+            if (at(c).key < at(best).key) {
+                best = c;
+            }
+        }
+        if (at(best).key >= n.key) {
+            break;
+        }
+        set(i, at(best));
+        i = best;
+    }
+    set(i, n);
+}
+
+} // namespace adim
@@ -0,0 +1,576 @@
+#include <sbpl_adaptive/core/search/paseplanner_ad.h>
+
+// standard includes
+#include <assert.h>
+#include <algorithm>
+#include <limits>
+
+// system includes
+#include <ros/console.h>
+
+namespace adim {
+
+static const char *SLOG = "pase";
+static const char *SELOG = "pase.expansions";
+
+ADPASEPlannerAllocator::ADPASEPlannerAllocator(
+    int num_threads,
+    Heuristic *heuristic)
+:
+    num_threads_(num_threads),
+    heuristic_(heuristic)
+{
+}
+
+SBPLPlanner *ADPASEPlannerAllocator::make(
+    AdaptiveDiscreteSpace *space,
+    bool forward_search) const
+{
+    if (!forward_search) {
+        ROS_ERROR_NAMED(SLOG, "PASEPlanner_AD only supports forward search");
+        return nullptr;
+    }
+
+    return new PASEPlanner_AD(space, heuristic_, forward_search, num_threads_);
+}
+
+PASEPlanner_AD::PASEPlanner_AD(
+    AdaptiveDiscreteSpace *space,
+    Heuristic *heuristic,
+    bool bForwardSearch,
+    int num_threads)
+:
+    SBPLPlanner(),
+    m_space(space),
+    m_heur(heuristic),
+    bforwardsearch(bForwardSearch),
+    m_pool(std::make_shared<ThreadPool>(num_threads)),
+    m_initial_eps(1.0),
+    m_indep_eps(1.0),
+    m_satisfied_eps(std::numeric_limits<double>::infinity()),
+    m_max_candidates(32),
+    m_bounded(true),
+    m_allowed_time(sbpl::clock::duration::zero()),
+    m_start_state_id(-1),
+    m_goal_state_id(-1),
+    m_states(),
+    m_graph_to_search_map(),
+    m_call_number(0),
+    m_mutex(),
+    m_cv(),
+    m_open(),
+    m_being_expanded(),
+    m_status(EXHAUSTED),
+    m_start_time(),
+    m_expand_count(0),
+    m_version(0),
+    m_expand_mutex(),
+    m_concurrent(false),
+    m_search_time(sbpl::clock::duration::zero()),
+    m_solution_cost(INFINITECOST)
+{
+    environment_ = space;
+
+    if (!bforwardsearch) {
+        ROS_ERROR_NAMED(SLOG, "PASEPlanner_AD only supports forward search");
+    }
+    if (!m_space->supportsConcurrentExpansions()) {
+        ROS_WARN_NAMED(SLOG, "Environment does not support concurrent expansions. Successors will be generated by one thread at a time");
+    }
+    ROS_DEBUG_NAMED(SLOG, "PA*SE instantiated with %d threads", m_pool->numWorkers());
+}
+
+PASEPlanner_AD::~PASEPlanner_AD()
+{
+    for (PASEState *s : m_states) {
+        delete s;
+    }
+}
+
+void PASEPlanner_AD::get_search_stats(std::vector<PlannerStats> *s)
+{
+    PlannerStats stats;
+    stats.eps = m_initial_eps;
+    stats.cost = m_solution_cost;
+    stats.expands = m_expand_count;
+    stats.time = sbpl::to_seconds(m_search_time);
+    s->push_back(stats);
+}
+
+int PASEPlanner_AD::replan(double allowed_time, std::vector<int> *solution)
+{
+    int cost;
+    return replan(allowed_time, solution, &cost);
+}
+
+int PASEPlanner_AD::replan(
+    double allowed_time,
+    std::vector<int> *solution,
+    int *cost)
+{
+    ReplanParams params(allowed_time);
+    params.initial_eps = m_initial_eps;
+    params.return_first_solution = !m_bounded;
+    return replan(solution, params, cost);
+}
+
+int PASEPlanner_AD::replan(std::vector<int> *solution, ReplanParams params)
+{
+    int cost;
+    return replan(solution, params, &cost);
+}
+
+int PASEPlanner_AD::replan(
+    std::vector<int> *solution,
+    ReplanParams params,
+    int *cost)
+{
+    ROS_DEBUG_NAMED(SLOG, "Find path to goal");
+
+    if (m_start_state_id < 0) {
+        ROS_ERROR_NAMED(SLOG, "Start state not set");
+        return 0;
+    }
+    if (m_goal_state_id < 0) {
+        ROS_ERROR_NAMED(SLOG, "Goal state not set");
+        return 0;
+    }
+
+    m_initial_eps = params.initial_eps;
+    m_bounded = !params.return_first_solution;
+    m_allowed_time = sbpl::to_duration(params.max_time);
+
+    // initialize the search tree with the start state
+    m_open.clear();
+    m_being_expanded.clear();
+    ++m_call_number;
+
+    PASEState *start_state = getSearchState(m_start_state_id);
+    PASEState *goal_state = getSearchState(m_goal_state_id);
+    reinitSearchState(start_state);
+    reinitSearchState(goal_state);
+
+    start_state->g = 0;
+    start_state->f = computeKey(start_state);
+    start_state->status = PASEState::OPEN;
+    m_open.insert(start_state);
+
+    m_status = SEARCHING;
+    m_expand_count = 0;
+    m_version = 0;
+    m_start_time = sbpl::clock::now();
+    m_solution_cost = INFINITECOST;
+
+    // heuristics provided separately from the environment are not known to
+    // be thread safe
+    m_concurrent = m_space->supportsConcurrentExpansions() && !m_heur;
+
+    {
+        ConcurrentExpansionScope scope(
+                m_space, m_concurrent && m_pool->numWorkers() > 1);
+        m_pool->parallelFor(m_pool->numWorkers(), [this](size_t, int worker)
+        {
+            searchLoop(worker);
+        });
+    }
+
+    m_search_time = sbpl::clock::now() - m_start_time;
+
+    ROS_DEBUG_NAMED(SLOG, "Search finished after %d expansions in %0.3f seconds", m_expand_count, sbpl::to_seconds(m_search_time));
+
+    solution->clear();
+    if (m_status != FOUND) {
+        m_satisfied_eps = std::numeric_limits<double>::infinity();
+        if (m_status == TIMED_OUT) {
+            ROS_DEBUG_NAMED(SLOG, "Ran out of time");
+        } else {
+            ROS_DEBUG_NAMED(SLOG, "Exhausted OPEN list");
+        }
+        return 0;
+    }
+
+    m_satisfied_eps = m_initial_eps * m_indep_eps;
+    extractPath(goal_state, *solution, *cost);
+    m_solution_cost = *cost;
+    return 1;
+}
+
+int PASEPlanner_AD::set_goal(int goal_state_id)
+{
+    m_goal_state_id = goal_state_id;
+    return 1;
+}
+
+int PASEPlanner_AD::set_start(int start_state_id)
+{
+    m_start_state_id = start_state_id;
+    return 1;
+}
+
+// Every call to replan() searches anew, so changes to edge costs require no
+// further action
+void PASEPlanner_AD::costs_changed(const StateChangeQuery &stateChange)
+{
+}
+
+int PASEPlanner_AD::force_planning_from_scratch()
+{
+    return 1;
+}
+
+int PASEPlanner_AD::set_search_mode(bool bSearchUntilFirstSolution)
+{
+    ROS_DEBUG_NAMED(SLOG, "planner: search mode set to %d", bSearchUntilFirstSolution);
+    m_bounded = !bSearchUntilFirstSolution;
+    return 1;
+}
+
+int PASEPlanner_AD::force_planning_from_scratch_and_free_memory()
+{
+    force_planning_from_scratch();
+    m_open.clear();
+    m_being_expanded.clear();
+    m_graph_to_search_map.clear();
+    m_graph_to_search_map.shrink_to_fit();
+    for (PASEState *s : m_states) {
+        delete s;
+    }
+    m_states.clear();
+    m_states.shrink_to_fit();
+    return 1;
+}
+
+// Repeatedly select a state that is safe to expand, generate its successors
+// and their heuristics outside of the lock, and update the search with them,
+// until the goal is selected, time runs out, or all states have been
+// expanded.
+void PASEPlanner_AD::searchLoop(int worker)
+{
+    SuccessorBuffer succs;
+    SelectionBuffer selection;
+    std::vector<unsigned int> succ_h;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_status == SEARCHING) {
+        if (timedOut()) {
+            m_status = TIMED_OUT;
+            break;
+        }
+
+        if (m_open.empty() && m_being_expanded.empty()) {
+            m_status = EXHAUSTED;
+            break;
+        }
+
+        PASEState *s = selectState(lock, selection);
+        if (m_status != SEARCHING) {
+            break;
+        }
+        if (!s) {
+            // wait for an expansion to finish
+            m_cv.wait(lock);
+            continue;
+        }
+
+        if (s->state_id == m_goal_state_id) {
+            ROS_DEBUG_NAMED(SLOG, "Found path to goal");
+            m_status = FOUND;
+            break;
+        }
+
+        ROS_DEBUG_NAMED(SELOG, "[%d] Expand state %d", worker, s->state_id);
+
+        m_open.erase(s);
+        s->status = PASEState::BEING_EXPANDED;
+        m_being_expanded.push_back(s);
+        m_space->expandingState(s->state_id);
+        ++m_expand_count;
+        ++m_version;
+
+        lock.unlock();
+        {
+            std::unique_lock<std::mutex> expand_lock(m_expand_mutex, std::defer_lock);
+            if (!m_concurrent) {
+                expand_lock.lock();
+            }
+            m_space->GetSuccs(s->state_id, &succs);
+            succ_h.resize(succs.size());
+            for (size_t sidx = 0; sidx < succs.size(); ++sidx) {
+                succ_h[sidx] = computeHeuristic(succs.ids[sidx]);
+            }
+        }
+        lock.lock();
+
+        updateSuccessors(s, succs, succ_h);
+        removeBeingExpanded(s);
+        s->status = PASEState::CLOSED;
+        ++m_version;
+        m_cv.notify_all();
+    }
+
+    // wake up waiting threads to observe the termination
+    m_cv.notify_all();
+}
+
+// Return the first state in OPEN, among the first m_max_candidates, that is
+// independent of all states ahead of it and being expanded, or nullptr if
+// there is none.
+//
+// The pairwise heuristics are evaluated with the lock released, against a
+// snapshot of the front of OPEN and of the states being expanded. If the
+// search changed in the meantime, the selected state is checked against the
+// states that were not part of the snapshot once more before it is returned;
+// if that fails as well, the selection starts over.
+PASEState *PASEPlanner_AD::selectState(
+    std::unique_lock<std::mutex> &lock,
+    SelectionBuffer &buf)
+{
+    while (m_status == SEARCHING) {
+        const unsigned int version = m_version;
+        buf.expanding.clear();
+        for (PASEState *p : m_being_expanded) {
+            buf.expanding.push_back(Candidate{ p, p->g });
+        }
+        buf.open.clear();
+        for (PASEState *p : m_open) {
+            if (m_max_candidates > 0 && (int)buf.open.size() >= m_max_candidates) {
+                break;
+            }
+            buf.open.push_back(Candidate{ p, p->g });
+        }
+
+        lock.unlock();
+        int selected = -1;
+        {
+            std::unique_lock<std::mutex> expand_lock(m_expand_mutex, std::defer_lock);
+            if (!m_concurrent) {
+                expand_lock.lock();
+            }
+            for (size_t i = 0; i < buf.open.size(); ++i) {
+                const Candidate &c = buf.open[i];
+                if (isIndependent(c, buf.expanding.begin(), buf.expanding.end()) &&
+                    isIndependent(c, buf.open.begin(), buf.open.begin() + i))
+                {
+                    selected = (int)i;
+                    break;
+                }
+            }
+        }
+        lock.lock();
+
+        if (selected < 0) {
+            if (m_version == version) {
+                return nullptr;
+            }
+            continue;
+        }
+
+        const Candidate c = buf.open[selected];
+        if (c.state->status != PASEState::OPEN || c.state->g != c.g) {
+            continue;
+        }
+        if (m_version == version) {
+            return c.state;
+        }
+
+        // collect the states that s now depends on which were not checked
+        buf.checked.clear();
+        buf.checked.insert(buf.checked.end(), buf.expanding.begin(), buf.expanding.end());
+        buf.checked.insert(buf.checked.end(), buf.open.begin(), buf.open.begin() + selected);
+        std::sort(buf.checked.begin(), buf.checked.end(), CandidateLess());
+        auto checked = [&](PASEState *p)
+        {
+            auto it = std::lower_bound(
+                    buf.checked.begin(), buf.checked.end(),
+                    Candidate{ p, 0 }, CandidateLess());
+            return it != buf.checked.end() && it->state == p && it->g == p->g;
+        };
+
+        buf.expanding.clear();
+        for (PASEState *p : m_being_expanded) {
+            if (!checked(p)) {
+                buf.expanding.push_back(Candidate{ p, p->g });
+            }
+        }
+        for (auto it = m_open.begin(); *it != c.state; ++it) {
+            if (!checked(*it)) {
+                buf.expanding.push_back(Candidate{ *it, (*it)->g });
+            }
+        }
+        if (buf.expanding.empty()) {
+            return c.state;
+        }
+
+        const unsigned int recheck_version = m_version;
+        lock.unlock();
+        bool independent;
+        {
+            std::unique_lock<std::mutex> expand_lock(m_expand_mutex, std::defer_lock);
+            if (!m_concurrent) {
+                expand_lock.lock();
+            }
+            independent = isIndependent(c, buf.expanding.begin(), buf.expanding.end());
+        }
+        lock.lock();
+
+        if (independent && m_version == recheck_version) {
+            return c.state;
+        }
+    }
+    return nullptr;
+}
+
+// Test whether the cost-to-come of a state may be reduced by the expansion of
+// any state in the range [first, last).
+bool PASEPlanner_AD::isIndependent(
+    const Candidate &s,
+    std::vector<Candidate>::const_iterator first,
+    std::vector<Candidate>::const_iterator last) const
+{
+    for (auto it = first; it != last; ++it) {
+        const double bound = (double)it->g + m_indep_eps *
+                computePairwiseHeuristic(it->state->state_id, s.state->state_id);
+        if ((double)s.g > bound) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Update the cost-to-come of the successors of an expanded state. States that
+// are being or have been expanded are not reopened.
+void PASEPlanner_AD::updateSuccessors(
+    PASEState *s,
+    const SuccessorBuffer &succs,
+    const std::vector<unsigned int> &succ_h)
+{
+    ROS_DEBUG_NAMED(SELOG, "  %zu successors", succs.size());
+
+    for (size_t sidx = 0; sidx < succs.size(); ++sidx) {
+        PASEState *succ_state = getSearchState(succs.ids[sidx]);
+        reinitSearchState(succ_state, succ_h[sidx]);
+
+        if (succ_state->status == PASEState::BEING_EXPANDED ||
+            succ_state->status == PASEState::CLOSED)
+        {
+            continue;
+        }
+
+        const unsigned int new_cost = s->g + succs.costs[sidx];
+        if (new_cost >= succ_state->g) {
+            continue;
+        }
+
+        if (succ_state->status == PASEState::OPEN) {
+            m_open.erase(succ_state);
+        }
+        succ_state->g = new_cost;
+        succ_state->f = computeKey(succ_state);
+        succ_state->bestpredstate = s;
+        succ_state->status = PASEState::OPEN;
+        m_open.insert(succ_state);
+    }
+}
+
+void PASEPlanner_AD::removeBeingExpanded(PASEState *s)
+{
+    auto it = std::find(m_being_expanded.begin(), m_being_expanded.end(), s);
+    assert(it != m_being_expanded.end());
+    *it = m_being_expanded.back();
+    m_being_expanded.pop_back();
+}
+
+bool PASEPlanner_AD::timedOut() const
+{
+    if (m_space->interruptRequested()) {
+        return true;
+    }
+    if (!m_bounded) {
+        return false;
+    }
+    return sbpl::clock::now() - m_start_time >= m_allowed_time;
+}
+
+unsigned int PASEPlanner_AD::computeKey(const PASEState *s) const
+{
+    if (s->g >= INFINITECOST) {
+        return INFINITECOST;
+    }
+    return s->g + (unsigned int)(m_initial_eps * s->h);
+}
+
+unsigned int PASEPlanner_AD::computeHeuristic(int state_id) const
+{
+    if (m_heur) {
+        return m_heur->GetGoalHeuristic(state_id);
+    }
+    return m_space->GetGoalHeuristic(state_id);
+}
+
+int PASEPlanner_AD::computePairwiseHeuristic(int from_id, int to_id) const
+{
+    if (to_id == m_goal_state_id) {
+        return computeHeuristic(from_id);
+    }
+    if (m_heur) {
+        return m_heur->GetFromToHeuristic(from_id, to_id);
+    }
+    return m_space->GetFromToHeuristic(from_id, to_id);
+}
+
+// Get the search state corresponding to a graph state, creating a new state if
+// one has not been created yet.
+PASEState *PASEPlanner_AD::getSearchState(int state_id)
+{
+    if ((int)m_graph_to_search_map.size() <= state_id) {
+        m_graph_to_search_map.resize(state_id + 1, -1);
+    }
+
+    if (m_graph_to_search_map[state_id] != -1) {
+        return m_states[m_graph_to_search_map[state_id]];
+    }
+
+    m_graph_to_search_map[state_id] = (int)m_states.size();
+
+    PASEState *ss = new PASEState;
+    ss->state_id = state_id;
+    ss->call_number = 0;
+    m_states.push_back(ss);
+    return ss;
+}
+
+// Lazily (re)initialize a search state.
+void PASEPlanner_AD::reinitSearchState(PASEState *state)
+{
+    if (state->call_number != m_call_number) {
+        reinitSearchState(state, computeHeuristic(state->state_id));
+    }
+}
+
+// Lazily (re)initialize a search state with a precomputed heuristic.
+void PASEPlanner_AD::reinitSearchState(PASEState *state, unsigned int h)
+{
+    if (state->call_number != m_call_number) {
+        state->g = INFINITECOST;
+        state->h = h;
+        state->f = INFINITECOST;
+        state->call_number = m_call_number;
+        state->status = PASEState::NEW;
+        state->bestpredstate = nullptr;
+    }
+}
+
+// Extract the path from the start state up to a new state.
+void PASEPlanner_AD::extractPath(
+    PASEState *to_state,
+    std::vector<int> &solution,
+    int &cost) const
+{
+    for (PASEState *s = to_state; s; s = s->bestpredstate) {
+        solution.push_back(s->state_id);
+    }
+    std::reverse(solution.begin(), solution.end());
+    cost = to_state->g;
+}
+
+} // namespace adim
@@ -0,0 +1,146 @@
+#include <sbpl_adaptive/core/search/planner_trace.h>
+
+// standard includes
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+namespace adim {
+
+const char *to_string(TraceEvent::Type type)
+{
+    switch (type) {
+    case TraceEvent::QUERY_START:       return "query_start";
+    case TraceEvent::QUERY_END:         return "query_end";
+    case TraceEvent::ITERATION_START:   return "iteration_start";
+    case TraceEvent::PHASE_START:       return "phase_start";
+    case TraceEvent::PHASE_END:         return "phase_end";
+    case TraceEvent::SEARCH:            return "search";
+    case TraceEvent::SPHERE_INSERTED:   return "sphere_inserted";
+    case TraceEvent::COST_RATIO:        return "cost_ratio";
+    case TraceEvent::PARTIAL_PATH:      return "partial_path";
+    default:                            return "unknown";
+    }
+}
+
+const char *to_string(TraceEvent::Phase phase)
+{
+    switch (phase) {
+    case TraceEvent::PLANNING:  return "planning";
+    case TraceEvent::TRACKING:  return "tracking";
+    default:                    return "none";
+    }
+}
+
+PlannerTrace::PlannerTrace(size_t capacity) :
+    enabled_(false),
+    capacity_(std::max(capacity, (size_t)1)),
+    slots_(new Slot[std::max(capacity, (size_t)1)]),
+    head_(0),
+    epoch_(sbpl::clock::now())
+{
+    for (size_t i = 0; i < capacity_; ++i) {
+        slots_[i].seq.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::vector<TraceEvent> PlannerTrace::events() const
+{
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t begin = head > capacity_ ? head - capacity_ : 0;
+
+    std::vector<TraceEvent> events;
+    events.reserve(head - begin);
+    for (uint64_t i = begin; i < head; ++i) {
+        const Slot &slot = slots_[i % capacity_];
+        if (slot.seq.load(std::memory_order_acquire) != i + 1) {
+            continue;
+        }
+        TraceEvent event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != i + 1) {
+            continue;
+        }
+        events.push_back(event);
+    }
+    return events;
+}
+
+void PlannerTrace::clear()
+{
+    for (size_t i = 0; i < capacity_; ++i) {
+        slots_[i].seq.store(0, std::memory_order_relaxed);
+    }
+    epoch_ = sbpl::clock::now();
+    head_.store(0, std::memory_order_release);
+}
+
+bool PlannerTrace::dumpJSON(const std::string &path) const
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+
+    const std::vector<TraceEvent> evs = events();
+    fprintf(f, "{\"recorded\":%llu,\"events\":[", (unsigned long long)numRecorded());
+    for (size_t i = 0; i < evs.size(); ++i) {
+        const TraceEvent &e = evs[i];
+        fprintf(f, "%s\n{\"t\":%lld,\"type\":\"%s\",\"phase\":\"%s\",\"iter\":%d,\"value\":%lld,\"real\":%.9g}",
+                i ? "," : "",
+                (long long)e.time_ns,
+                to_string((TraceEvent::Type)e.type),
+                to_string((TraceEvent::Phase)e.phase),
+                (int)e.iteration,
+                (long long)e.value,
+                e.real);
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
+
+bool PlannerTrace::dumpBinary(const std::string &path) const
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    const std::vector<TraceEvent> evs = events();
+    const char magic[4] = { 'A', 'D', 'T', 'R' };
+    const uint32_t version = 1;
+    const uint64_t count = evs.size();
+    bool ok =
+            fwrite(magic, sizeof(magic), 1, f) == 1 &&
+            fwrite(&version, sizeof(version), 1, f) == 1 &&
+            fwrite(&count, sizeof(count), 1, f) == 1 &&
+            (evs.empty() || fwrite(evs.data(), sizeof(TraceEvent), evs.size(), f) == evs.size());
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+void PlannerTrace::push(
+    TraceEvent::Type type,
+    TraceEvent::Phase phase,
+    int iteration,
+    int64_t value,
+    double real)
+{
+    const uint64_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots_[index % capacity_];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.event.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            sbpl::clock::now() - epoch_).count();
+    slot.event.type = type;
+    slot.event.phase = phase;
+    slot.event.iteration = iteration;
+    slot.event.value = value;
+    slot.event.real = real;
+
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+} // namespace adim
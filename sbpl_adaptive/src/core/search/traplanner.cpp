@@ -2,25 +2,53 @@
 
 #include <sbpl_adaptive/core/search/traplanner.h>
 
+// standard includes
+#include <limits.h>
+#include <limits>
 
-#define ARAMDP_STATEID2IND_AD STATEID2IND_SLOT1
-#define ARA_AD_INCONS_LIST_ID 1
+// system includes
+#include <ros/console.h>
 
-namespace sbpl {
+namespace adim {
 
 static const char* SLOG = "search";
 static const char* SELOG = "search.expansions";
 
-TRAPlanner::TRAPlanner( DiscreteSpaceInformation* space, Heuristic* heuristic, bool bSearchForward)
+// step assigned to states not created or expanded
+static const unsigned int NO_STEP = UINT_MAX;
+
+ADTRAPlannerAllocator::ADTRAPlannerAllocator(Heuristic *heuristic) :
+    heuristic_(heuristic)
+{
+}
+
+SBPLPlanner *ADTRAPlannerAllocator::make(
+    AdaptiveDiscreteSpace *space,
+    bool forward_search) const
+{
+    if (!forward_search) {
+        ROS_ERROR_NAMED(SLOG, "TRAPlanner only supports forward search");
+        return nullptr;
+    }
+
+    return new TRAPlanner(space, heuristic_, forward_search);
+}
+
+TRAPlanner::TRAPlanner(
+    AdaptiveDiscreteSpace* space,
+    Heuristic* heuristic,
+    bool bSearchForward)
 :
-   SBPLPlanner(),
+    SBPLPlanner(),
     m_space(space),
     m_heur(heuristic),
     m_time_params(),
     m_initial_eps(1.0),
     m_final_eps(1.0),
     m_delta_eps(1.0),
+    m_satisfied_eps(std::numeric_limits<double>::infinity()),
     m_allow_partial_solutions(false),
+    bforwardsearch(bSearchForward),
     m_states(),
     m_start_state_id(-1),
     m_goal_state_id(-1),
@@ -32,15 +60,13 @@ TRAPlanner::TRAPlanner( DiscreteSpaceInformation* space, Heuristic* heuristic, b
     m_call_number(0),
     m_last_start_state_id(-1),
     m_last_goal_state_id(-1),
-    m_last_eps(1.0),
     m_expand_count_init(0),
+    m_search_time_init(sbpl::clock::duration::zero()),
     m_expand_count(0),
-    m_search_time_init(clock::duration::zero()),
-    m_search_time(clock::duration::zero()),
-    m_satisfied_eps(std::numeric_limits<double>::infinity()),
-    bforwardsearch(bSearchForward),
-    bsearchuntilfirstsolution(false),
-    MaxMemoryCounter(0)
+    m_search_time(sbpl::clock::duration::zero()),
+    m_expansion_step(1),
+    m_first_iteration_end(NO_STEP),
+    m_seen_states()
 {
     environment_ = space;
 
@@ -49,9 +75,13 @@ TRAPlanner::TRAPlanner( DiscreteSpaceInformation* space, Heuristic* heuristic, b
     m_time_params.type = TimeParameters::TIME;
     m_time_params.max_expansions_init = 0;
     m_time_params.max_expansions = 0;
-    m_time_params.max_allowed_time_init = clock::duration::zero();
-    m_time_params.max_allowed_time = clock::duration::zero();
-    ROS_WARN_STREAM("Tree Restoring A* instantiated!");
+    m_time_params.max_allowed_time_init = sbpl::clock::duration::zero();
+    m_time_params.max_allowed_time = sbpl::clock::duration::zero();
+
+    if (!bforwardsearch) {
+        ROS_ERROR_NAMED(SLOG, "TRAPlanner only supports forward search");
+    }
+    ROS_DEBUG_NAMED(SLOG, "Tree Restoring A* instantiated!");
 }
 
 TRAPlanner::~TRAPlanner()
@@ -66,9 +96,9 @@ void TRAPlanner::get_search_stats(std::vector<PlannerStats>* s)
 {
     PlannerStats stats;
     stats.eps = m_curr_eps;
-    stats.cost;
+    stats.cost = -1;
     stats.expands = m_expand_count;
-    stats.time = to_seconds(m_search_time);
+    stats.time = sbpl::to_seconds(m_search_time);
     s->push_back(stats);
 }
 
@@ -82,67 +112,50 @@ enum ReplanResultCode
     EXHAUSTED_OPEN_LIST
 };
 
-int TRAPlanner::replan(const TimeParameters& params,std::vector<int>* solution,int* cost)
+int TRAPlanner::replan(
+    const TimeParameters& params,
+    std::vector<int>* solution,
+    int* cost)
 {
     ROS_DEBUG_NAMED(SLOG, "Find path to goal");
 
     if (m_start_state_id < 0) {
         ROS_ERROR_NAMED(SLOG, "Start state not set");
-        return !START_NOT_SET;
+        return 0;
     }
     if (m_goal_state_id < 0) {
         ROS_ERROR_NAMED(SLOG, "Goal state not set");
-        return !GOAL_NOT_SET;
+        return 0;
     }
 
     m_time_params = params;
 
-    TRAState* start_state = getSearchState(m_start_state_id);
-    TRAState* goal_state = getSearchState(m_goal_state_id);
-
-    if (m_start_state_id != m_last_start_state_id) {
+    // the heuristics depend on the goal, which tree restoration does not
+    // account for, so any change to the query starts the search anew
+    if (m_start_state_id != m_last_start_state_id ||
+        m_goal_state_id != m_last_goal_state_id)
+    {
         ROS_DEBUG_NAMED(SLOG, "Reinitialize search");
-        m_open.clear();
-        m_incons.clear();
-        ++m_call_number; // trigger state reinitializations
-
-        reinitSearchState(start_state);
-        reinitSearchState(goal_state);
-
-        start_state->g = 0;
-        start_state->f = computeKey(start_state);
-        m_open.push(start_state);
-
-        m_iteration = 1; // 0 reserved for "not closed on any iteration"
+        InitializeSearch();
 
         m_expand_count_init = 0;
-        m_search_time_init = clock::duration::zero();
+        m_search_time_init = sbpl::clock::duration::zero();
 
         m_expand_count = 0;
-        m_search_time = clock::duration::zero();
-
-        m_curr_eps = m_initial_eps;
-
-        m_satisfied_eps = std::numeric_limits<double>::infinity();
+        m_search_time = sbpl::clock::duration::zero();
 
         m_last_start_state_id = m_start_state_id;
-    }
-
-    if (m_goal_state_id != m_last_goal_state_id) {
-        ROS_DEBUG_NAMED(SLOG, "Refresh heuristics, keys, and reorder open list");
-        recomputeHeuristics();
-        reorderOpen();
-        heuristicChanged();
         m_last_goal_state_id = m_goal_state_id;
     }
 
-    auto start_time = clock::now();
+    TRAState* goal_state = getSearchState(m_goal_state_id);
+
+    auto start_time = sbpl::clock::now();
     int num_expansions = 0;
-    clock::duration elapsed_time = clock::duration::zero();
+    sbpl::clock::duration elapsed_time = sbpl::clock::duration::zero();
 
-    int err;
-    while (m_satisfied_eps > m_final_eps)
-    {
+    int err = SUCCESS;
+    while (m_satisfied_eps > m_final_eps) {
         if (m_curr_eps == m_satisfied_eps) {
             if (!m_time_params.improve) {
                 break;
@@ -161,59 +174,46 @@ int TRAPlanner::replan(const TimeParameters& params,std::vector<int>* solution,i
         }
         err = improvePath(start_time, goal_state, num_expansions, elapsed_time);
         if (m_curr_eps == m_initial_eps) {
-            m_expand_count_init += num_expansions;
-            m_search_time_init += elapsed_time;
+            // count the effort of this call only
+            m_expand_count_init = num_expansions;
+            m_search_time_init = elapsed_time;
         }
         if (err) {
             break;
         }
         ROS_DEBUG_NAMED(SLOG, "Improved solution");
         m_satisfied_eps = m_curr_eps;
+        if (m_iteration == 1) {
+            m_first_iteration_end = m_expansion_step;
+        }
     }
 
     m_search_time += elapsed_time;
     m_expand_count += num_expansions;
 
+    solution->clear();
     if (m_satisfied_eps == std::numeric_limits<double>::infinity()) {
         if (m_allow_partial_solutions && !m_open.empty()) {
             TRAState* next_state = m_open.min();
             extractPath(next_state, *solution, *cost);
-            return !SUCCESS;
         }
-        return !err;
+        return 0;
     }
 
     extractPath(goal_state, *solution, *cost);
-    return !SUCCESS;
+    return 1;
 }
 
-int TRAPlanner::replan( double allowed_time, std::vector<int>* solution)
+int TRAPlanner::replan(double allowed_time, std::vector<int>* solution)
 {
     int cost;
     return replan(allowed_time, solution, &cost);
 }
 
-// decide whether to start the search from scratch
-//
-// if start changed
-//     reset the search to its initial state
-// if goal changed
-//     reevaluate heuristics
-//     reorder the open list
-//
-// case scenario_hasnt_changed (start and goal the same)
-//   case have solution for previous epsilon
-//       case epsilon lowered
-//           reevaluate heuristics and reorder the open list
-//       case epsilon raised
-//           pass
-//   case dont have solution
-//       case epsilon lowered
-//           reevaluate heuristics and reorder the open list
-//       case epsilon raised
-//           reevaluate heuristics and reorder the open list
-// case scenario_changed
-int TRAPlanner::replan( double allowed_time, std::vector<int>* solution, int* cost)
+int TRAPlanner::replan(
+    double allowed_time,
+    std::vector<int>* solution,
+    int* cost)
 {
     TimeParameters tparams = m_time_params;
     if (tparams.max_allowed_time_init == tparams.max_allowed_time) {
@@ -222,22 +222,25 @@ int TRAPlanner::replan( double allowed_time, std::vector<int>* solution, int* co
         // to track the allowed time for further calls to replan. perhaps set
         // an explicit flag for using repair time or an indicator value as is
         // done with ReplanParams
-        tparams.max_allowed_time_init = to_duration(allowed_time);
-        tparams.max_allowed_time = to_duration(allowed_time);
+        tparams.max_allowed_time_init = sbpl::to_duration(allowed_time);
+        tparams.max_allowed_time = sbpl::to_duration(allowed_time);
     } else {
-        tparams.max_allowed_time_init = to_duration(allowed_time);
+        tparams.max_allowed_time_init = sbpl::to_duration(allowed_time);
         // note: retain original allowed improvement time
     }
     return replan(tparams, solution, cost);
 }
 
-int TRAPlanner::replan( std::vector<int>* solution, ReplanParams params)
+int TRAPlanner::replan(std::vector<int>* solution, ReplanParams params)
 {
     int cost;
     return replan(solution, params, &cost);
 }
 
-int TRAPlanner::replan( std::vector<int>* solution, ReplanParams params, int* cost)
+int TRAPlanner::replan(
+    std::vector<int>* solution,
+    ReplanParams params,
+    int* cost)
 {
     // note: if replan fails before internal time parameters are updated (this
     // happens if the start or goal has not been set), then the internal
@@ -249,74 +252,83 @@ int TRAPlanner::replan( std::vector<int>* solution, ReplanParams params, int* co
     return replan(tparams, solution, cost);
 }
 
-
 int TRAPlanner::set_goal(int goal_state_id)
 {
-    /*if (bforwardsearch) {
-        if (SetSearchGoalState(goal_stateID, pSearchStateSpace_) != 1) {
-            SBPL_ERROR("ERROR: failed to set search goal state\n");
-            return 0;
-        }
-    }
-    else {
-        if (SetSearchStartState(goal_stateID, pSearchStateSpace_) != 1) {
-            SBPL_ERROR("ERROR: failed to set search start state\n");
-            return 0;
-        }
-    }
-
-    return 1;*/
     m_goal_state_id = goal_state_id;
     return 1;
 }
 
 int TRAPlanner::set_start(int start_state_id)
 {
-    /*if (bforwardsearch) {
-        if (SetSearchStartState(start_stateID, pSearchStateSpace_) != 1) {
-            SBPL_ERROR("ERROR: failed to set search start state\n");
-            return 0;
-        }
-    }
-    else {
-        if (SetSearchGoalState(start_stateID, pSearchStateSpace_) != 1) {
-            SBPL_ERROR("ERROR: failed to set search goal state\n");
-            return 0;
-        }
-    }
-
-    return 1;*/
     m_start_state_id = start_state_id;
     return 1;
 }
 
 //TODO: change implementation to recompute expansion and heuristics if needed
+// Restore the search tree to the first expansion affected by the change. The
+// outgoing edges of a state are only used when it is expanded, so the first
+// affected expansion is the earliest expansion of a state whose outgoing edges
+// changed. An expansion step reported by the environment is also respected.
 void TRAPlanner::costs_changed(const StateChangeQuery& stateChange)
 {
-    ROS_ERROR_NAMED(SLOG,"costs_changed(..) reInit!");
-    force_planning_from_scratch();
+    if (!bforwardsearch || m_last_start_state_id < 0) {
+        ROS_DEBUG_NAMED(SLOG, "costs_changed(..) reInit!");
+        force_planning_from_scratch();
+        return;
+    }
+
+    unsigned int first_step = NO_STEP;
+
+    const AdaptiveStateChangeQuery* query =
+            dynamic_cast<const AdaptiveStateChangeQuery*>(&stateChange);
+    if (query && query->expansion_step >= 0) {
+        first_step = (unsigned int)query->expansion_step;
+    }
+
+    const std::vector<int>* changed = stateChange.getPredecessors();
+    if (changed) {
+        for (int state_id : *changed) {
+            if (state_id < 0 || state_id >= (int)m_graph_to_search_map.size() ||
+                m_graph_to_search_map[state_id] == -1)
+            {
+                continue; // never seen by the search
+            }
+            const TRAState* s = m_states[m_graph_to_search_map[state_id]];
+            if (s->call_number != m_call_number) {
+                continue; // not part of the current search
+            }
+            first_step = std::min(first_step, s->E);
+        }
+    }
+
+    if (first_step == NO_STEP) {
+        ROS_DEBUG_NAMED(SLOG, "costs_changed(..) does not affect the search tree");
+        return;
+    }
+
+    ROS_DEBUG_NAMED(SLOG, "costs_changed(..) restore to expansion step %u", first_step);
+    restoreSearchTree((int)first_step);
 }
 
 void TRAPlanner::costs_changed()
 {
-    ROS_ERROR_NAMED(SLOG,"costs_changed() reInit!");
+    ROS_DEBUG_NAMED(SLOG, "costs_changed() reInit!");
     force_planning_from_scratch_and_free_memory();
 }
 
-
 int TRAPlanner::force_planning_from_scratch()
 {
     m_last_start_state_id = -1;
     m_last_goal_state_id = -1;
-    return 0;
+    return 1;
 }
 
 int TRAPlanner::set_search_mode(bool bSearchUntilFirstSolution)
 {
-    ROS_DEBUG_NAMED(SLOG,"planner: search mode set to %d\n", bSearchUntilFirstSolution);
+    ROS_DEBUG_NAMED(SLOG, "planner: search mode set to %d", bSearchUntilFirstSolution);
 
     m_time_params.bounded = !bSearchUntilFirstSolution;
-    return 0;
+    return 1;
 }
 
 /// Force the planner to forget previous search efforts, begin from scratch,
@@ -325,6 +337,8 @@ int TRAPlanner::force_planning_from_scratch_and_free_memory()
 {
     force_planning_from_scratch();
     m_open.clear();
+    m_incons.clear();
+    m_seen_states.clear();
     m_graph_to_search_map.clear();
     m_graph_to_search_map.shrink_to_fit();
     for (TRAState* s : m_states) {
@@ -332,34 +346,122 @@ int TRAPlanner::force_planning_from_scratch_and_free_memory()
     }
     m_states.clear();
     m_states.shrink_to_fit();
-    return 0;
+    return 1;
 }
 
-void TRAPlanner::update_succs_of_changededges(std::vector<int>* succsIDV)
-{
+/// Restore the search tree to its state before the expansion at step \p
+/// expansion_step, i.e. after the expansions at all earlier steps. States
+/// expanded before that step remain closed, states created before it are
+/// returned to OPEN with their cost-to-come and parent at that time, and all
+/// other states are discarded. The next call to replan() resumes the search
+/// from the restored tree.
+///
+/// If the step lies past the end of the first search iteration, the tree is
+/// restored to the end of the first iteration. Restoring to step 1 or earlier
+/// is equivalent to starting the search anew.
+void TRAPlanner::restoreSearchTree(int expansion_step)
+{
+    if (expansion_step < 0 ||
+        m_last_start_state_id < 0 ||
+        (unsigned int)expansion_step >= m_expansion_step)
+    {
+        // nothing expanded at or after this step
+        return;
+    }
 
-}
+    unsigned int step = (unsigned int)expansion_step;
+    if (m_iteration > 1) {
+        step = std::min(step, m_first_iteration_end);
+    }
 
-//TODO: implement!!!!!!!!!!!
-/// \brief direct form of informing the search about the new edge costs
-/// \param predsIDV array of predecessors of changed edges
-/// \note this is used when the search is run backwards
-void TRAPlanner::update_preds_of_changededges(std::vector<int>* predsIDV)
-{
+    ROS_DEBUG_NAMED(SLOG, "Restore search tree to expansion step %u (current step: %u)", step, m_expansion_step);
 
-}
+    if (step <= 1) {
+        InitializeSearch();
+        return;
+    }
 
+    m_open.clear();
+    m_incons.clear();
+    m_iteration = 1;
+    m_curr_eps = m_initial_eps;
+    m_satisfied_eps = std::numeric_limits<double>::infinity();
+    m_first_iteration_end = NO_STEP;
+
+    TRAState* start_state = getSearchState(m_start_state_id);
+
+    size_t num_seen = 0;
+    for (TRAState* s : m_seen_states) {
+        // forget all updates made at or after the restoration step
+        auto hit = std::lower_bound(s->step_hist.begin(), s->step_hist.end(), step);
+        size_t num_updates = std::distance(s->step_hist.begin(), hit);
+        s->parent_hist.resize(num_updates);
+        s->gval_hist.resize(num_updates);
+        s->step_hist.resize(num_updates);
+
+        if (s == start_state) {
+            s->g = 0;
+            s->bestpredstate = nullptr;
+        }
+        else if (num_updates == 0) {
+            // state not created yet
+            s->g = INFINITECOST;
+            s->f = INFINITECOST;
+            s->eg = INFINITECOST;
+            s->C = NO_STEP;
+            s->E = NO_STEP;
+            s->iteration_closed = 0;
+            s->bestpredstate = nullptr;
+            s->incons = false;
+            continue;
+        }
+        else {
+            s->g = s->gval_hist.back();
+            s->bestpredstate = s->parent_hist.back();
+        }
+
+        s->f = computeKey(s);
+        if (s->E < step) {
+            // state created and expanded; recover its g-value at the time of
+            // expansion to determine whether it has become inconsistent since
+            s->iteration_closed = m_iteration;
+            s->eg = 0;
+            for (size_t i = 0; i < num_updates && s->step_hist[i] < s->E; ++i) {
+                s->eg = s->gval_hist[i];
+            }
+            s->incons = s->g < s->eg;
+            if (s->incons) {
+                m_incons.push_back(s);
+            }
+        }
+        else {
+            // state created only
+            s->E = NO_STEP;
+            s->eg = INFINITECOST;
+            s->iteration_closed = 0;
+            s->incons = false;
+            m_open.push(s);
+        }
+
+        m_seen_states[num_seen++] = s;
+    }
+    m_seen_states.resize(num_seen);
+
+    m_expansion_step = step;
+}
 
 // Convert TimeParameters to ReplanParams. Uses the current epsilon values
 // to fill in the epsilon fields.
-void TRAPlanner::convertTimeParamsToReplanParams(const TimeParameters& t, ReplanParams& r) const
+void TRAPlanner::convertTimeParamsToReplanParams(
+    const TimeParameters& t,
+    ReplanParams& r) const
 {
-    r.max_time = to_seconds(t.max_allowed_time_init);
+    r.max_time = sbpl::to_seconds(t.max_allowed_time_init);
     r.return_first_solution = !t.bounded && !t.improve;
     if (t.max_allowed_time_init == t.max_allowed_time) {
         r.repair_time = -1.0;
     } else {
-        r.repair_time = to_seconds(t.max_allowed_time);
+        r.repair_time = sbpl::to_seconds(t.max_allowed_time);
     }
 
     r.initial_eps = m_initial_eps;
@@ -369,16 +471,18 @@ void TRAPlanner::convertTimeParamsToReplanParams(const TimeParameters& t, Replan
 
 // Convert ReplanParams to TimeParameters. Sets the current initial, final, and
 // delta eps from ReplanParams.
-void TRAPlanner::convertReplanParamsToTimeParams(const ReplanParams& r, TimeParameters& t)
+void TRAPlanner::convertReplanParamsToTimeParams(
+    const ReplanParams& r,
+    TimeParameters& t)
 {
     t.type = TimeParameters::TIME;
 
     t.bounded = !r.return_first_solution;
     t.improve = !r.return_first_solution;
 
-    t.max_allowed_time_init = to_duration(r.max_time);
+    t.max_allowed_time_init = sbpl::to_duration(r.max_time);
     if (r.repair_time > 0.0) {
-        t.max_allowed_time = to_duration(r.repair_time);
+        t.max_allowed_time = sbpl::to_duration(r.repair_time);
     } else {
         t.max_allowed_time = t.max_allowed_time_init;
     }
@@ -389,8 +493,14 @@ void TRAPlanner::convertReplanParamsToTimeParams(const ReplanParams& r, TimePara
 }
 
 // Test whether the search has run out of time.
-bool TRAPlanner::timedOut(int elapsed_expansions, const clock::duration& elapsed_time) const
+bool TRAPlanner::timedOut(
+    int elapsed_expansions,
+    const sbpl::clock::duration& elapsed_time) const
 {
+    if (m_space->interruptRequested()) {
+        return true;
+    }
+
     if (!m_time_params.bounded) {
         return false;
     }
@@ -418,14 +528,16 @@ bool TRAPlanner::timedOut(int elapsed_expansions, const clock::duration& elapsed
 
 // Expand states to improve the current solution until a solution within the
 // current suboptimality bound is found, time runs out, or no solution exists.
-int TRAPlanner::improvePath( const clock::time_point& start_time,TRAState* goal_state, int& elapsed_expansions, clock::duration& elapsed_time)
+int TRAPlanner::improvePath(
+    const sbpl::clock::time_point& start_time,
+    TRAState* goal_state,
+    int& elapsed_expansions,
+    sbpl::clock::duration& elapsed_time)
 {
-    std::vector<int> succs;
-    std::vector<int> costs;
     while (!m_open.empty()) {
         TRAState* min_state = m_open.min();
 
-        auto now = clock::now();
+        auto now = sbpl::clock::now();
         elapsed_time = now - start_time;
 
         // path to goal found
@@ -458,57 +570,52 @@ int TRAPlanner::improvePath( const clock::time_point& start_time,TRAState* goal_
 }
 
 // Expand a state, updating its successors and placing them into OPEN, CLOSED,
-// and TRAPlanner list appropriately.
+// and INCONS list appropriately. Records the creation and expansion steps and
+// the parent history required to restore the search tree.
 void TRAPlanner::expand(TRAState* s)
 {
-    s->v = s->g;
-    std::vector<int> succs;
-    std::vector<int> costs;
-    m_space->GetSuccs(s->state_id, &succs, &costs);
+    if (s->E == NO_STEP) {
+        s->E = m_expansion_step;
+    }
 
-    ROS_DEBUG_NAMED(SELOG, "  %zu successors", succs.size());
+    m_space->expandingState(s->state_id);
 
-    for (size_t sidx = 0; sidx < succs.size(); ++sidx) 
-    {
-        int succ_state_id = succs[sidx];
-        int cost = costs[sidx];
+    m_space->GetSuccs(s->state_id, (int)m_expansion_step, &m_succs);
+
+    ROS_DEBUG_NAMED(SELOG, "  %zu successors", m_succs.size());
+
+    for (size_t sidx = 0; sidx < m_succs.size(); ++sidx) {
+        int succ_state_id = m_succs.ids[sidx];
+        int cost = m_succs.costs[sidx];
 
         TRAState* succ_state = getSearchState(succ_state_id);
         reinitSearchState(succ_state);
 
-        int new_cost = s->eg + cost;
-        ROS_DEBUG_NAMED(SELOG, "Compare new cost %d vs old cost %d", new_cost, succ_state->g);
+        unsigned int new_cost = s->eg + cost;
+        ROS_DEBUG_NAMED(SELOG, "Compare new cost %u vs old cost %u", new_cost, succ_state->g);
         if (new_cost < succ_state->g) {
             succ_state->g = new_cost;
-            //for forward search
             succ_state->bestpredstate = s;
-            storeParent(succ_state,s,new_cost,expansion_step);
+            storeParent(succ_state, s, new_cost);
             if (succ_state->iteration_closed != m_iteration) {
                 succ_state->f = computeKey(succ_state);
                 if (m_open.contains(succ_state)) {
                     m_open.decrease(succ_state);
                 } else {
-                    //Set C of current successor
-                    succ_state->C = expansion_step;
-                    seen_states.push_back(succ_state);
+                    if (succ_state->C == NO_STEP) {
+                        succ_state->C = m_expansion_step;
+                        m_seen_states.push_back(succ_state);
+                    }
                     m_open.push(succ_state);
                 }
             } else if (!succ_state->incons) {
+                succ_state->incons = true;
                 m_incons.push_back(succ_state);
             }
         }
     }
-    //update E of current state
-    s->E = expansion_step;
-    expansion_step++;
-}
 
-// Recompute heuristics for all states.
-void TRAPlanner::recomputeHeuristics()
-{
-    for (TRAState* s : m_states) {
-        s->h = m_heur->GetGoalHeuristic(s->state_id);
-    }
+    ++m_expansion_step;
 }
 
 // Recompute the f-values of all states in OPEN and reorder OPEN.
@@ -520,12 +627,22 @@ void TRAPlanner::reorderOpen()
     m_open.make();
 }
 
-
-int TRAPlanner::computeKey(TRAState* s) const
+unsigned int TRAPlanner::computeKey(TRAState* s) const
 {
+    if (s->g >= INFINITECOST) {
+        return INFINITECOST;
+    }
     return s->g + (unsigned int)(m_curr_eps * s->h);
 }
 
+unsigned int TRAPlanner::computeHeuristic(int state_id) const
+{
+    if (m_heur) {
+        return m_heur->GetGoalHeuristic(state_id);
+    }
+    return m_space->GetGoalHeuristic(state_id);
+}
+
 // Get the search state corresponding to a graph state, creating a new state if
 // one has not been created yet.
 TRAState* TRAPlanner::getSearchState(int state_id)
@@ -551,8 +668,8 @@ TRAState* TRAPlanner::createState(int state_id)
     TRAState* ss = new TRAState;
     ss->state_id = state_id;
     ss->call_number = 0;
-    ss->E = 0;
-    ss->C = 0;
+    ss->E = NO_STEP;
+    ss->C = NO_STEP;
     m_states.push_back(ss);
 
     return ss;
@@ -563,314 +680,78 @@ void TRAPlanner::reinitSearchState(TRAState* state)
 {
     if (state->call_number != m_call_number) {
         ROS_DEBUG_NAMED(SELOG, "Reinitialize state %d", state->state_id);
+        state->C = NO_STEP;
+        state->E = NO_STEP;
+        state->parent_hist.clear();
+        state->gval_hist.clear();
+        state->step_hist.clear();
         state->g = INFINITECOST;
-        state->h = m_heur->GetGoalHeuristic(state->state_id);
+        state->h = computeHeuristic(state->state_id);
         state->f = INFINITECOST;
         state->eg = INFINITECOST;
         state->iteration_closed = 0;
         state->call_number = m_call_number;
         state->bestpredstate = nullptr;
-        state->bestnextstate = nullptr;
         state->incons = false;
     }
 }
 
-// Extract the path from the start state up to a new state.
-void TRAPlanner::extractPath(TRAState* to_state, std::vector<int>& solution, int& cost) const
-{
-    //forward search
-    for (TRAState* s = to_state; s; s = s->bestpredstate) {
-        solution.push_back(s->state_id);
-    }
-    std::reverse(solution.begin(), solution.end());
-    cost = to_state->g;
-}
-
-bool TRAPlanner::RestoreSearchTree(unsigned int expansionStep)
-{
-    m_open.clear();
-    m_states.clear();
-    //need to clear closed
-    std::vector<TRAState*> current_seen;
-
-    TRAState* parent;
-    unsigned int parentGVal;
-    if(expansionStep<=0)
-        InitializeSearch();
-    else
-    {
-        for(int i=0;i<seen_states.size();i++)
-        {
-            TRAState* current = seen_states[i];
-            //state created and expanded
-            if(current->E <= expansionStep)
-            {
-                updateParents(current,expansionStep,current->bestpredstate,&parentGVal);
-                current->g = parentGVal;
-                //insert in closed
-                current_seen.push_back(current);
-            }
-            //state created only
-            else if(current->C <= expansionStep)
-            {
-                updateParents(current,expansionStep,current->bestpredstate,&parentGVal);
-                current->g = parentGVal;
-                current->v = INFINITECOST;
-                computeKey(current);
-                m_open.push(current);
-                current->E = INFINITECOST;
-                current_seen.push_back(current);
-            }
-            //state not created yet
-            else
-            {
-                current->v = INFINITECOST;
-                current->g = INFINITECOST;
-                current->C = INFINITECOST;
-                current->E = INFINITECOST;
-                current->bestpredstate = nullptr;
-                current->parent_hist.clear();
-                current->gval_hist.clear();
-            }
-        }
-        seen_states = current_seen;
-        expansion_step = expansionStep+1;
-    }
-}
-
-bool TRAPlanner::updateParents(TRAState* state, unsigned int expansionStep, TRAState* latestParent, unsigned int *latestGVal)
-{
-    unsigned int latestParentStep = 0;
-    latestParent = nullptr;
-    *latestGVal = 0;
-
-    for(int i=0;i<state->parent_hist.size();i++)
-    {
-        TRAState* parent = state->parent_hist[i];
-        //this parent is a valid one for the given expansion step
-        if(parent->E <= expansionStep)
-        {
-            if(parent->E > latestParentStep)
-            {
-                latestParent = parent;
-                latestGVal = &state->gval_hist[i];
-                latestParentStep = parent->E;
-            }
-        }
-        //this parent is not valid for the given expansion step
-        else
-        {
-            state->parent_hist.erase(state->parent_hist.begin() + i);
-            state->gval_hist.erase(state->gval_hist.begin() + i);          
-        }
-    }   
-}
-
-bool TRAPlanner::storeParent(TRAState* succ_state, TRAState* state, unsigned int gVal, unsigned int expansionStep)
-{
-    state->parent_hist.push_back(succ_state);
-    state->gval_hist.push_back(gVal);
-    return 1;
-}
-
-void TRAPlanner::heuristicChanged()
-{   
-    bool done = false;
-    std::vector<unsigned int> inconsE;
-
-    while(!done)
-    {
-        TRAState* minState = m_open.min();
-        //loop on closed
-        for (TRAState* s : m_states) 
-        {
-            unsigned int cost = s->v + (unsigned int)(m_curr_eps * s->h);
-            if(cost > minState->f && minState->C < s->E)
-            {
-                 ROS_ERROR_STREAM("The new E pushed "<<s->E);
-                inconsE.push_back(s->E);
-            }
-        }
-        if(inconsE.empty())
-            done = true;
-        else
-        {
-            unsigned int newStep  = (*std::min_element(inconsE.begin(),inconsE.end())) - 1;
-           
-            RestoreSearchTree(newStep); 
-        }
-    }
-
-}
-
+// Reset the search tree to contain only the start state.
 void TRAPlanner::InitializeSearch()
 {
-    //clear closed
-    TRAState* start = getSearchState(m_start_state_id);
-    m_open.push(start);
-    start->g = 0;
-    computeKey(start);
-    expansion_step = 1;
-    start->C = 0;
-    seen_states.push_back(start);
-    start->E = INFINITECOST;
-}
-
-
-void TRAPlanner::Recomputegval(TRAState* state)
-{
-
-}
-
+    m_open.clear();
+    m_incons.clear();
+    m_seen_states.clear();
+    ++m_call_number; // trigger state reinitializations
 
-// used for backward search
-void TRAPlanner::UpdatePreds(TRAState* state)
-{
-    /*std::vector<int> PredIDV;
-    std::vector<int> CostV;
-    CKey key;
-    TRAState* predstate;
+    TRAState* start_state = getSearchState(m_start_state_id);
+    TRAState* goal_state = getSearchState(m_goal_state_id);
+    reinitSearchState(start_state);
+    reinitSearchState(goal_state);
 
-    m_space->GetPreds(state->MDPstate->StateID, &PredIDV, &CostV);
+    start_state->g = 0;
+    start_state->C = 0;
+    start_state->f = computeKey(start_state);
+    m_open.push(start_state);
+    m_seen_states.push_back(start_state);
 
-    // iterate through predecessors of s
-    for (int pind = 0; pind < (int)PredIDV.size(); pind++) {
-        CMDPSTATE* PredMDPState = GetState(PredIDV[pind], pSearchStateSpace);
-        predstate = (TRAState*)(PredMDPState->PlannerSpecificData);
-        if (predstate->callnumberaccessed != pSearchStateSpace->callnumber) {
-            ReInitializeSearchStateInfo(predstate, pSearchStateSpace);
-        }
+    m_iteration = 1; // 0 reserved for "not closed on any iteration"
+    m_curr_eps = m_initial_eps;
+    m_satisfied_eps = std::numeric_limits<double>::infinity();
 
-        // see if we can improve the value of predstate
-        if (predstate->g > state->v + CostV[pind]) {
-            predstate->g = state->v + CostV[pind];
-            predstate->bestnextstate = state->MDPstate;
-            predstate->costtobestnextstate = CostV[pind];
-
-            // re-insert into heap if not closed yet
-            if (predstate->iterationclosed != pSearchStateSpace->searchiteration) {
-                key.key[0] = predstate->g + (int)(pSearchStateSpace->eps*predstate->h);
-//                key.key[1] = predstate->h;
-                if (predstate->heapindex != 0) {
-                    pSearchStateSpace->heap->updateheap(predstate,key);
-                }
-                else {
-                    pSearchStateSpace->heap->insertheap(predstate,key);
-                }
-            }
-            else if (predstate->listelem[ARA_AD_INCONS_LIST_ID] == NULL) {
-                // take care of incons list
-                pSearchStateSpace->inconslist->insert(predstate, ARA_AD_INCONS_LIST_ID);
-            }
-        }
-    } // for predecessors*/
+    m_expansion_step = 1;
+    m_first_iteration_end = NO_STEP;
 }
 
-// used for forward search
-void TRAPlanner::UpdateSuccs(TRAState* state)
+// Record the update of the cost-to-come of a state at the current step.
+void TRAPlanner::storeParent(
+    TRAState* succ_state,
+    TRAState* state,
+    unsigned int gVal)
 {
-    /*std::vector<int> SuccIDV;
-    std::vector<int> CostV;
-    CKey key;
-    TRAState* succstate;
-
-    m_space->GetSuccs(state->MDPstate->StateID, &SuccIDV, &CostV);
-
-    // iterate through predecessors of s
-    for (int sind = 0; sind < (int)SuccIDV.size(); sind++) {
-        CMDPSTATE* SuccMDPState = GetState(SuccIDV[sind], pSearchStateSpace);
-        int cost = CostV[sind];
-
-        succstate = (TRAState*)(SuccMDPState->PlannerSpecificData);
-        if (succstate->callnumberaccessed != pSearchStateSpace->callnumber) {
-            ReInitializeSearchStateInfo(succstate, pSearchStateSpace);
-        }
-
-        // update generated index
-
-        // see if we can improve the value of succstate
-        // taking into account the cost of action
-        if (succstate->g > state->v + cost) {
-            succstate->g = state->v + cost;
-            succstate->bestpredstate = state->MDPstate;
-
-            // re-insert into heap if not closed yet
-            if (succstate->iterationclosed != pSearchStateSpace->searchiteration) {
-                key.key[0] = succstate->g + (int)(pSearchStateSpace->eps*succstate->h);
-//                key.key[1] = succstate->h;
-
-                if (succstate->heapindex != 0) {
-                    pSearchStateSpace->heap->updateheap(succstate,key);
-                }
-                else {
-                    pSearchStateSpace->heap->insertheap(succstate,key);
-                }
-            }
-            else if (succstate->listelem[ARA_AD_INCONS_LIST_ID] == NULL) {
-                // take care of incons list
-                pSearchStateSpace->inconslist->insert(succstate, ARA_AD_INCONS_LIST_ID);
-            }
-        } // check for cost improvement
-
-    } // for actions
+    succ_state->parent_hist.push_back(state);
+    succ_state->gval_hist.push_back(gVal);
+    succ_state->step_hist.push_back(m_expansion_step);
 }
 
-void TRAPlanner::BuildNewOPENList()
+// Extract the path from the start state up to a new state.
+void TRAPlanner::extractPath(
+    TRAState* to_state,
+    std::vector<int>& solution,
+    int& cost) const
 {
-    /*TRAState* state;
-    CKey key;
-    CHeap* pheap = pSearchStateSpace->heap;
-    CList* pinconslist = pSearchStateSpace->inconslist;
-
-    // move incons into open
-    while (pinconslist->firstelement != NULL) {
-        state = (TRAState*)pinconslist->firstelement->liststate;
-
-        // compute f-value
-        key.key[0] = state->g + (int)(pSearchStateSpace->eps * state->h);
-//        key.key[1] = state->h;
-
-        // insert into OPEN
-        pheap->insertheap(state, key);
-        // remove from INCONS
-        pinconslist->remove(state, ARA_AD_INCONS_LIST_ID);
-    }*/
+    // forward search
+    for (TRAState* s = to_state; s; s = s->bestpredstate) {
+        solution.push_back(s->state_id);
+    }
+    std::reverse(solution.begin(), solution.end());
+    cost = to_state->g;
 }
 
-
 void TRAPlanner::PrintSearchState(TRAState* state, FILE* fOut)
 {
-    SBPL_FPRINTF(fOut, "state %d: h=%d g=%u v=%u iterc=%d callnuma=%d heapind=%d inconslist=%d\n", state->MDPstate->StateID, state->h, state->g, state->v, state->iterationclosed, state->callnumberaccessed, state->heapindex, state->listelem[ARA_AD_INCONS_LIST_ID] ? 1 : 0);
+    SBPL_FPRINTF(fOut, "state %d: h=%u g=%u eg=%u C=%u E=%u iterc=%d callnuma=%d incons=%d\n", state->state_id, state->h, state->g, state->eg, state->C, state->E, state->iteration_closed, state->call_number, state->incons ? 1 : 0);
     m_space->PrintState(state->state_id, true, fOut);
 }
 
-
-namespace motion {
-
-SBPLPlannerPtr TRAPlannerAllocator::allocate(
-    const RobotPlanningSpacePtr& pspace,
-    const RobotHeuristicPtr& heuristic)
-{
-    const bool forward_search = true;
-    auto search = std::make_shared<TRAPlanner>(pspace.get(), heuristic.get(),forward_search);
-
-    double epsilon;
-    pspace->params()->param("epsilon", epsilon, 1.0);
-    search->set_initialsolution_eps(epsilon);
-
-    bool search_mode;
-    pspace->params()->param("search_mode", search_mode, false);
-    search->set_search_mode(search_mode);
-
-    double repair_time;
-    if (pspace->params()->getParam("repair_time", repair_time)) {
-        search->setAllowedRepairTime(repair_time);
-    }
-
-    return search;
-}
-
-} // namespace motion
-
-} // namespace sbpl
-
+} // namespace adim
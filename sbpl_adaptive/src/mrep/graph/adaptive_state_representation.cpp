@@ -72,6 +72,32 @@ void AdaptiveStateRepresentation::addChildRepresentation(
     }
 }
 
+void AdaptiveStateRepresentation::GetLazySuccs(
+    int state_id,
+    std::vector<int> *succs,
+    std::vector<int> *costs,
+    std::vector<bool> *true_costs)
+{
+    const size_t first = succs->size();
+    GetSuccs(state_id, succs, costs);
+    true_costs->resize(first, true);
+    true_costs->resize(succs->size(), true);
+}
+
+int AdaptiveStateRepresentation::EvaluateEdge(int src_id, int dst_id)
+{
+    std::vector<int> succs;
+    std::vector<int> costs;
+    GetSuccs(src_id, &succs, &costs);
+    int cost = -1;
+    for (size_t i = 0; i < succs.size(); ++i) {
+        if (succs[i] == dst_id && (cost < 0 || costs[i] < cost)) {
+            cost = costs[i];
+        }
+    }
+    return cost;
+}
+
 /// If executable, returns this representation, otherwise return the executable
 /// parents of its parents.
 void AdaptiveStateRepresentation::GetExecutableParents(
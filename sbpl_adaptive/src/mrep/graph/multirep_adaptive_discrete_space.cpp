@@ -1,5 +1,9 @@
 #include <sbpl_adaptive/mrep/graph/multirep_adaptive_discrete_space.h>
 
+// standard includes
+#include <limits.h>
+#include <algorithm>
+
 namespace adim {
 
 static const char *GLOG = "mrep";
@@ -70,25 +74,28 @@ MultiRepAdaptiveDiscreteSpace::MultiRepAdaptiveDiscreteSpace() :
     goal_(nullptr),
     goal_hash_entry_(nullptr),
     start_hash_entry_(nullptr),
-    hash_table_size_(32 * 1024),
     hash_tables_(),
     state_id_to_hash_entry_(),
-    proj_matrix_()
+    proj_matrix_(),
+    thread_pool_(),
+    thread_pool_mutex_(),
+    concurrent_expansions_(0),
+    planner_indices_(),
+    hash_entries_(),
+    state_data_(),
+    heap_entries_(),
+    expansion_steps_()
 {
 }
 
 /// Destructor
 MultiRepAdaptiveDiscreteSpace::~MultiRepAdaptiveDiscreteSpace()
 {
-    for (size_t i = 0; i < state_id_to_hash_entry_.size(); i++) {
-        adim::AdaptiveHashEntry *entry = state_id_to_hash_entry_[i];
-        if (IsValidRepID(entry->dimID)) { // skip the goal
-            // tell the representation to delete its state data (the void *)
-            representations_[entry->dimID]->deleteStateData(entry->stateID);
-        }
-        delete entry;
-        state_id_to_hash_entry_[i] = nullptr;
-    }
+    DeleteHeapEntries();
+
+    // the rows are owned by planner_indices_; keep the base class from
+    // deleting them individually
+    StateID2IndexMapping.clear();
 }
 
 /// Insert a new state into the state table and assigns a state id to the
@@ -103,32 +110,41 @@ MultiRepAdaptiveDiscreteSpace::~MultiRepAdaptiveDiscreteSpace()
 int MultiRepAdaptiveDiscreteSpace::InsertHashEntry(
     AdaptiveHashEntry *entry,
     size_t binID)
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    const int state_id = InsertHashEntryUnlocked(entry, binID);
+    if (state_id >= 0) {
+        heap_entries_.push_back(entry);
+    }
+    return state_id;
+}
+
+int MultiRepAdaptiveDiscreteSpace::InsertHashEntryUnlocked(
+    AdaptiveHashEntry *entry,
+    size_t binID)
 {
     if (!IsValidRepID(entry->dimID)) { // TODO(Andrew): assertion material
         ROS_ERROR_NAMED(GLOG, "dimID %d does not have a hash table!", entry->dimID);
         return -1;
     }
 
-    binID &= (hash_table_size_ - 1);
-
     // get corresponding state ID
     entry->stateID = state_id_to_hash_entry_.size();
 
     // insert into list of states
-    state_id_to_hash_entry_.push_back(entry);
+    state_id_to_hash_entry_.create(entry);
 
-    // insert into hash table in corresponding bin
-    hash_tables_[entry->dimID][binID].push_back(entry);
+    // insert into the representation's hash table
+    hash_tables_[entry->dimID].insert(entry, binID);
 
     // make room to map and insert planner data
-    int *planner_data = new int[NUMOFINDICES_STATEID2IND];
-    std::fill(planner_data, planner_data + NUMOFINDICES_STATEID2IND, -1);
-    StateID2IndexMapping.push_back(planner_data);
+    InsertPlannerIndices();
 
     return entry->stateID;
 }
 
-/// Lookup a state by its id.
+/// Lookup a state by its id. Does not block, and may be called concurrently
+/// with the insertion of other states.
 ///
 /// \param stateID The id of a previously inserted state
 /// \return A pointer to the referenced state, or nullptr if the id is invalid
@@ -154,6 +170,55 @@ int MultiRepAdaptiveDiscreteSpace::GetDimID(int stateID)
     return state_id_to_hash_entry_[stateID]->dimID;
 }
 
+/// Remove all states, including the abstract goal, and reset the start and
+/// goal states. Arena-allocated states, and the abstract goal, are released
+/// all at once; only entries inserted via InsertHashEntry or
+/// FindOrInsertHashEntry are deleted individually.
+///
+/// \param free_memory Whether to return the memory held by the state table and
+///     the arenas to the system, rather than keeping it for the next query
+void MultiRepAdaptiveDiscreteSpace::ClearStates(bool free_memory)
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+
+    DeleteHeapEntries();
+
+    if (free_memory) {
+        for (auto &arena : state_data_) {
+            if (arena) {
+                arena->release();
+            }
+        }
+        hash_entries_.release();
+        planner_indices_.release();
+        for (auto &table : hash_tables_) {
+            table = AdaptiveStateTable();
+        }
+        state_id_to_hash_entry_.release();
+        std::vector<int *>().swap(StateID2IndexMapping);
+        std::vector<AdaptiveHashEntry *>().swap(heap_entries_);
+        std::vector<int>().swap(expansion_steps_);
+    }
+    else {
+        for (auto &arena : state_data_) {
+            if (arena) {
+                arena->clear();
+            }
+        }
+        hash_entries_.clear();
+        planner_indices_.clear();
+        for (auto &table : hash_tables_) {
+            table.clear();
+        }
+        state_id_to_hash_entry_.clear();
+        StateID2IndexMapping.clear();
+        expansion_steps_.clear();
+    }
+
+    start_hash_entry_ = nullptr;
+    goal_hash_entry_ = nullptr;
+}
+
 /// Register a new representation and mark it as the full-dimensional
 /// representation.
 ///
@@ -191,8 +256,7 @@ bool MultiRepAdaptiveDiscreteSpace::RegisterRepresentation(
     representations_.push_back(rep);
 
     // create a new hash table
-    std::vector<std::vector<AdaptiveHashEntry*>> hash_table(hash_table_size_ + 1);
-    hash_tables_.push_back(std::move(hash_table));
+    hash_tables_.emplace_back();
 
     // update the projection matrix
     std::vector<ProjectionPtr> new_proj_matrix;
@@ -378,11 +442,7 @@ int MultiRepAdaptiveDiscreteSpace::SetAbstractGoal(AbstractGoal *goal)
 
     // create a fake metagoal
     // TODO(Andrew): probably shouldn't do this multiple times?
-    AdaptiveHashEntry *entry = new AdaptiveHashEntry;
-    entry->dimID = -1;
-    entry->stateData = nullptr;
-    InsertMetaGoalHashEntry(entry);
-    goal_hash_entry_ = entry;
+    AdaptiveHashEntry *entry = InsertMetaGoalHashEntry();
     ROS_INFO_NAMED(GLOG, "Metagoal ID: %d --> %d", entry->stateID, entry->dimID);
     return entry->stateID;
 }
@@ -551,7 +611,10 @@ void MultiRepAdaptiveDiscreteSpace::GetPreds_Plan(
     preds->clear();
     costs->clear();
     AdaptiveHashEntry *entry = GetState(state_id);
-    representations_[entry->dimID]->GetSuccs(state_id, preds, costs);
+    if (!IsValidRepID(entry->dimID)) {
+        return; // the abstract goal has no representation
+    }
+    representations_[entry->dimID]->GetPreds(state_id, preds, costs);
 }
 
 void MultiRepAdaptiveDiscreteSpace::GetPreds_Track(
@@ -562,6 +625,9 @@ void MultiRepAdaptiveDiscreteSpace::GetPreds_Track(
     preds->clear();
     costs->clear();
     AdaptiveHashEntry *entry = GetState(state_id);
+    if (!IsValidRepID(entry->dimID)) {
+        return; // the abstract goal has no representation
+    }
     representations_[entry->dimID]->GetPreds(state_id, preds, costs);
 }
 
@@ -571,7 +637,7 @@ void MultiRepAdaptiveDiscreteSpace::GetSuccs_Plan(
     std::vector<int> *SuccIDV,
     std::vector<int> *costs)
 {
-    ROS_ERROR_NAMED(GLOG, "GetSuccs_Plan with exp_step not implemented. Defaulting");
+    onExpansionStep(SourceStateID, expansion_step);
     GetSuccs_Plan(SourceStateID, SuccIDV, costs);
 }
 
@@ -581,8 +647,7 @@ void MultiRepAdaptiveDiscreteSpace::GetSuccs_Track(
     std::vector<int> *succs,
     std::vector<int> *costs)
 {
-    // TODO(Andrew): once
-    ROS_ERROR_NAMED(GLOG, "GetSuccs_Track with exp_step not implemented. Defaulting");
+    onExpansionStep(state_id, expansion_step);
     GetSuccs_Track(state_id, succs, costs);
 }
 
@@ -592,7 +657,7 @@ void MultiRepAdaptiveDiscreteSpace::GetPreds_Plan(
     std::vector<int> *preds,
     std::vector<int> *costs)
 {
-    ROS_ERROR_NAMED(GLOG, "GetPreds_Plan with exp_step not implemented. Defaulting");
+    onExpansionStep(state_id, expansion_step);
     GetPreds_Plan(state_id, preds, costs);
 }
 
@@ -602,23 +667,257 @@ void MultiRepAdaptiveDiscreteSpace::GetPreds_Track(
     std::vector<int> *preds,
     std::vector<int> *costs)
 {
-    ROS_ERROR_NAMED(GLOG, "GetPreds_Track with exp_step not implemented. Defaulting");
+    onExpansionStep(state_id, expansion_step);
     GetPreds_Track(state_id, preds, costs);
 }
 
-int MultiRepAdaptiveDiscreteSpace::InsertMetaGoalHashEntry(
-    AdaptiveHashEntry *entry)
+/// Representations refer to the space that owns them and keep per-space
+/// state, the abstract goal is reconfigured for every query, and a thread pool
+/// runs one parallel loop at a time, so two spaces sharing any of them may
+/// not be searched concurrently. All other components, e.g. occupancy grids
+/// and precomputed heuristics referred to by the representations, may be
+/// shared if they are not modified while planning.
+bool MultiRepAdaptiveDiscreteSpace::sharesMutableState(
+    const AdaptiveDiscreteSpace &other) const
+{
+    if (this == &other) {
+        return true;
+    }
+
+    const MultiRepAdaptiveDiscreteSpace *mrep =
+            dynamic_cast<const MultiRepAdaptiveDiscreteSpace *>(&other);
+    if (!mrep) {
+        return false;
+    }
+
+    for (const AdaptiveStateRepresentationPtr &rep : representations_) {
+        for (const AdaptiveStateRepresentationPtr &orep : mrep->representations_) {
+            if (rep == orep) {
+                return true;
+            }
+        }
+    }
+
+    return (goal_ && goal_ == mrep->goal_) ||
+            (thread_pool_ && thread_pool_ == mrep->thread_pool_);
+}
+
+/// The state table is thread safe, so successors may be generated
+/// concurrently if every representation supports it.
+bool MultiRepAdaptiveDiscreteSpace::supportsConcurrentExpansions() const
+{
+    if (representations_.empty()) {
+        return false;
+    }
+    for (const AdaptiveStateRepresentationPtr &rep : representations_) {
+        if (!rep->SupportsConcurrentExpansions()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Translate a state of a replica of this space, whose representations are
+/// registered in the same order, into the equivalent state of this space. The
+/// representation's FindOrCreateState() looks up the state data in this
+/// space's table, creating the state if necessary; the abstract goal state
+/// translates to this space's goal state.
+///
+/// \param src The replica space
+/// \param src_state_id The id of a state in \p src
+/// \return The id of the equivalent state in this space, or -1 if the state
+///     could not be translated
+int MultiRepAdaptiveDiscreteSpace::translateStateID(
+    const AdaptiveDiscreteSpace &src,
+    int src_state_id)
+{
+    if (this == &src) {
+        return src_state_id;
+    }
+
+    const MultiRepAdaptiveDiscreteSpace *mrep =
+            dynamic_cast<const MultiRepAdaptiveDiscreteSpace *>(&src);
+    if (!mrep || !mrep->IsValidStateID(src_state_id)) {
+        return -1;
+    }
+
+    const AdaptiveHashEntry *entry = mrep->state_id_to_hash_entry_[src_state_id];
+    if (entry->dimID == -1) {
+        return entry == mrep->goal_hash_entry_ ? GetGoalStateID() : -1;
+    }
+
+    AdaptiveStateRepresentation *rep = GetRepresentation(entry->dimID);
+    const AdaptiveStateRepresentation *src_rep = mrep->GetRepresentation(entry->dimID);
+    if (!rep || !src_rep || rep->getName() != src_rep->getName()) {
+        ROS_WARN_NAMED(GLOG, "State %d of representation %d has no counterpart in this space", src_state_id, entry->dimID);
+        return -1;
+    }
+
+    return rep->FindOrCreateState(entry->stateData);
+}
+
+/// States may be translated between replicas if every representation
+/// supports it.
+bool MultiRepAdaptiveDiscreteSpace::supportsStateTranslation() const
+{
+    if (representations_.empty()) {
+        return false;
+    }
+    for (const AdaptiveStateRepresentationPtr &rep : representations_) {
+        if (!rep->SupportsStateTranslation()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// The state table is locked while any span of concurrent expansions is in
+/// progress, and accessed without synchronization otherwise.
+void MultiRepAdaptiveDiscreteSpace::beginConcurrentExpansions()
+{
+    ++concurrent_expansions_;
+}
+
+void MultiRepAdaptiveDiscreteSpace::endConcurrentExpansions()
+{
+    --concurrent_expansions_;
+}
+
+/// Add a sphere and report the earliest expansion step of the states it
+/// modified.
+///
+/// \param StateID The state at which the sphere is introduced
+/// \param first_mod_step The earliest expansion step of the modified states;
+///     INT_MAX if none has been expanded, or -1 if no modified states were
+///     reported
+void MultiRepAdaptiveDiscreteSpace::addSphere(int StateID, int &first_mod_step)
 {
+    std::vector<int> modified;
+    addSphere(StateID, &modified);
+    if (modified.empty()) {
+        ROS_DEBUG_NAMED(GLOG, "Sphere at state %d reported no modified states", StateID);
+        first_mod_step = -1;
+        return;
+    }
+    first_mod_step = GetEarliestExpansionStep(modified);
+}
+
+int MultiRepAdaptiveDiscreteSpace::GetEarliestExpansionStep(
+    const std::vector<int> &state_ids) const
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    int first_step = INT_MAX;
+    for (int state_id : state_ids) {
+        if (state_id >= 0 && state_id < (int)expansion_steps_.size()) {
+            first_step = std::min(first_step, expansion_steps_[state_id]);
+        }
+    }
+    return first_step;
+}
+
+/// Set the expansion step of \p query to the earliest step at which any of
+/// its predecessors was expanded, or to -1 (unknown) if none was, in which
+/// case searches fall back to the predecessors themselves.
+void MultiRepAdaptiveDiscreteSpace::FillExpansionStep(
+    AdaptiveStateChangeQuery *query) const
+{
+    const int first_step = GetEarliestExpansionStep(query->predecessors);
+    query->expansion_step = first_step == INT_MAX ? -1 : first_step;
+}
+
+void MultiRepAdaptiveDiscreteSpace::onExpansionStep(
+    int state_id,
+    int expansion_step)
+{
+    if (state_id < 0 || expansion_step < 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    if (state_id >= (int)expansion_steps_.size()) {
+        expansion_steps_.resize(state_id + 1, INT_MAX);
+    }
+    expansion_steps_[state_id] = std::min(expansion_steps_[state_id], expansion_step);
+}
+
+void MultiRepAdaptiveDiscreteSpace::ParallelFor(
+    size_t n,
+    const ThreadPool::Task &task)
+{
+    std::lock_guard<std::mutex> lock(thread_pool_mutex_);
+    if (thread_pool_) {
+        ConcurrentExpansionScope scope(this, thread_pool_->numWorkers() > 1);
+        thread_pool_->parallelFor(n, task);
+    }
+    else {
+        for (size_t i = 0; i < n; ++i) {
+            task(i, 0);
+        }
+    }
+}
+
+void MultiRepAdaptiveDiscreteSpace::GetLazySuccs_Plan(
+    int state_id,
+    std::vector<int> *succs,
+    std::vector<int> *costs,
+    std::vector<bool> *true_costs)
+{
+    succs->clear();
+    costs->clear();
+    true_costs->clear();
+    AdaptiveHashEntry *entry = GetState(state_id);
+    representations_[entry->dimID]->GetLazySuccs(
+            state_id, succs, costs, true_costs);
+}
+
+// Lazy successors are only generated in planning mode, so edges in tracking
+// mode are evaluated by regenerating the successors of the source state
+int MultiRepAdaptiveDiscreteSpace::EvaluateEdge(int src_id, int dst_id)
+{
+    if (isInTrackingMode()) {
+        return AdaptiveDiscreteSpace::EvaluateEdge(src_id, dst_id);
+    }
+    AdaptiveHashEntry *entry = GetState(src_id);
+    return representations_[entry->dimID]->EvaluateEdge(src_id, dst_id);
+}
+
+// Create the entry of the abstract goal in the arena of hash entries and
+// insert it into the state table
+AdaptiveHashEntry *MultiRepAdaptiveDiscreteSpace::InsertMetaGoalHashEntry()
+{
+    std::unique_lock<std::mutex> lock = LockStateTable();
+    AdaptiveHashEntry *entry = hash_entries_.create();
+    entry->dimID = -1;
+    entry->stateData = nullptr;
     entry->stateID = state_id_to_hash_entry_.size(); // assign state id
-    state_id_to_hash_entry_.push_back(entry); // insert into state table
+    state_id_to_hash_entry_.create(entry); // insert into state table
 
     // initialize mapping from search state to graph state
-    int *planner_data = new int[NUMOFINDICES_STATEID2IND];
-    std::fill(planner_data, planner_data + NUMOFINDICES_STATEID2IND, -1);
-    StateID2IndexMapping.push_back(planner_data);
+    InsertPlannerIndices();
 
     goal_hash_entry_ = entry;
-    return entry->stateID;
+    return entry;
+}
+
+// Append a row of planner indices, initialized to -1, to
+// StateID2IndexMapping. Rows are allocated contiguously from
+// planner_indices_ rather than individually on the heap.
+void MultiRepAdaptiveDiscreteSpace::InsertPlannerIndices()
+{
+    PlannerIndices *indices = planner_indices_.create();
+    std::fill(indices->data, indices->data + NUMOFINDICES_STATEID2IND, -1);
+    StateID2IndexMapping.push_back(indices->data);
+}
+
+// Delete the entries inserted via InsertHashEntry or FindOrInsertHashEntry,
+// and have their representations delete their state data
+void MultiRepAdaptiveDiscreteSpace::DeleteHeapEntries()
+{
+    for (AdaptiveHashEntry *entry : heap_entries_) {
+        // tell the representation to delete its state data (the void *)
+        representations_[entry->dimID]->deleteStateData(entry->stateID);
+        delete entry;
+    }
+    heap_entries_.clear();
 }
 
 bool MultiRepAdaptiveDiscreteSpace::IsValidStateID(int stateID) const
@@ -0,0 +1,75 @@
+#include <sbpl_adaptive/mrep/graph/state_table.h>
+
+// standard includes
+#include <utility>
+
+namespace adim {
+
+AdaptiveStateTable::AdaptiveStateTable(size_t capacity) :
+    slots_(),
+    mask_(0),
+    size_(0),
+    epoch_(1)
+{
+    size_t n = 1;
+    while (n < capacity) {
+        n <<= 1;
+    }
+    slots_.assign(n, Slot{ 0, 0, nullptr });
+    mask_ = n - 1;
+}
+
+void AdaptiveStateTable::insert(AdaptiveHashEntry *entry, size_t hash)
+{
+    if ((double)(size_ + 1) > max_load_factor() * (double)slots_.size()) {
+        grow();
+    }
+    insert_slot(Slot{ fingerprint(hash), epoch_, entry });
+    ++size_;
+}
+
+void AdaptiveStateTable::clear()
+{
+    ++epoch_;
+    if (epoch_ == 0) {
+        // the epoch wrapped around; slots stamped long ago would appear
+        // occupied again
+        slots_.assign(slots_.size(), Slot{ 0, 0, nullptr });
+        epoch_ = 1;
+    }
+    size_ = 0;
+}
+
+// Insert into the first empty slot along the probe sequence, displacing any
+// entry that is closer to its home slot than the entry being inserted
+void AdaptiveStateTable::insert_slot(Slot slot)
+{
+    size_t pos = slot.hash & mask_;
+    for (size_t dist = 0; ; ++dist) {
+        Slot &curr = slots_[pos];
+        if (!occupied(curr)) {
+            curr = slot;
+            return;
+        }
+        const size_t curr_dist = probe_distance(curr.hash, pos);
+        if (curr_dist < dist) {
+            std::swap(curr, slot);
+            dist = curr_dist;
+        }
+        pos = (pos + 1) & mask_;
+    }
+}
+
+void AdaptiveStateTable::grow()
+{
+    std::vector<Slot> slots(2 * slots_.size(), Slot{ 0, 0, nullptr });
+    slots_.swap(slots);
+    mask_ = slots_.size() - 1;
+    for (const Slot &slot : slots) {
+        if (occupied(slot)) {
+            insert_slot(slot);
+        }
+    }
+}
+
+} // namespace adim
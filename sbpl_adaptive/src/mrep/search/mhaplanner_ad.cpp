@@ -22,11 +22,17 @@ static const char *SSLOG = "mrmha.successors";
 ADMHAPlannerAllocator::ADMHAPlannerAllocator(
     MultiRepHeuristic *aheur,
     MultiRepHeuristic **heurs,
-    int h_count)
+    int h_count,
+    OpenListType open_list_type,
+    int num_threads,
+    QueueSchedulerType scheduler_type)
 :
     aheur_(aheur),
     heurs_(heurs),
-    h_count_(h_count)
+    h_count_(h_count),
+    open_list_type_(open_list_type),
+    num_threads_(num_threads),
+    scheduler_type_(scheduler_type)
 {
 }
 
@@ -41,14 +47,19 @@ SBPLPlanner *ADMHAPlannerAllocator::make(
         return nullptr;
     }
 
-    return new MHAPlanner_AD(mrep_space, aheur_, heurs_, h_count_);
+    return new MHAPlanner_AD(
+            mrep_space, aheur_, heurs_, h_count_, open_list_type_,
+            num_threads_, scheduler_type_);
 }
 
 MHAPlanner_AD::MHAPlanner_AD(
     MultiRepAdaptiveDiscreteSpace* space,
     MultiRepHeuristic* hanchor,
     MultiRepHeuristic** heurs,
-    int hcount)
+    int hcount,
+    OpenListType open_list_type,
+    int num_threads,
+    QueueSchedulerType scheduler_type)
 :
     SBPLPlanner(),
 //    environment_(environment),
@@ -58,24 +69,54 @@ MHAPlanner_AD::MHAPlanner_AD(
     m_hcount(hcount),
     m_params(0.0),
     m_initial_eps_mha(100.0),
+    m_final_eps_mha(100.0),
     m_max_expansions(0),
     m_eps(1.0),
     m_eps_mha(1.0),
     m_eps_satisfied((double)INFINITECOST),
+    m_best_path(),
+    m_best_cost(INFINITECOST),
     m_num_expansions(0),
     m_elapsed(sbpl::clock::duration::zero()),
     m_call_number(0), // uninitialized
     m_start_state(NULL),
     m_goal_state(NULL),
     m_search_states(),
-    m_open(NULL),
+    m_state_arena(
+            1024,
+            sizeof(MHAState_AD) + sizeof(MHAState_AD::HeapData) * hcount,
+            ChunkedArena<MHAState_AD>::CACHE_LINE_SIZE),
+    m_open(),
     set_heur_(false),
     m_last_start_state_id(-1),
-    m_last_goal_state_id(-1)
+    m_last_goal_state_id(-1),
+    m_pool(),
+    m_mutex(),
+    m_cv(),
+    m_being_expanded(),
+    m_search_status(SEARCHING),
+    m_search_start(),
+    m_expand_mutex(),
+    m_scheduler(MakeQueueScheduler(scheduler_type)),
+    m_queues(),
+    m_candidates(),
+    m_best_h(),
+    m_incons()
 {
     environment_ = space;
 
-    m_open = new CHeap[hcount + 1];
+    if (hcount + 1 > MAX_HEURISTICS) {
+        ROS_ERROR("MHA* supports at most %d heuristics (got %d)", MAX_HEURISTICS, hcount + 1);
+        throw SBPL_Exception();
+    }
+
+    for (int i = 0; i < hcount + 1; ++i) {
+        m_open.emplace_back(MakeOpenList(open_list_type));
+    }
+
+    for (int i = 1; i < hcount + 1; ++i) {
+        m_queues.push_back(i);
+    }
 
     // Overwrite default members for ReplanParams to represent a single optimal
     // search
@@ -86,26 +127,32 @@ MHAPlanner_AD::MHAPlanner_AD(
     m_params.max_time = 0.0;
     m_params.repair_time = 0.0;
 
-    // map from representation id to the indices of heuristics that apply to it
-    m_heuristic_list[-1] = { 0 };
+    // map from representation id to the indices of heuristics that apply to
+    // it, starting with the abstract goal (-1), to which only the anchor
+    // heuristic applies
+    m_heuristic_offsets.push_back(0);
+    m_heuristic_ids.push_back(0);
+    m_heuristic_offsets.push_back((int)m_heuristic_ids.size());
 
     for (int i = 0; i < space->NumRepresentations(); ++i) {
         // anchor heuristic should apply to every representation
-        m_heuristic_list[i].push_back(0);
+        m_heuristic_ids.push_back(0);
         for (int j = 0; j < hcount; ++j) {
             if (heurs[j]->IsDefinedForRepresentation(i)) {
-                m_heuristic_list[i].push_back(j + 1);
+                m_heuristic_ids.push_back(j + 1);
             }
         }
+        m_heuristic_offsets.push_back((int)m_heuristic_ids.size());
     }
 
     ROS_DEBUG_NAMED(SLOG, "Representation -> Heuristic Mapping:");
-    for (const auto &entry : m_heuristic_list) {
+    for (int i = -1; i < space->NumRepresentations(); ++i) {
         std::stringstream ss;
-        ss << entry.first << ": [ ";
-        for (size_t i = 0; i < entry.second.size(); ++i) {
-            ss << entry.second[i];
-            if (i != entry.second.size() - 1) {
+        ss << i << ": [ ";
+        const HeuristicRange hr = heuristics(i);
+        for (const int* h = hr.begin(); h != hr.end(); ++h) {
+            ss << *h;
+            if (h + 1 != hr.end()) {
                 ss << ", ";
             }
             else {
@@ -116,6 +163,8 @@ MHAPlanner_AD::MHAPlanner_AD(
         ROS_DEBUG_NAMED(SLOG, "  %s", ss.str().c_str());
     }
 
+    set_num_threads(num_threads);
+
     /// Four Modes:
     ///     Search Until Solution Bounded
     ///     Search Until Solution Unbounded
@@ -127,7 +176,6 @@ MHAPlanner_AD::~MHAPlanner_AD()
 {
     clear();
 
-    delete[] m_open;
 }
 
 int MHAPlanner_AD::set_start(int start_stateID)
@@ -196,11 +244,7 @@ int MHAPlanner_AD::replan(
         return 0;
     }
 
-    if (m_start_state->state_id != m_last_start_state_id ||
-        m_goal_state->state_id != m_last_goal_state_id)
-    {
-        // TODO: the search doesn't need to reinitialize when the goal state
-        // changes
+    if (m_start_state->state_id != m_last_start_state_id) {
         reinit_search();
 
         ++m_call_number;
@@ -211,23 +255,30 @@ int MHAPlanner_AD::replan(
         reinit_state(m_start_state);
         m_start_state->g = 0;
 
+        m_scheduler->reset(num_heuristics());
+        m_best_h.assign(num_heuristics(), INFINITECOST);
+
         // insert start state into all heaps with key(start, i) as priority
-        int dimID = space_->GetDimID(m_start_state->state_id);
-        for (int hidx : m_heuristic_list[dimID]) {
+        for (int hidx : heuristics(m_start_state->dim_id)) {
             //    for (int hidx = 0; hidx < num_heuristics(); ++hidx) {
-            CKey key;
-            key.key[0] = compute_key(m_start_state, hidx);
-            m_open[hidx].insertheap(&m_start_state->od[hidx].open_state, key);
-            ROS_DEBUG_NAMED(SLOG, "Inserted start state %d into search %d with f = %ld", m_start_state->state_id, hidx, key.key[0]);
+            const long int key = compute_key(m_start_state, hidx);
+            m_open[hidx]->insert(&m_start_state->od[hidx].open_state, key);
+            m_best_h[hidx] = m_start_state->od[hidx].h;
+            ROS_DEBUG_NAMED(SLOG, "Inserted start state %d into search %d with f = %ld", m_start_state->state_id, hidx, key);
         }
 
         m_eps = m_params.initial_eps;
         m_eps_mha = m_initial_eps_mha;
         m_eps_satisfied = (double)INFINITECOST;
+        m_best_path.clear();
+        m_best_cost = INFINITECOST;
 
         m_last_start_state_id = m_start_state->state_id;
         m_last_goal_state_id = m_goal_state->state_id;
     }
+    else if (m_goal_state->state_id != m_last_goal_state_id) {
+        retarget_search();
+    }
 
     // m_params = params;
     m_params.max_time = params.max_time;
@@ -241,6 +292,7 @@ int MHAPlanner_AD::replan(
     ROS_DEBUG_NAMED(SLOG, "  Repair Time: %0.3f", m_params.repair_time);
     ROS_DEBUG_NAMED(SLOG, "MHA Search parameters:");
     ROS_DEBUG_NAMED(SLOG, "  MHA Epsilon: %0.3f", m_initial_eps_mha);
+    ROS_DEBUG_NAMED(SLOG, "  Final MHA Epsilon: %0.3f", m_final_eps_mha);
     ROS_DEBUG_NAMED(SLOG, "  Max Expansions: %d", m_max_expansions);
 
     // reset time limits
@@ -254,77 +306,33 @@ int MHAPlanner_AD::replan(
     end_time = sbpl::clock::now();
     m_elapsed += end_time - start_time;
 
-    while (!m_open[0].emptyheap() && !time_limit_reached()) {
-        start_time = sbpl::clock::now();
-        // special case for mha* without additional heuristics
-        if (num_heuristics() == 1) {
-            if (m_goal_state->g <= get_minf(m_open[0])) {
-                m_eps_satisfied = m_eps * m_eps_mha;
-                extract_path(solution_stateIDs_V, solcost);
-                return 1;
-            }
-            else {
-                MHASearchState* s = state_from_open_state(m_open[0].getminheap());
-                expand(s, 0);
-            }
-        }
-
-        bool all_empty = true;
-        for (int hidx = 1; hidx < num_heuristics(); ++hidx) {
-            if (m_open[0].emptyheap()) {
-                ROS_INFO_NAMED(SLOG, "Anchor empty");
-                break;
-            }
-
-            all_empty &= m_open[hidx].emptyheap();
-            if (m_open[hidx].emptyheap()) {
-                continue;
-            }
-
-            if (get_minf(m_open[hidx]) <= m_eps_mha * get_minf(m_open[0])) {
-                if (m_goal_state->g <= get_minf(m_open[hidx])) {
-                    m_eps_satisfied = m_eps * m_eps_mha;
-                    extract_path(solution_stateIDs_V, solcost);
-                    return 1;
-                }
-                else {
-                    MHASearchState* s =
-                            state_from_open_state(m_open[hidx].getminheap());
-                    expand(s, hidx);
-                }
-            }
-            else {
-                if (m_goal_state->g <= get_minf(m_open[0])) {
-                    m_eps_satisfied = m_eps * m_eps_mha;
-                    extract_path(solution_stateIDs_V, solcost);
-                    return 1;
-                }
-                else {
-                    MHASearchState* s =
-                            state_from_open_state(m_open[0].getminheap());
-                    expand(s, 0);
-                }
-            }
+    // search until a solution is found with the current weights, then lower
+    // the weights and continue the search from the states generated so far,
+    // until the final weights or the time limit are reached
+    while (search()) {
+        m_eps_satisfied = m_eps * m_eps_mha;
+        extract_path(&m_best_path, &m_best_cost);
+        ROS_DEBUG_NAMED(SLOG, "Found solution with cost %d (eps = %0.3f, eps_mha = %0.3f) after %d expansions", m_best_cost, m_eps, m_eps_mha, m_num_expansions);
+
+        if (m_params.return_first_solution ||
+            time_limit_reached() ||
+            !lower_weights())
+        {
+            break;
         }
 
-        if (all_empty && !m_open[0].emptyheap()) {
-            if (m_goal_state->g <= get_minf(m_open[0])) {
-                m_eps_satisfied = m_eps * m_eps_mha;
-                extract_path(solution_stateIDs_V, solcost);
-                return 1;
-            }
-            else {
-                MHASearchState* s =
-                        state_from_open_state(m_open[0].getminheap());
-                expand(s, 0);
-            }
-        }
+        reuse_search();
+    }
 
-        end_time = sbpl::clock::now();
-        m_elapsed += end_time - start_time;
+    // return the best solution found for this query, by this call or by a
+    // previous call whose iterations this call resumed
+    if (!m_best_path.empty()) {
+        *solution_stateIDs_V = m_best_path;
+        *solcost = m_best_cost;
+        return 1;
     }
 
-    if (m_open[0].emptyheap()) {
+    if (m_open[0]->empty()) {
         ROS_DEBUG_NAMED(SLOG, "Anchor search exhausted");
     }
     if (time_limit_reached()) {
@@ -334,7 +342,7 @@ int MHAPlanner_AD::replan(
         ROS_DEBUG_NAMED(SLOG, "Best stateID: %d", best_state_id);
         if (best_state_id >= 0) {
             ROS_WARN("Reconstructing partial path!");
-            MHASearchState* best_seen_state = get_state(best_state_id);
+            MHAState_AD* best_seen_state = get_state(best_state_id);
             extract_partial_path(solution_stateIDs_V, solcost, best_seen_state);
             if (best_state_id == m_start_state->state_id) {
                 return 0;
@@ -349,7 +357,10 @@ int MHAPlanner_AD::replan(
 
 int MHAPlanner_AD::force_planning_from_scratch()
 {
-    return 0;
+    // reinitialize the search on the next call to replan()
+    m_last_start_state_id = -1;
+    m_last_goal_state_id = -1;
+    return 1;
 }
 
 int MHAPlanner_AD::force_planning_from_scratch_and_free_memory()
@@ -424,6 +435,11 @@ void MHAPlanner_AD::set_final_eps(double eps)
     m_params.final_eps = eps;
 }
 
+void MHAPlanner_AD::set_final_mha_eps(double eps)
+{
+    m_final_eps_mha = eps;
+}
+
 void MHAPlanner_AD::set_dec_eps(double eps)
 {
     m_params.dec_eps = eps;
@@ -449,6 +465,11 @@ double MHAPlanner_AD::get_final_eps() const
     return m_params.final_eps;
 }
 
+double MHAPlanner_AD::get_final_mha_eps() const
+{
+    return m_final_eps_mha;
+}
+
 double MHAPlanner_AD::get_dec_eps() const
 {
     return m_params.dec_eps;
@@ -464,6 +485,28 @@ double MHAPlanner_AD::get_max_time() const
     return m_params.max_time;
 }
 
+void MHAPlanner_AD::set_num_threads(int num_threads)
+{
+    if (num_threads == 1) {
+        m_pool.reset();
+    }
+    else {
+        m_pool = std::make_shared<ThreadPool>(num_threads);
+    }
+}
+
+int MHAPlanner_AD::get_num_threads() const
+{
+    return m_pool ? m_pool->numWorkers() : 1;
+}
+
+void MHAPlanner_AD::set_queue_scheduler(
+    std::unique_ptr<QueueScheduler> scheduler)
+{
+    m_scheduler = std::move(scheduler);
+    m_scheduler->reset(num_heuristics());
+}
+
 bool MHAPlanner_AD::check_params(const ReplanParams& params)
 {
     if (params.initial_eps < 1.0) {
@@ -486,6 +529,11 @@ bool MHAPlanner_AD::check_params(const ReplanParams& params)
         return false;
     }
 
+    if (m_final_eps_mha < 1.0) {
+        ROS_ERROR("Final MHA Epsilon must be greater than or equal to 1");
+        return false;
+    }
+
     if (params.return_first_solution &&
         params.max_time <= 0.0 &&
         m_max_expansions <= 0)
@@ -499,7 +547,10 @@ bool MHAPlanner_AD::check_params(const ReplanParams& params)
 
 bool MHAPlanner_AD::time_limit_reached() const
 {
-    if (m_params.return_first_solution) {
+    if (space_->interruptRequested()) {
+        return true;
+    }
+    else if (m_params.return_first_solution) {
         return false;
     }
     else if (m_params.max_time > 0.0 && sbpl::to_seconds(m_elapsed) >= m_params.max_time) {
@@ -513,7 +564,16 @@ bool MHAPlanner_AD::time_limit_reached() const
     }
 }
 
-MHASearchState* MHAPlanner_AD::get_state(int state_id)
+MHAPlanner_AD::HeuristicRange MHAPlanner_AD::heuristics(int dim_id) const
+{
+    const int* ids = m_heuristic_ids.data();
+    HeuristicRange range;
+    range.first = ids + m_heuristic_offsets[dim_id + 1];
+    range.last = ids + m_heuristic_offsets[dim_id + 2];
+    return range;
+}
+
+MHAState_AD* MHAPlanner_AD::get_state(int state_id)
 {
     if (m_graph_to_search_state.size() <= state_id) {
         m_graph_to_search_state.resize(state_id + 1, -1);
@@ -524,10 +584,7 @@ MHASearchState* MHAPlanner_AD::get_state(int state_id)
         m_graph_to_search_state[state_id] = (int)m_search_states.size();
 
         // create new search state
-        const size_t state_size =
-                sizeof(MHASearchState) +
-                sizeof(MHASearchState::HeapData) * (m_hcount);
-        MHASearchState* s = (MHASearchState*)malloc(state_size);
+        MHAState_AD* s = m_state_arena.create();
 
         const size_t mha_state_idx = m_search_states.size();
         init_state(s, mha_state_idx, state_id);
@@ -548,24 +605,23 @@ void MHAPlanner_AD::clear()
     // free states
     for (size_t i = 0; i < m_search_states.size(); ++i) {
         // unmap graph to search state
-        MHASearchState* search_state = m_search_states[i];
+        MHAState_AD* search_state = m_search_states[i];
         const int state_id = m_search_states[i]->state_id;
         int* idxs = space_->StateID2IndexMapping[state_id];
         idxs[MHAMDP_STATEID2IND] = -1;
-
-        // free search state
-        free(m_search_states[i]);
     }
 
-    // empty state table
+    // empty state table and free search states
     m_search_states.clear();
+    m_graph_to_search_state.clear();
+    m_state_arena.release();
 
     m_start_state = NULL;
     m_goal_state = NULL;
 }
 
 void MHAPlanner_AD::init_state(
-    MHASearchState* state,
+    MHAState_AD* state,
     size_t mha_state_idx,
     int state_id)
 {
@@ -573,8 +629,9 @@ void MHAPlanner_AD::init_state(
     state->state_id = state_id;
     state->closed_in_anc = false;
     state->closed_in_add = false;
-    int dimID = space_->GetDimID(state_id);
-    for (int i : m_heuristic_list[dimID]) {
+    state->h_valid = 0;
+    state->dim_id = space_->GetDimID(state_id);
+    for (int i : heuristics(state->dim_id)) {
     // for (int i = 0; i < num_heuristics(); i++) {
 //        state->od[i].open_state.heapindex = 0;
 //        state->od[i].h = compute_heuristic(state->state_id, i);
@@ -584,7 +641,7 @@ void MHAPlanner_AD::init_state(
     }
 }
 
-void MHAPlanner_AD::reinit_state(MHASearchState* state)
+void MHAPlanner_AD::reinit_state(MHAState_AD* state)
 {
     if (state->call_number != m_call_number) {
         state->call_number = m_call_number;
@@ -594,11 +651,11 @@ void MHAPlanner_AD::reinit_state(MHASearchState* state)
         state->closed_in_anc = false;
         state->closed_in_add = false;
 
-        int dimID = space_->GetDimID(state->state_id);
-        for (int i : m_heuristic_list[dimID]) {
+        // heuristic values are computed on demand
+        state->h_valid = 0;
+        for (int i : heuristics(state->dim_id)) {
         // for (int i = 0; i < num_heuristics(); i++) {
             state->od[i].open_state.heapindex = 0;
-            state->od[i].h = compute_heuristic(state->state_id, i);
         }
     }
 }
@@ -606,24 +663,45 @@ void MHAPlanner_AD::reinit_state(MHASearchState* state)
 void MHAPlanner_AD::reinit_search()
 {
     clear_open_lists();
+    m_incons.clear();
 }
 
 void MHAPlanner_AD::clear_open_lists()
 {
     for (int i = 0; i < num_heuristics(); ++i) {
-        m_open[i].makeemptyheap();
+        m_open[i]->clear();
     }
 }
 
-long int MHAPlanner_AD::compute_key(MHASearchState* state, int hidx)
+long int MHAPlanner_AD::compute_key(MHAState_AD* state, int hidx)
 {
-    return (long int)state->g + (long int)(m_eps * (long int)state->od[hidx].h);
+    return (long int)state->g + (long int)(m_eps * (long int)get_heuristic(state, hidx));
 }
 
-void MHAPlanner_AD::expand(MHASearchState* state, int hidx)
+void MHAPlanner_AD::expand(MHAState_AD* state, int hidx)
 {
-    int dimID = space_->GetDimID(state->state_id);
-    ROS_DEBUG_NAMED(SELOG, "Expanding state %d (dim = %d) in search %d { g = %d, h(0) = %d, h(%d) = %d, f = %ld }", state->state_id, dimID, hidx, state->g, state->od[0].h, hidx, state->od[hidx].h, compute_key(state, hidx));
+    begin_expansion(state, hidx);
+
+    environment_->GetSuccs(state->state_id, &m_succs);
+    const bool progress = update_succs(state, m_succs, hidx);
+    if (hidx != 0) {
+        m_scheduler->update(hidx, progress);
+    }
+
+    assert(closed_in_any_search(state));
+}
+
+// Close a state in search hidx and remove it from all open lists, before its
+// successors are generated
+void MHAPlanner_AD::begin_expansion(MHAState_AD* state, int hidx)
+{
+    const int dimID = state->dim_id;
+    // report only heuristic values that have been computed (-1 otherwise),
+    // so that logging does not evaluate heuristics
+    auto cached_h = [state](int i) {
+        return (state->h_valid >> i) & 1 ? state->od[i].h : -1;
+    };
+    ROS_DEBUG_NAMED(SELOG, "Expanding state %d (dim = %d) in search %d { g = %d, h(0) = %d, h(%d) = %d }", state->state_id, dimID, hidx, state->g, cached_h(0), hidx, cached_h(hidx));
     space_->expandingState(state->state_id);
 
     assert(!closed_in_add_search(state) || !closed_in_anc_search(state));
@@ -638,73 +716,496 @@ void MHAPlanner_AD::expand(MHASearchState* state, int hidx)
 
     // // remove s from all open lists
     // for (int hidx = 0; hidx < num_heuristics(); ++hidx) {
-    //     if (m_open[hidx].inheap(&state->od[hidx].open_state)) {
-    //         m_open[hidx].deleteheap(&state->od[hidx].open_state);
+    //     if (state->od[hidx].open_state.heapindex != 0) {
+    //         m_open[hidx]->erase(&state->od[hidx].open_state);
     //     }
     // }
 
     // remove s from all open lists based on dimID
-    for (int i : m_heuristic_list[dimID]){
+    for (int i : heuristics(dimID)){
     // for (int i = 0; i < num_heuristics(); ++i){
-        if (m_open[i].inheap(&state->od[i].open_state)) {
-            m_open[i].deleteheap(&state->od[i].open_state);
+        if (state->od[i].open_state.heapindex != 0) {
+            m_open[i]->erase(&state->od[i].open_state);
         }
     }
+}
 
-    std::vector<int> succ_ids;
-    std::vector<int> costs;
-    space_->GetSuccs(state->state_id, &succ_ids, &costs);
+// Update the successors of a state expanded in search expand_hidx and return
+// whether the best heuristic value seen in that search improved
+bool MHAPlanner_AD::update_succs(
+    MHAState_AD* state,
+    const SuccessorBuffer& succs,
+    int expand_hidx)
+{
+    bool progress = false;
+    const std::vector<int>& succ_ids = succs.ids;
+    const std::vector<int>& costs = succs.costs;
     assert(succ_ids.size() == costs.size());
 
     for (size_t sidx = 0; sidx < succ_ids.size(); ++sidx)  {
         const int cost = costs[sidx];
-        MHASearchState* succ_state = get_state(succ_ids[sidx]);
+        MHAState_AD* succ_state = get_state(succ_ids[sidx]);
         reinit_state(succ_state);
 
-        ROS_DEBUG_NAMED(SSLOG, " Successor %d (dim = %d)", succ_state->state_id, space_->GetDimID(succ_ids[sidx]));
+        ROS_DEBUG_NAMED(SSLOG, " Successor %d (dim = %d)", succ_state->state_id, succ_state->dim_id);
 
         int new_g = state->g + costs[sidx];
         if (new_g < succ_state->g) {
             succ_state->g = new_g;
             succ_state->bp = state;
-            if (!closed_in_anc_search(succ_state)) {
-                const long int fanchor = compute_key(succ_state, 0);
-                insert_or_update(succ_state, 0, fanchor);
-                ROS_DEBUG_NAMED(SSLOG, "  Update in search %d with f = %d + %0.3f * %d = %ld", 0, succ_state->g, m_eps, succ_state->od[0].h, fanchor);
-
-                if (!closed_in_add_search(succ_state)) {
-                    int dimID = space_->GetDimID(succ_state->state_id);
-                    for (int hidx : m_heuristic_list[dimID]){
-                    // for (int hidx = 0; hidx < num_heuristics(); ++hidx){
-                        if(hidx == 0)
-                            continue;
-                        long int fn = compute_key(succ_state, hidx);
-                        if (fn <= (long int)(m_eps_mha * fanchor)) {
-                            insert_or_update(succ_state, hidx, fn);
-                            ROS_DEBUG_NAMED(SSLOG, "  Update in search %d with f = %d + %0.3f * %d = %ld", hidx, succ_state->g, m_eps, succ_state->od[hidx].h, fn);
-                        }
-                        else {
-                            ROS_DEBUG_NAMED(SSLOG, "  Skip update in search %d with f = %d + %0.3f * %d = %ld (> %0.3f * %ld = %ld)",
-                                    hidx,
-                                    succ_state->g, m_eps, succ_state->od[hidx].h, fn,
-                                    m_eps_mha, fanchor, (long int)(m_eps * fanchor));
-                        }
+
+            // the improved cost-to-come of a state being expanded by another
+            // thread is passed on to its successors once its expansion
+            // finishes, and the state is reopened by the next iteration of
+            // an anytime search
+            if (being_expanded(succ_state)) {
+                m_incons.push_back(succ_state);
+                continue;
+            }
+
+            // closed states are reopened by the next iteration of an anytime
+            // search
+            if (closed_in_any_search(succ_state)) {
+                m_incons.push_back(succ_state);
+            }
+
+            progress |= update_open_lists(succ_state, expand_hidx);
+        }
+    }
+
+    return progress;
+}
+
+// Insert a state whose cost-to-come improved into the open lists of the
+// searches it is not closed in. Return whether the best heuristic value seen
+// in search expand_hidx improved.
+bool MHAPlanner_AD::update_open_lists(MHAState_AD* state, int expand_hidx)
+{
+    bool progress = false;
+    if (!closed_in_anc_search(state)) {
+        const long int fanchor = compute_key(state, 0);
+        insert_or_update(state, 0, fanchor);
+        ROS_DEBUG_NAMED(SSLOG, "  Update in search %d with f = %d + %0.3f * %d = %ld", 0, state->g, m_eps, state->od[0].h, fanchor);
+
+        // the inadmissible keys are at least g, since heuristic values are
+        // non-negative, so their heuristics need not be evaluated if g alone
+        // exceeds the bound
+        const long int fbound = (long int)(m_eps_mha * fanchor);
+        if ((long int)state->g > fbound) {
+            ROS_DEBUG_NAMED(SSLOG, "  Skip update in inadmissible searches with g = %d (> %0.3f * %ld = %ld)", state->g, m_eps_mha, fanchor, fbound);
+        }
+        else if (!closed_in_add_search(state)) {
+            for (int hidx : heuristics(state->dim_id)){
+            // for (int hidx = 0; hidx < num_heuristics(); ++hidx){
+                if(hidx == 0)
+                    continue;
+                long int fn = compute_key(state, hidx);
+                if (fn <= fbound) {
+                    insert_or_update(state, hidx, fn);
+                    if (state->od[hidx].h < m_best_h[hidx]) {
+                        m_best_h[hidx] = state->od[hidx].h;
+                        progress |= (hidx == expand_hidx);
                     }
+                    ROS_DEBUG_NAMED(SSLOG, "  Update in search %d with f = %d + %0.3f * %d = %ld", hidx, state->g, m_eps, state->od[hidx].h, fn);
+                }
+                else {
+                    ROS_DEBUG_NAMED(SSLOG, "  Skip update in search %d with f = %d + %0.3f * %d = %ld (> %0.3f * %ld = %ld)",
+                            hidx,
+                            state->g, m_eps, state->od[hidx].h, fn,
+                            m_eps_mha, fanchor, fbound);
                 }
             }
         }
     }
 
-    assert(closed_in_any_search(state));
+    return progress;
 }
 
-MHASearchState* MHAPlanner_AD::state_from_open_state(
+// Prepare the next iteration of an anytime search after the weights were
+// lowered: reopen all states, reinsert the states whose cost-to-come improved
+// after they were closed, and rekey the open lists with the new weights
+void MHAPlanner_AD::reuse_search()
+{
+    for (MHAState_AD* state : m_search_states) {
+        state->closed_in_anc = false;
+        state->closed_in_add = false;
+    }
+
+    for (int hidx = 0; hidx < num_heuristics(); ++hidx) {
+        m_open[hidx]->rekey([&](AbstractSearchState* open_state)
+        {
+            return compute_key(state_from_open_state(open_state), hidx);
+        });
+    }
+
+    for (MHAState_AD* state : m_incons) {
+        if (state->call_number == m_call_number) {
+            update_open_lists(state, 0);
+        }
+    }
+    m_incons.clear();
+}
+
+// Continue the search towards a new goal from the same start. The cost-to-come
+// of the states generated so far remains valid, so only their heuristic values
+// are recomputed, and the search resumes as in a new iteration of the anytime
+// search, with the initial weights.
+void MHAPlanner_AD::retarget_search()
+{
+    ROS_DEBUG_NAMED(SLOG, "Retarget search from goal %d to goal %d", m_last_goal_state_id, m_goal_state->state_id);
+
+    space_->EnsureHeuristicsUpdated(true); // TODO: support backwards search
+
+    reinit_state(m_goal_state);
+    invalidate_heuristics();
+
+    m_eps = m_params.initial_eps;
+    m_eps_mha = m_initial_eps_mha;
+    m_eps_satisfied = (double)INFINITECOST;
+    m_best_path.clear();
+    m_best_cost = INFINITECOST;
+
+    m_scheduler->reset(num_heuristics());
+    m_best_h.assign(num_heuristics(), INFINITECOST);
+
+    reuse_search();
+
+    m_last_goal_state_id = m_goal_state->state_id;
+}
+
+// Invalidate the heuristic values of the states generated by the current
+// search. The values needed to rekey the open lists are recomputed up front in
+// parallel if the heuristics support concurrent evaluation; all others are
+// computed on demand.
+void MHAPlanner_AD::invalidate_heuristics()
+{
+    for (MHAState_AD* state : m_search_states) {
+        state->h_valid = 0;
+    }
+
+    auto recompute = [&](size_t i, int)
+    {
+        MHAState_AD* state = m_search_states[i];
+        if (state->call_number != m_call_number) {
+            return;
+        }
+        for (int hidx : heuristics(state->dim_id)) {
+            if (state->od[hidx].open_state.heapindex != 0) {
+                state->od[hidx].h = compute_heuristic(state->state_id, hidx);
+                state->h_valid |= (uint64_t)1 << hidx;
+            }
+        }
+    };
+
+    if (m_pool && concurrent_heuristics()) {
+        ConcurrentExpansionScope scope(space_, m_pool->numWorkers() > 1);
+        m_pool->parallelFor(m_search_states.size(), recompute);
+    }
+}
+
+bool MHAPlanner_AD::concurrent_heuristics() const
+{
+    bool concurrent = m_hanchor->SupportsConcurrentEvaluation();
+    for (int i = 0; i < m_hcount; ++i) {
+        concurrent &= m_heurs[i]->SupportsConcurrentEvaluation();
+    }
+    return concurrent;
+}
+
+// Lower both weights by the decrement, down to their final values. Return
+// false if neither weight can be lowered.
+bool MHAPlanner_AD::lower_weights()
+{
+    const double eps = std::max(m_params.final_eps, m_eps - m_params.dec_eps);
+    double eps_mha = m_eps_mha;
+    if (m_eps_mha > m_final_eps_mha) {
+        eps_mha = std::max(m_final_eps_mha, m_eps_mha - m_params.dec_eps);
+    }
+
+    if (eps == m_eps && eps_mha == m_eps_mha) {
+        return false;
+    }
+
+    m_eps = eps;
+    m_eps_mha = eps_mha;
+    ROS_DEBUG_NAMED(SLOG, "Lowered weights to eps = %0.3f, eps_mha = %0.3f", m_eps, m_eps_mha);
+    return true;
+}
+
+// Run the search with the current weights until the termination criterion is
+// satisfied, the anchor search is exhausted, or the time limit is reached.
+// Return whether the termination criterion was satisfied.
+bool MHAPlanner_AD::search()
+{
+    if (num_search_threads() > 1) {
+        return parallel_search();
+    }
+
+    sbpl::clock::time_point start_time, end_time;
+    while (!m_open[0]->empty() && !time_limit_reached()) {
+        start_time = sbpl::clock::now();
+        // select an inadmissible queue whose minimum key is within w_2 of the
+        // anchor's, or the anchor queue otherwise
+        const long int anchor_f = get_minf(*m_open[0]);
+        int hidx = select_queue(m_queues, anchor_f, &m_candidates);
+        if (m_goal_state->g <= get_minf(*m_open[hidx])) {
+            return true;
+        }
+
+        MHAState_AD* s = state_from_open_state(m_open[hidx]->min());
+        expand(s, hidx);
+
+        end_time = sbpl::clock::now();
+        m_elapsed += end_time - start_time;
+    }
+
+    return false;
+}
+
+bool MHAPlanner_AD::being_expanded(MHAState_AD* state) const
+{
+    return std::find(m_being_expanded.begin(), m_being_expanded.end(), state) !=
+            m_being_expanded.end();
+}
+
+int MHAPlanner_AD::num_search_threads() const
+{
+    return m_pool ? std::min(m_pool->numWorkers(), m_hcount) : 1;
+}
+
+bool MHAPlanner_AD::parallel_search()
+{
+    const int num_threads = num_search_threads();
+    ROS_DEBUG_NAMED(SLOG, "Search with %d threads", num_threads);
+
+    m_being_expanded.clear();
+    m_search_status = SEARCHING;
+    m_search_start = sbpl::clock::now() - m_elapsed;
+
+    // the space is called concurrently by the expansions, or by the
+    // heuristics evaluated alongside them
+    {
+        ConcurrentExpansionScope scope(space_,
+                space_->supportsConcurrentExpansions() || concurrent_heuristics());
+        m_pool->parallelFor(num_threads, [&](size_t thread_idx, int)
+        {
+            search_loop((int)thread_idx, num_threads);
+        });
+    }
+
+    m_elapsed = sbpl::clock::now() - m_search_start;
+
+    return m_search_status == FOUND;
+}
+
+// Drive the inadmissible queues thread_idx + 1, thread_idx + 1 + num_threads,
+// ..., as chosen by the queue scheduler, falling back to the shared anchor queue as in the
+// sequential search, until a solution is found, the time limit is reached, or
+// the anchor search is exhausted.
+void MHAPlanner_AD::search_loop(int thread_idx, int num_threads)
+{
+    SuccessorBuffer succs;
+    std::vector<HeuristicRequest> requests;
+    const bool concurrent = space_->supportsConcurrentExpansions();
+    const bool concurrent_heur = concurrent_heuristics();
+
+    std::vector<int> queues;
+    for (int hidx = thread_idx + 1; hidx < num_heuristics(); hidx += num_threads) {
+        queues.push_back(hidx);
+    }
+    std::vector<int> candidates;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_search_status == SEARCHING) {
+        m_elapsed = sbpl::clock::now() - m_search_start;
+        if (time_limit_reached()) {
+            m_search_status = TIMED_OUT;
+            break;
+        }
+
+        if (m_open[0]->empty() && m_being_expanded.empty()) {
+            m_search_status = EXHAUSTED;
+            break;
+        }
+
+        const long int anchor_f = get_anchor_bound();
+        int hidx = select_queue(queues, anchor_f, &candidates);
+
+        MHAState_AD* s = NULL;
+        if (hidx != 0) {
+            if (m_goal_state->g <= get_minf(*m_open[hidx])) {
+                m_search_status = FOUND;
+                break;
+            }
+            s = state_from_open_state(m_open[hidx]->min());
+        }
+        else {
+            if (m_goal_state->g <= anchor_f) {
+                m_search_status = FOUND;
+                break;
+            }
+            // the anchor search waits for the expansions of states with
+            // smaller anchor keys to finish
+            if (!m_open[0]->empty() && get_minf(*m_open[0]) <= anchor_f) {
+                s = state_from_open_state(m_open[0]->min());
+            }
+        }
+
+        if (!s) {
+            m_cv.wait(lock);
+            continue;
+        }
+
+        begin_expansion(s, hidx);
+        m_being_expanded.push_back(s);
+
+        lock.unlock();
+        {
+            std::unique_lock<std::mutex> expand_lock(m_expand_mutex, std::defer_lock);
+            if (!concurrent) {
+                expand_lock.lock();
+            }
+            environment_->GetSuccs(s->state_id, &succs);
+        }
+        lock.lock();
+
+        // compute the heuristic values needed to update the successors
+        // outside of the lock; s remains being expanded until they are
+        // updated, so that it still bounds the anchor search
+        get_heuristic_requests(s, succs, &requests);
+        if (!requests.empty()) {
+            lock.unlock();
+            {
+                std::unique_lock<std::mutex> heur_lock(m_expand_mutex, std::defer_lock);
+                if (!concurrent_heur) {
+                    heur_lock.lock();
+                }
+                for (HeuristicRequest& r : requests) {
+                    r.h = compute_heuristic(r.state->state_id, r.hidx);
+                }
+            }
+            lock.lock();
+
+            for (const HeuristicRequest& r : requests) {
+                const uint64_t bit = (uint64_t)1 << r.hidx;
+                if (!(r.state->h_valid & bit)) {
+                    r.state->od[r.hidx].h = r.h;
+                    r.state->h_valid |= bit;
+                }
+            }
+        }
+
+        m_being_expanded.erase(std::find(
+                m_being_expanded.begin(), m_being_expanded.end(), s));
+        const bool progress = update_succs(s, succs, hidx);
+        if (hidx != 0) {
+            m_scheduler->update(hidx, progress);
+        }
+        m_cv.notify_all();
+    }
+
+    // wake up waiting threads to observe the termination
+    m_cv.notify_all();
+}
+
+// Collect the heuristic values that updating the successors of a state would
+// compute, i.e. those of the successors whose cost-to-come improves, in the
+// searches they are to be inserted into, that have not been computed yet.
+void MHAPlanner_AD::get_heuristic_requests(
+    MHAState_AD* state,
+    const SuccessorBuffer& succs,
+    std::vector<HeuristicRequest>* requests)
+{
+    requests->clear();
+    for (size_t sidx = 0; sidx < succs.size(); ++sidx) {
+        MHAState_AD* succ_state = get_state(succs.ids[sidx]);
+        reinit_state(succ_state);
+
+        if (state->g + succs.costs[sidx] >= succ_state->g ||
+            being_expanded(succ_state) ||
+            closed_in_anc_search(succ_state))
+        {
+            continue;
+        }
+
+        // as in update_open_lists(), the inadmissible values are not needed
+        // if the new cost-to-come alone exceeds the bound, which is known
+        // only if the anchor value has been computed
+        const int new_g = state->g + succs.costs[sidx];
+        bool skip_add = closed_in_add_search(succ_state);
+        if (succ_state->h_valid & 1) {
+            const long int fanchor = (long int)new_g +
+                    (long int)(m_eps * (long int)succ_state->od[0].h);
+            skip_add |= (long int)new_g > (long int)(m_eps_mha * fanchor);
+        }
+        for (int hidx : heuristics(succ_state->dim_id)) {
+            if (hidx != 0 && skip_add) {
+                break;
+            }
+            if (!(succ_state->h_valid & ((uint64_t)1 << hidx))) {
+                requests->push_back(HeuristicRequest{ succ_state, hidx, 0 });
+            }
+        }
+    }
+}
+
+// Select one of the non-empty queues among the given inadmissible queues with
+// the queue scheduler. Return the selected queue if its minimum key is within
+// w_2 of anchor_f, or the anchor queue (0) otherwise.
+int MHAPlanner_AD::select_queue(
+    const std::vector<int>& queues,
+    long int anchor_f,
+    std::vector<int>* candidates)
+{
+    candidates->clear();
+    for (int hidx : queues) {
+        if (!m_open[hidx]->empty()) {
+            candidates->push_back(hidx);
+        }
+    }
+
+    if (candidates->empty()) {
+        return 0;
+    }
+
+    const int hidx = m_scheduler->selectQueue(*candidates);
+    if (get_minf(*m_open[hidx]) <= m_eps_mha * anchor_f) {
+        return hidx;
+    }
+    return 0;
+}
+
+// Return the smallest anchor key among the states in the anchor queue and the
+// states being expanded, which bounds the cost of the solution in place of
+// the minimum of the anchor queue while expansions are in progress
+long int MHAPlanner_AD::get_anchor_bound()
+{
+    long int f = get_minf(*m_open[0]);
+    for (MHAState_AD* s : m_being_expanded) {
+        f = std::min(f, compute_key(s, 0));
+    }
+    return f;
+}
+
+MHAState_AD* MHAPlanner_AD::state_from_open_state(
     AbstractSearchState* open_state)
 {
     const size_t ssidx = reinterpret_cast<size_t>(open_state->listelem[0]);
     return m_search_states[ssidx];
 }
 
+// Return the value of heuristic hidx for a state, computing it if it has not
+// been computed since the state was (re)initialized
+int MHAPlanner_AD::get_heuristic(MHAState_AD* state, int hidx)
+{
+    const uint64_t bit = (uint64_t)1 << hidx;
+    if (!(state->h_valid & bit)) {
+        state->od[hidx].h = compute_heuristic(state->state_id, hidx);
+        state->h_valid |= bit;
+    }
+    return state->od[hidx].h;
+}
+
 int MHAPlanner_AD::compute_heuristic(int state_id, int hidx)
 {
     if (hidx == 0) {
@@ -719,22 +1220,14 @@ int MHAPlanner_AD::compute_heuristic(int state_id, int hidx)
     }
 }
 
-long int MHAPlanner_AD::get_minf(CHeap& pq) const
+long int MHAPlanner_AD::get_minf(OpenList& pq) const
 {
-    return pq.getminkeyheap().key[0];
+    return pq.minKey();
 }
 
-void MHAPlanner_AD::insert_or_update(MHASearchState* state, int hidx, int f)
+void MHAPlanner_AD::insert_or_update(MHAState_AD* state, int hidx, long int f)
 {
-    CKey new_key;
-    new_key.key[0] = f;
-
-    if (state->od[hidx].open_state.heapindex != 0) {
-        m_open[hidx].updateheap(&state->od[hidx].open_state, new_key);
-    }
-    else {
-        m_open[hidx].insertheap(&state->od[hidx].open_state, new_key);
-    }
+    m_open[hidx]->insertOrUpdate(&state->od[hidx].open_state, f);
 }
 
 void MHAPlanner_AD::extract_path(std::vector<int>* solution_path, int* solcost)
@@ -742,7 +1235,7 @@ void MHAPlanner_AD::extract_path(std::vector<int>* solution_path, int* solcost)
     ROS_DEBUG_NAMED(SLOG, "Extracting path");
     solution_path->clear();
     *solcost = 0;
-    for (MHASearchState* state = m_goal_state; state; state = state->bp) {
+    for (MHAState_AD* state = m_goal_state; state; state = state->bp) {
         solution_path->push_back(state->state_id);
         if (state->bp) {
             *solcost += (state->g - state->bp->g);
@@ -756,12 +1249,12 @@ void MHAPlanner_AD::extract_path(std::vector<int>* solution_path, int* solcost)
 void MHAPlanner_AD::extract_partial_path(
     std::vector<int>* solution_path,
     int* solcost,
-    MHASearchState* best_seen_state)
+    MHAState_AD* best_seen_state)
 {
     ROS_DEBUG_NAMED(SLOG, "Extracting path");
     solution_path->clear();
     *solcost = 0;
-    for (MHASearchState* state = best_seen_state; state; state = state->bp) {
+    for (MHAState_AD* state = best_seen_state; state; state = state->bp) {
         solution_path->push_back(state->state_id);
         if (state->bp) {
             *solcost += (state->g - state->bp->g);
@@ -772,17 +1265,17 @@ void MHAPlanner_AD::extract_partial_path(
     std::reverse(solution_path->begin(), solution_path->end());
 }
 
-bool MHAPlanner_AD::closed_in_anc_search(MHASearchState* state) const
+bool MHAPlanner_AD::closed_in_anc_search(MHAState_AD* state) const
 {
     return state->closed_in_anc;
 }
 
-bool MHAPlanner_AD::closed_in_add_search(MHASearchState* state) const
+bool MHAPlanner_AD::closed_in_add_search(MHAState_AD* state) const
 {
     return state->closed_in_add;
 }
 
-bool MHAPlanner_AD::closed_in_any_search(MHASearchState* state) const
+bool MHAPlanner_AD::closed_in_any_search(MHAState_AD* state) const
 {
     return state->closed_in_anc || state->closed_in_add;
 }
@@ -0,0 +1,121 @@
+#include <sbpl_adaptive/mrep/search/queue_scheduler.h>
+
+// standard includes
+#include <assert.h>
+
+namespace adim {
+
+const char *to_string(QueueSchedulerType type)
+{
+    switch (type) {
+    case QueueSchedulerType::ROUND_ROBIN:       return "RoundRobin";
+    case QueueSchedulerType::THOMPSON_SAMPLING: return "ThompsonSampling";
+    default:                                    return "Unknown";
+    }
+}
+
+QueueScheduler *MakeQueueScheduler(QueueSchedulerType type)
+{
+    switch (type) {
+    case QueueSchedulerType::THOMPSON_SAMPLING:
+        return new ThompsonSamplingScheduler;
+    case QueueSchedulerType::ROUND_ROBIN:
+    default:
+        return new RoundRobinScheduler;
+    }
+}
+
+RoundRobinScheduler::RoundRobinScheduler() : m_last(-1)
+{
+}
+
+void RoundRobinScheduler::reset(int num_queues)
+{
+    m_last = -1;
+}
+
+// Select the candidate following the last selected queue, wrapping around to
+// the candidate with the smallest index
+int RoundRobinScheduler::selectQueue(const std::vector<int> &queues)
+{
+    assert(!queues.empty());
+    int next = -1;
+    int first = queues.front();
+    for (int q : queues) {
+        if (q > m_last && (next == -1 || q < next)) {
+            next = q;
+        }
+        if (q < first) {
+            first = q;
+        }
+    }
+    m_last = next != -1 ? next : first;
+    return m_last;
+}
+
+ThompsonSamplingScheduler::ThompsonSamplingScheduler(
+    double history_bound,
+    unsigned int seed)
+:
+    m_history_bound(history_bound),
+    m_seed(seed),
+    m_rng(seed),
+    m_alpha(),
+    m_beta()
+{
+}
+
+void ThompsonSamplingScheduler::reset(int num_queues)
+{
+    m_rng.seed(m_seed);
+    m_alpha.assign(num_queues, 1.0);
+    m_beta.assign(num_queues, 1.0);
+}
+
+int ThompsonSamplingScheduler::selectQueue(const std::vector<int> &queues)
+{
+    assert(!queues.empty());
+    int best = queues.front();
+    double best_sample = -1.0;
+    for (int q : queues) {
+        assert(q >= 0 && q < (int)m_alpha.size());
+        const double sample = sampleBeta(m_alpha[q], m_beta[q]);
+        if (sample > best_sample) {
+            best = q;
+            best_sample = sample;
+        }
+    }
+    return best;
+}
+
+void ThompsonSamplingScheduler::update(int queue, bool progress)
+{
+    assert(queue >= 0 && queue < (int)m_alpha.size());
+    double &alpha = m_alpha[queue];
+    double &beta = m_beta[queue];
+    if (progress) {
+        alpha += 1.0;
+    }
+    else {
+        beta += 1.0;
+    }
+
+    if (alpha + beta > m_history_bound) {
+        const double scale = m_history_bound / (m_history_bound + 1.0);
+        alpha *= scale;
+        beta *= scale;
+    }
+}
+
+// Sample Beta(alpha, beta) as X / (X + Y) with X ~ Gamma(alpha, 1) and
+// Y ~ Gamma(beta, 1)
+double ThompsonSamplingScheduler::sampleBeta(double alpha, double beta)
+{
+    std::gamma_distribution<double> gx(alpha, 1.0);
+    std::gamma_distribution<double> gy(beta, 1.0);
+    const double x = gx(m_rng);
+    const double y = gy(m_rng);
+    return x + y > 0.0 ? x / (x + y) : 0.5;
+}
+
+} // namespace adim
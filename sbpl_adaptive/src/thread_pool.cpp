@@ -0,0 +1,140 @@
+#include <sbpl_adaptive/thread_pool.h>
+
+// standard includes
+#include <algorithm>
+#include <utility>
+
+namespace adim {
+
+ThreadPool::ThreadPool(int num_workers) :
+    num_workers_(num_workers),
+    threads_(),
+    ranges_(),
+    mutex_(),
+    start_cv_(),
+    done_cv_(),
+    task_(nullptr),
+    error_(),
+    generation_(0),
+    active_(0),
+    stop_(false)
+{
+    if (num_workers_ <= 0) {
+        num_workers_ = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    ranges_.reset(new Range[num_workers_]);
+    for (int i = 0; i < num_workers_; ++i) {
+        ranges_[i].next = 0;
+        ranges_[i].end = 0;
+    }
+
+    threads_.reserve(num_workers_ - 1);
+    for (int i = 1; i < num_workers_; ++i) {
+        threads_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (std::thread &thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const Task &task)
+{
+    if (n == 0) {
+        return;
+    }
+
+    // not worth waking up the workers
+    if (threads_.empty() || n == 1) {
+        for (size_t i = 0; i < n; ++i) {
+            task(i, 0);
+        }
+        return;
+    }
+
+    const size_t num_workers = num_workers_;
+    for (size_t w = 0; w < num_workers; ++w) {
+        ranges_[w].next = n * w / num_workers;
+        ranges_[w].end = n * (w + 1) / num_workers;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        active_ = (int)threads_.size();
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    run(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&]() { return active_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::exception_ptr error;
+        std::swap(error, error_);
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+    unsigned int generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&]() {
+                return stop_ || generation_ != generation;
+            });
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+        }
+
+        run(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+        }
+        done_cv_.notify_one();
+    }
+}
+
+// Process the worker's own range, then steal from the other workers' ranges.
+// If the task throws, record the first exception and drain all ranges so
+// that the other workers stop early
+void ThreadPool::run(int worker)
+{
+    const Task &task = *task_;
+    try {
+        for (int k = 0; k < num_workers_; ++k) {
+            Range &range = ranges_[(worker + k) % num_workers_];
+            for (size_t i = range.next++; i < range.end; i = range.next++) {
+                task(i, worker);
+            }
+        }
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+        for (int k = 0; k < num_workers_; ++k) {
+            ranges_[k].next = ranges_[k].end;
+        }
+    }
+}
+
+} // namespace adim
@@ -0,0 +1,169 @@
+// standard includes
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/chunked_arena.h>
+
+using namespace adim;
+
+namespace {
+
+struct Counted
+{
+    static int live;
+    int value;
+    explicit Counted(int v) : value(v) { ++live; }
+    ~Counted() { --live; }
+};
+
+int Counted::live = 0;
+
+// A header followed by a run-time number of trailing elements
+struct Header
+{
+    int n;
+    int data[1];
+};
+
+} // namespace
+
+TEST(ChunkedArenaTest, CreateAndIndex)
+{
+    ChunkedArena<int> arena(4);
+    EXPECT_TRUE(arena.empty());
+    std::vector<int *> ptrs;
+    for (int i = 0; i < 1000; ++i) {
+        ptrs.push_back(arena.create(i));
+        ASSERT_EQ((size_t)i + 1, arena.size());
+    }
+
+    // objects never move as chunks are added
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(ptrs[i], &arena[i]);
+        EXPECT_EQ(i, arena[i]);
+    }
+}
+
+TEST(ChunkedArenaTest, ClearKeepsChunksAndReleaseFreesThem)
+{
+    ChunkedArena<double> arena(16);
+    for (int i = 0; i < 100; ++i) {
+        arena.create(i);
+    }
+    const size_t bytes = arena.capacityBytes();
+    EXPECT_GE(bytes, 100 * sizeof(double));
+
+    arena.clear();
+    EXPECT_TRUE(arena.empty());
+    EXPECT_EQ(bytes, arena.capacityBytes());
+
+    // chunks are reused
+    for (int i = 0; i < 100; ++i) {
+        arena.create(-i);
+    }
+    EXPECT_EQ(bytes, arena.capacityBytes());
+    EXPECT_EQ(-99.0, arena[99]);
+
+    arena.release();
+    EXPECT_TRUE(arena.empty());
+    EXPECT_EQ(0u, arena.capacityBytes());
+    arena.create(1.0);
+    EXPECT_EQ(1.0, arena[0]);
+}
+
+TEST(ChunkedArenaTest, DestroysObjects)
+{
+    {
+        ChunkedArena<Counted> arena(8);
+        for (int i = 0; i < 50; ++i) {
+            arena.create(i);
+        }
+        EXPECT_EQ(50, Counted::live);
+        arena.clear();
+        EXPECT_EQ(0, Counted::live);
+        for (int i = 0; i < 20; ++i) {
+            arena.create(i);
+        }
+        EXPECT_EQ(20, Counted::live);
+    }
+    EXPECT_EQ(0, Counted::live);
+}
+
+TEST(ChunkedArenaTest, RuntimeSlotSizeAndAlignment)
+{
+    const int n = 15;
+    const size_t slot_size = sizeof(Header) + n * sizeof(int);
+    ChunkedArena<Header> arena(8, slot_size, ChunkedArena<Header>::CACHE_LINE_SIZE);
+    EXPECT_GE(arena.stride(), slot_size);
+    EXPECT_EQ(0u, arena.stride() % ChunkedArena<Header>::CACHE_LINE_SIZE);
+
+    for (int i = 0; i < 100; ++i) {
+        Header *h = arena.create();
+        ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(h) % ChunkedArena<Header>::CACHE_LINE_SIZE);
+        h->n = i;
+        for (int j = 0; j <= n; ++j) {
+            h->data[j] = i * 100 + j;
+        }
+    }
+
+    // the trailing elements of consecutive objects do not overlap
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(i, arena[i].n);
+        for (int j = 0; j <= n; ++j) {
+            ASSERT_EQ(i * 100 + j, arena[i].data[j]);
+        }
+    }
+}
+
+TEST(ChunkedArenaTest, SlotSizeIsAtLeastObjectSize)
+{
+    ChunkedArena<Header> arena(8, 1);
+    EXPECT_GE(arena.stride(), sizeof(Header));
+    EXPECT_EQ(0u, arena.stride() % alignof(Header));
+}
+
+// Objects that have been created may be read while further objects are
+// created, including while the chunk directory is replaced
+TEST(ChunkedArenaTest, ConcurrentReadsDuringCreation)
+{
+    const size_t n = 200000;
+    ChunkedArena<size_t> arena(2);
+    std::atomic<bool> done(false);
+    std::atomic<size_t> bad(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&]() {
+            while (!done.load()) {
+                const size_t size = arena.size();
+                for (size_t i = size > 64 ? size - 64 : 0; i < size; ++i) {
+                    if (arena[i] != 3 * i) {
+                        ++bad;
+                    }
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        arena.create(3 * i);
+    }
+    done = true;
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(0u, bad.load());
+    EXPECT_EQ(n, arena.size());
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
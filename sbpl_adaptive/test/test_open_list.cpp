@@ -0,0 +1,258 @@
+// standard includes
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/core/search/open_list.h>
+
+using namespace adim;
+
+namespace {
+
+const OpenListType kTypes[] = {
+    OpenListType::BINARY_HEAP,
+    OpenListType::BUCKET_QUEUE,
+    OpenListType::QUATERNARY_HEAP,
+};
+
+// Keys of the states currently in an open list, indexed by the position of
+// the state in a vector of states
+typedef std::map<size_t, OpenList::Key> KeyMap;
+
+size_t Index(const std::vector<AbstractSearchState> &states, AbstractSearchState *s)
+{
+    return (size_t)(s - &states[0]);
+}
+
+OpenList::Key MinKey(const KeyMap &keys)
+{
+    OpenList::Key min = keys.begin()->second;
+    for (const auto &entry : keys) {
+        min = std::min(min, entry.second);
+    }
+    return min;
+}
+
+// Pop all states and check that they come out in key order and that each is
+// removed from the list
+void ExpectPopsInKeyOrder(
+    OpenList &list,
+    std::vector<AbstractSearchState> &states,
+    KeyMap &keys)
+{
+    while (!keys.empty()) {
+        ASSERT_EQ(keys.size(), list.size());
+        const OpenList::Key min = MinKey(keys);
+        ASSERT_EQ(min, list.minKey());
+        ASSERT_EQ(list.min(), list.min());
+        AbstractSearchState *s = list.deleteMin();
+        ASSERT_TRUE(s != NULL);
+        EXPECT_EQ(0, s->heapindex);
+        const size_t i = Index(states, s);
+        ASSERT_EQ(1u, keys.count(i));
+        EXPECT_EQ(min, keys[i]);
+        keys.erase(i);
+    }
+    EXPECT_TRUE(list.empty());
+}
+
+} // namespace
+
+TEST(OpenListTest, EmptyList)
+{
+    for (OpenListType type : kTypes) {
+        SCOPED_TRACE(to_string(type));
+        std::unique_ptr<OpenList> list(MakeOpenList(type));
+        EXPECT_TRUE(list->empty());
+        EXPECT_EQ(0u, list->size());
+        EXPECT_EQ((OpenList::Key)INFINITECOST, list->minKey());
+        EXPECT_TRUE(list->min() == NULL);
+        EXPECT_TRUE(list->deleteMin() == NULL);
+    }
+}
+
+TEST(OpenListTest, PopsInKeyOrder)
+{
+    for (OpenListType type : kTypes) {
+        SCOPED_TRACE(to_string(type));
+        std::unique_ptr<OpenList> list(MakeOpenList(type));
+        std::vector<AbstractSearchState> states(1000);
+        std::mt19937 rng(1);
+        KeyMap keys;
+        for (size_t i = 0; i < states.size(); ++i) {
+            // many duplicate keys
+            const OpenList::Key key = rng() % 100;
+            list->insert(&states[i], key);
+            EXPECT_NE(0, states[i].heapindex);
+            keys[i] = key;
+        }
+        ExpectPopsInKeyOrder(*list, states, keys);
+    }
+}
+
+TEST(OpenListTest, MatchesReferenceUnderRandomOperations)
+{
+    for (OpenListType type : kTypes) {
+        SCOPED_TRACE(to_string(type));
+        std::unique_ptr<OpenList> list(MakeOpenList(type));
+        std::vector<AbstractSearchState> states(200);
+        std::mt19937 rng(2);
+        KeyMap keys;
+        for (int it = 0; it < 50000; ++it) {
+            const size_t i = rng() % states.size();
+            // mostly small keys, with occasional far away ones
+            const OpenList::Key key = rng() % 8 == 0 ?
+                    (OpenList::Key)(rng() % 1000) * 100000 : rng() % 300;
+            switch (rng() % 5) {
+            case 0:
+            case 1:
+                list->insertOrUpdate(&states[i], key);
+                keys[i] = key;
+                break;
+            case 2:
+                if (keys.count(i)) {
+                    list->erase(&states[i]);
+                    EXPECT_EQ(0, states[i].heapindex);
+                    keys.erase(i);
+                }
+                break;
+            default:
+                if (!keys.empty()) {
+                    const OpenList::Key min = MinKey(keys);
+                    ASSERT_EQ(min, list->minKey());
+                    const size_t j = Index(states, list->deleteMin());
+                    ASSERT_EQ(min, keys[j]);
+                    keys.erase(j);
+                }
+                break;
+            }
+            ASSERT_EQ(keys.size(), list->size());
+        }
+        ExpectPopsInKeyOrder(*list, states, keys);
+    }
+}
+
+TEST(OpenListTest, RekeyRestoresOrder)
+{
+    for (OpenListType type : kTypes) {
+        SCOPED_TRACE(to_string(type));
+        std::unique_ptr<OpenList> list(MakeOpenList(type));
+        std::vector<AbstractSearchState> states(500);
+        KeyMap keys;
+        for (size_t i = 0; i < states.size(); ++i) {
+            list->insert(&states[i], (OpenList::Key)i);
+        }
+        // reverse the order
+        list->rekey([&](AbstractSearchState *s) {
+            const size_t i = Index(states, s);
+            keys[i] = (OpenList::Key)(2 * (states.size() - i));
+            return keys[i];
+        });
+        ASSERT_EQ(states.size(), keys.size());
+        EXPECT_EQ(&states.back(), list->min());
+        ExpectPopsInKeyOrder(*list, states, keys);
+    }
+}
+
+TEST(OpenListTest, ClearRemovesAllStates)
+{
+    for (OpenListType type : kTypes) {
+        SCOPED_TRACE(to_string(type));
+        std::unique_ptr<OpenList> list(MakeOpenList(type));
+        std::vector<AbstractSearchState> states(100);
+        for (size_t i = 0; i < states.size(); ++i) {
+            list->insert(&states[i], (OpenList::Key)(i * 7 % 13));
+        }
+        list->clear();
+        EXPECT_TRUE(list->empty());
+        for (const AbstractSearchState &s : states) {
+            EXPECT_EQ(0, s.heapindex);
+        }
+
+        // the list is usable after clearing
+        list->insert(&states[3], 5);
+        list->insert(&states[4], 2);
+        EXPECT_EQ(&states[4], list->deleteMin());
+        EXPECT_EQ(&states[3], list->deleteMin());
+    }
+}
+
+// Keys beyond the range of int, e.g. heavily inflated f-values, must not
+// overflow (SBPL's CHeap limits keys to INFINITECOST, so the binary heap is
+// not covered)
+TEST(OpenListTest, LargeKeys)
+{
+    for (OpenListType type : { OpenListType::BUCKET_QUEUE, OpenListType::QUATERNARY_HEAP }) {
+        SCOPED_TRACE(to_string(type));
+        std::unique_ptr<OpenList> list(MakeOpenList(type));
+        std::vector<AbstractSearchState> states(64);
+        KeyMap keys;
+        const OpenList::Key big = (OpenList::Key)1 << 40;
+        for (size_t i = 0; i < states.size(); ++i) {
+            keys[i] = big + (OpenList::Key)((i * 37) % 64) * big / 8;
+            list->insert(&states[i], keys[i]);
+        }
+        ExpectPopsInKeyOrder(*list, states, keys);
+    }
+}
+
+// Keys that fall beyond the window of buckets go to the overflow list, and
+// keys below the window extend it downwards
+TEST(BucketOpenListTest, OverflowAndWindowExtension)
+{
+    for (int max_span : { 1, 4, 64 }) {
+        SCOPED_TRACE(max_span);
+        BucketOpenList list(max_span);
+        std::vector<AbstractSearchState> states(300);
+        std::mt19937 rng(max_span);
+        KeyMap keys;
+        for (size_t i = 0; i < states.size(); ++i) {
+            // start in the middle so that later keys land on both sides of
+            // the window
+            const OpenList::Key key = i == 0 ? 5000 : rng() % 10000;
+            list.insert(&states[i], key);
+            keys[i] = key;
+        }
+
+        // move some states between the window and the overflow list
+        for (size_t i = 0; i < states.size(); i += 3) {
+            keys[i] = keys[i] < 5000 ? keys[i] + 5000 : keys[i] - 5000;
+            list.update(&states[i], keys[i]);
+        }
+        for (size_t i = 1; i < states.size(); i += 7) {
+            list.erase(&states[i]);
+            keys.erase(i);
+        }
+        ExpectPopsInKeyOrder(list, states, keys);
+    }
+}
+
+TEST(BucketOpenListTest, InterleavedInsertionsBelowMinimum)
+{
+    BucketOpenList list(16);
+    std::vector<AbstractSearchState> states(100);
+    KeyMap keys;
+    // monotone decreasing keys, popping every other insertion
+    for (size_t i = 0; i < states.size(); ++i) {
+        keys[i] = (OpenList::Key)(1000 - 10 * i);
+        list.insert(&states[i], keys[i]);
+        if (i % 2 == 1) {
+            const size_t j = Index(states, list.deleteMin());
+            EXPECT_EQ(i, j);
+            keys.erase(j);
+        }
+    }
+    ExpectPopsInKeyOrder(list, states, keys);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
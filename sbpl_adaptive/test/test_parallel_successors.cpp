@@ -0,0 +1,310 @@
+// standard includes
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/mrep/graph/adaptive_state_representation.h>
+#include <sbpl_adaptive/mrep/graph/multirep_adaptive_discrete_space.h>
+#include <sbpl_adaptive/thread_pool.h>
+
+using namespace adim;
+
+namespace {
+
+const int W = 48;
+
+struct GridState : public AdaptiveState
+{
+    int x;
+    int y;
+    GridState(int x, int y) : x(x), y(y) { }
+};
+
+class GridSpace : public MultiRepAdaptiveDiscreteSpace
+{
+public:
+
+    void expandingState(int) override { }
+    int getBestSeenState() override { return -1; }
+    void addSphere(int, std::vector<int> *) override { }
+    void addSphere(int, int &) override { }
+    void processCostlyPath(
+        const std::vector<int> &,
+        const std::vector<int> &,
+        std::vector<int> *) override { }
+    void reset() override { }
+
+    int GetFromToHeuristic(int, int) override { return 0; }
+    int GetGoalHeuristic(int) override { return 0; }
+    int GetStartHeuristic(int) override { return 0; }
+
+    bool InitializeEnv(const char *) override { return true; }
+    bool InitializeMDPCfg(void *) override { return true; }
+    void SetAllActionsandAllOutcomes(void *) override { }
+    void SetAllPreds(void *) override { }
+    int SizeofCreatedEnv() override { return (int)state_id_to_hash_entry_.size(); }
+    void PrintState(int, bool, FILE *) override { }
+    void PrintEnv_Config(FILE *) override { }
+};
+
+// A grid representation whose motion primitives move up to two cells in each
+// direction. Each primitive is validated by sampling its segment against an
+// obstacle map, in parallel via the space's ParallelFor, with per-worker
+// scratch buffers standing in for per-worker collision checkers.
+class GridRepresentation : public AdaptiveStateRepresentation
+{
+public:
+
+    GridRepresentation(
+        const MultiRepAdaptiveDiscreteSpacePtr &space,
+        const std::vector<char> &obstacles)
+    :
+        AdaptiveStateRepresentation(space, true, "grid"),
+        obstacles_(obstacles),
+        scratch_(space->NumWorkers()),
+        bad_worker_(0)
+    {
+        for (int dx = -2; dx <= 2; ++dx) {
+            for (int dy = -2; dy <= 2; ++dy) {
+                if (dx || dy) {
+                    prims_.push_back({ dx, dy });
+                }
+            }
+        }
+    }
+
+    int CreateState(int x, int y)
+    {
+        AdaptiveHashEntry *entry = mrepSpace()->FindOrInsertState(
+                hash(x, y), getID(), equal(x, y), GridState(x, y));
+        return entry->stateID;
+    }
+
+    void GetSuccs(int state_id, std::vector<int> *succs, std::vector<int> *costs) override
+    {
+        const GridState *s = mrepSpace()->GetState(state_id)->dataAs<GridState>();
+
+        valid_.assign(prims_.size(), 0);
+        mrepSpace()->ParallelFor(prims_.size(), [&](size_t i, int worker)
+        {
+            if (worker < 0 || worker >= (int)scratch_.size()) {
+                ++bad_worker_;
+                return;
+            }
+            valid_[i] = checkSegment(s->x, s->y, prims_[i], scratch_[worker]);
+        });
+
+        // create the valid successors in index order
+        for (size_t i = 0; i < prims_.size(); ++i) {
+            if (valid_[i]) {
+                succs->push_back(CreateState(s->x + prims_[i].dx, s->y + prims_[i].dy));
+                costs->push_back(10 * std::max(abs(prims_[i].dx), abs(prims_[i].dy)) +
+                        4 * std::min(abs(prims_[i].dx), abs(prims_[i].dy)));
+            }
+        }
+    }
+
+    int badWorkers() const { return bad_worker_; }
+
+    int SetStartCoords(const AdaptiveState *) override { return 0; }
+    int SetStartConfig(const ModelCoords *) override { return 0; }
+    int SetGoalCoords(const AdaptiveState *) override { return 0; }
+    int SetGoalConfig(const ModelCoords *) override { return 0; }
+    bool isGoalState(int) const override { return false; }
+    void GetTrackSuccs(int state_id, std::vector<int> *succs, std::vector<int> *costs) override
+    { GetSuccs(state_id, succs, costs); }
+    void GetPreds(int, std::vector<int> *, std::vector<int> *) override { }
+    bool IsValidStateData(const AdaptiveState *) const override { return true; }
+    bool IsValidConfig(const ModelCoords *) const override { return true; }
+    int GetGoalHeuristic(int) const override { return 0; }
+    void PrintState(int, bool, FILE *) const override { }
+    void PrintStateData(const AdaptiveState *, bool, FILE *) const override { }
+    void VisualizeState(int, int, const std::string &, int &) const override { }
+    bool ProjectToFullD(const AdaptiveState *, std::vector<int> &, int) override { return false; }
+    bool ProjectFromFullD(const AdaptiveState *, std::vector<int> &, int) override { return false; }
+    void deleteStateData(int) override { }
+    void toCont(const AdaptiveState *, ModelCoords *) const override { }
+    void toDisc(const ModelCoords *, AdaptiveState *) const override { }
+
+private:
+
+    struct Primitive
+    {
+        int dx;
+        int dy;
+    };
+
+    const std::vector<char> &obstacles_;
+    std::vector<Primitive> prims_;
+    std::vector<char> valid_;
+    std::vector<std::vector<int>> scratch_;
+    std::atomic<int> bad_worker_;
+
+    static size_t hash(int x, int y) { return (size_t)(y * W + x); }
+
+    static std::function<bool(AdaptiveHashEntry *)> equal(int x, int y)
+    {
+        return [x, y](AdaptiveHashEntry *e) {
+            const GridState *s = e->dataAs<GridState>();
+            return s->x == x && s->y == y;
+        };
+    }
+
+    // sample the segment into the worker's scratch buffer, then check every
+    // sampled cell
+    bool checkSegment(int x, int y, const Primitive &p, std::vector<int> &cells) const
+    {
+        cells.clear();
+        const int steps = 8;
+        for (int k = 0; k <= steps; ++k) {
+            const int cx = x + (int)((double)p.dx * k / steps + (p.dx >= 0 ? 0.5 : -0.5));
+            const int cy = y + (int)((double)p.dy * k / steps + (p.dy >= 0 ? 0.5 : -0.5));
+            if (cx < 0 || cy < 0 || cx >= W || cy >= W) {
+                return false;
+            }
+            cells.push_back(cy * W + cx);
+        }
+        for (int c : cells) {
+            if (obstacles_[c]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct Transition
+{
+    int source;
+    std::vector<int> succs;
+    std::vector<int> costs;
+};
+
+// Expand every state reachable from the center of the grid, breadth first,
+// and record the successors of each expansion
+std::vector<Transition> ExploreGrid(const std::vector<char> &obstacles, int num_workers)
+{
+    std::shared_ptr<GridSpace> space = std::make_shared<GridSpace>();
+    if (num_workers > 0) {
+        space->SetThreadPool(std::make_shared<ThreadPool>(num_workers));
+    }
+    // the representation refers to the space without owning it
+    MultiRepAdaptiveDiscreteSpacePtr ref(space.get(), [](MultiRepAdaptiveDiscreteSpace *) { });
+    std::shared_ptr<GridRepresentation> rep =
+            std::make_shared<GridRepresentation>(ref, obstacles);
+    EXPECT_TRUE(space->RegisterFullDRepresentation(rep));
+
+    std::vector<Transition> transitions;
+    std::vector<char> visited;
+    std::deque<int> queue = { rep->CreateState(W / 2, W / 2) };
+    while (!queue.empty()) {
+        const int state_id = queue.front();
+        queue.pop_front();
+        if ((int)visited.size() <= state_id) {
+            visited.resize(state_id + 1, 0);
+        }
+        if (visited[state_id]) {
+            continue;
+        }
+        visited[state_id] = 1;
+
+        Transition t;
+        t.source = state_id;
+        space->GetSuccs(state_id, &t.succs, &t.costs);
+        for (int succ : t.succs) {
+            queue.push_back(succ);
+        }
+        transitions.push_back(std::move(t));
+    }
+    EXPECT_EQ(0, rep->badWorkers());
+    return transitions;
+}
+
+} // namespace
+
+TEST(ParallelSuccessorsTest, NumWorkers)
+{
+    GridSpace space;
+    EXPECT_EQ(1, space.NumWorkers());
+    space.SetThreadPool(std::make_shared<ThreadPool>(3));
+    EXPECT_EQ(3, space.NumWorkers());
+}
+
+TEST(ParallelSuccessorsTest, ParallelMatchesSequentialValidation)
+{
+    std::vector<char> obstacles(W * W, 0);
+    srand(5);
+    for (char &o : obstacles) {
+        o = rand() % 5 == 0;
+    }
+    obstacles[(W / 2) * W + W / 2] = 0;
+
+    const std::vector<Transition> sequential = ExploreGrid(obstacles, 0);
+    ASSERT_GT(sequential.size(), 100u);
+    for (int num_workers : { 1, 2, 4, 8 }) {
+        SCOPED_TRACE(num_workers);
+        const std::vector<Transition> parallel = ExploreGrid(obstacles, num_workers);
+        ASSERT_EQ(sequential.size(), parallel.size());
+        for (size_t i = 0; i < sequential.size(); ++i) {
+            ASSERT_EQ(sequential[i].source, parallel[i].source);
+            ASSERT_EQ(sequential[i].succs, parallel[i].succs);
+            ASSERT_EQ(sequential[i].costs, parallel[i].costs);
+        }
+    }
+}
+
+// The state table is locked while tasks run on more than one worker, so tasks
+// may create states concurrently
+TEST(ParallelSuccessorsTest, ConcurrentStateCreation)
+{
+    std::vector<char> obstacles(W * W, 0);
+    std::shared_ptr<GridSpace> space = std::make_shared<GridSpace>();
+    space->SetThreadPool(std::make_shared<ThreadPool>(4));
+    MultiRepAdaptiveDiscreteSpacePtr ref(space.get(), [](MultiRepAdaptiveDiscreteSpace *) { });
+    std::shared_ptr<GridRepresentation> rep =
+            std::make_shared<GridRepresentation>(ref, obstacles);
+    ASSERT_TRUE(space->RegisterFullDRepresentation(rep));
+
+    const size_t n = 20000;
+    std::vector<int> ids(n, -1);
+    space->ParallelFor(n, [&](size_t i, int)
+    {
+        ids[i] = rep->CreateState((int)(i % W), (int)(i / W) % W);
+    });
+
+    // every cell was created once, and every task found its id
+    EXPECT_EQ(W * W, space->SizeofCreatedEnv());
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(ids[i % (W * W)], ids[i]);
+        const GridState *s = space->GetState(ids[i])->dataAs<GridState>();
+        ASSERT_EQ((int)(i % W), s->x);
+        ASSERT_EQ((int)(i / W) % W, s->y);
+    }
+}
+
+TEST(ParallelSuccessorsTest, SharedPoolIsMutableState)
+{
+    GridSpace a;
+    GridSpace b;
+    EXPECT_FALSE(a.sharesMutableState(b));
+    ThreadPoolPtr pool = std::make_shared<ThreadPool>(2);
+    a.SetThreadPool(pool);
+    EXPECT_FALSE(a.sharesMutableState(b));
+    b.SetThreadPool(pool);
+    EXPECT_TRUE(a.sharesMutableState(b));
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,122 @@
+// standard includes
+#include <memory>
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/mrep/search/queue_scheduler.h>
+
+using namespace adim;
+
+TEST(RoundRobinSchedulerTest, VisitsQueuesInCyclicOrder)
+{
+    RoundRobinScheduler scheduler;
+    scheduler.reset(4);
+    const std::vector<int> queues = { 1, 2, 3 };
+    for (int round = 0; round < 3; ++round) {
+        EXPECT_EQ(1, scheduler.selectQueue(queues));
+        EXPECT_EQ(2, scheduler.selectQueue(queues));
+        EXPECT_EQ(3, scheduler.selectQueue(queues));
+    }
+}
+
+TEST(RoundRobinSchedulerTest, SkipsQueuesThatAreNotCandidates)
+{
+    RoundRobinScheduler scheduler;
+    scheduler.reset(5);
+    EXPECT_EQ(1, scheduler.selectQueue({ 1, 2, 3, 4 }));
+    EXPECT_EQ(3, scheduler.selectQueue({ 1, 3, 4 }));
+    EXPECT_EQ(1, scheduler.selectQueue({ 1, 2 }));
+    EXPECT_EQ(4, scheduler.selectQueue({ 4 }));
+    EXPECT_EQ(2, scheduler.selectQueue({ 2, 3 }));
+
+    scheduler.reset(5);
+    EXPECT_EQ(2, scheduler.selectQueue({ 3, 2 }));
+}
+
+TEST(ThompsonSamplingSchedulerTest, SelectsOnlyCandidates)
+{
+    ThompsonSamplingScheduler scheduler;
+    scheduler.reset(6);
+    const std::vector<int> queues = { 2, 4, 5 };
+    for (int i = 0; i < 1000; ++i) {
+        const int q = scheduler.selectQueue(queues);
+        ASSERT_TRUE(q == 2 || q == 4 || q == 5);
+        scheduler.update(q, i % 3 == 0);
+    }
+}
+
+TEST(ThompsonSamplingSchedulerTest, ResetReplaysSelections)
+{
+    ThompsonSamplingScheduler scheduler(10.0, 7);
+    const std::vector<int> queues = { 1, 2, 3, 4 };
+    std::vector<int> first;
+    for (int run = 0; run < 2; ++run) {
+        scheduler.reset(5);
+        for (int i = 0; i < 200; ++i) {
+            const int q = scheduler.selectQueue(queues);
+            scheduler.update(q, q == 3);
+            if (run == 0) {
+                first.push_back(q);
+            }
+            else {
+                ASSERT_EQ(first[i], q);
+            }
+        }
+    }
+}
+
+TEST(ThompsonSamplingSchedulerTest, PrefersQueueThatMakesProgress)
+{
+    ThompsonSamplingScheduler scheduler;
+    scheduler.reset(4);
+    const std::vector<int> queues = { 1, 2, 3 };
+    int selected = 0;
+    for (int i = 0; i < 1000; ++i) {
+        const int q = scheduler.selectQueue(queues);
+        scheduler.update(q, q == 2);
+        if (q == 2) {
+            ++selected;
+        }
+    }
+    EXPECT_GT(selected, 800);
+}
+
+// The history bound lets the scheduler follow a change in which queue makes
+// progress
+TEST(ThompsonSamplingSchedulerTest, AdaptsToChangingProgress)
+{
+    ThompsonSamplingScheduler scheduler(10.0);
+    scheduler.reset(3);
+    const std::vector<int> queues = { 1, 2 };
+    for (int i = 0; i < 1000; ++i) {
+        const int q = scheduler.selectQueue(queues);
+        scheduler.update(q, q == 1);
+    }
+
+    int selected = 0;
+    for (int i = 0; i < 300; ++i) {
+        const int q = scheduler.selectQueue(queues);
+        scheduler.update(q, q == 2);
+        if (i >= 200 && q == 2) {
+            ++selected;
+        }
+    }
+    EXPECT_GT(selected, 80);
+}
+
+TEST(QueueSchedulerTest, MakeQueueScheduler)
+{
+    std::unique_ptr<QueueScheduler> rr(MakeQueueScheduler(QueueSchedulerType::ROUND_ROBIN));
+    EXPECT_TRUE(dynamic_cast<RoundRobinScheduler *>(rr.get()) != nullptr);
+    std::unique_ptr<QueueScheduler> ts(MakeQueueScheduler(QueueSchedulerType::THOMPSON_SAMPLING));
+    EXPECT_TRUE(dynamic_cast<ThompsonSamplingScheduler *>(ts.get()) != nullptr);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
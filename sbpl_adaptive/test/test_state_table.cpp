@@ -0,0 +1,143 @@
+// standard includes
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/mrep/graph/state_table.h>
+
+using namespace adim;
+
+namespace {
+
+std::vector<AdaptiveHashEntry> MakeEntries(size_t n)
+{
+    std::vector<AdaptiveHashEntry> entries(n);
+    for (size_t i = 0; i < n; ++i) {
+        entries[i].stateID = (int)i;
+        entries[i].dimID = 0;
+        entries[i].stateData = nullptr;
+    }
+    return entries;
+}
+
+AdaptiveHashEntry *Find(const AdaptiveStateTable &table, size_t hash, int state_id)
+{
+    return table.find(hash, [&](AdaptiveHashEntry *e) {
+        return e->stateID == state_id;
+    });
+}
+
+} // namespace
+
+TEST(AdaptiveStateTableTest, CapacityIsPowerOfTwo)
+{
+    EXPECT_EQ(1u, AdaptiveStateTable(1).capacity());
+    EXPECT_EQ(8u, AdaptiveStateTable(5).capacity());
+    EXPECT_EQ(1024u, AdaptiveStateTable().capacity());
+}
+
+TEST(AdaptiveStateTableTest, InsertAndFindUnderGrowth)
+{
+    const size_t n = 20000;
+    std::vector<AdaptiveHashEntry> entries = MakeEntries(n);
+    AdaptiveStateTable table(2);
+    for (size_t i = 0; i < n; ++i) {
+        table.insert(&entries[i], i);
+        ASSERT_EQ(i + 1, table.size());
+        ASSERT_LE((double)table.size(), AdaptiveStateTable::max_load_factor() * table.capacity());
+    }
+    EXPECT_EQ(0u, table.capacity() & (table.capacity() - 1));
+
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(&entries[i], Find(table, i, (int)i));
+    }
+    // absent hashes, and present hashes with no equivalent entry
+    for (size_t i = n; i < 2 * n; ++i) {
+        ASSERT_TRUE(Find(table, i, (int)i) == nullptr);
+    }
+    for (size_t i = 0; i < n; i += 97) {
+        ASSERT_TRUE(Find(table, i, -1) == nullptr);
+    }
+}
+
+// Many entries with equal hash values, and entries whose home slots lie
+// within the clusters formed by them, exercise robin hood displacement and
+// the early termination of unsuccessful lookups
+TEST(AdaptiveStateTableTest, CollidingHashes)
+{
+    const size_t n = 3000;
+    std::vector<AdaptiveHashEntry> entries = MakeEntries(n);
+    std::vector<size_t> hashes(n);
+    AdaptiveStateTable table(16);
+    for (size_t i = 0; i < n; ++i) {
+        hashes[i] = i % 3 == 0 ? 42 : (i % 3 == 1 ? i % 17 : i);
+        table.insert(&entries[i], hashes[i]);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(&entries[i], Find(table, hashes[i], (int)i));
+        // an entry is not found under a hash other than its own
+        if (hashes[i] != 42) {
+            ASSERT_TRUE(Find(table, 42, (int)i) == nullptr);
+        }
+    }
+    for (size_t h = 100000; h < 100500; ++h) {
+        ASSERT_TRUE(Find(table, h, 0) == nullptr);
+    }
+}
+
+TEST(AdaptiveStateTableTest, ClearKeepsCapacity)
+{
+    const size_t n = 5000;
+    std::vector<AdaptiveHashEntry> entries = MakeEntries(n);
+    AdaptiveStateTable table(4);
+    for (size_t i = 0; i < n / 2; ++i) {
+        table.insert(&entries[i], i);
+    }
+    const size_t capacity = table.capacity();
+
+    table.clear();
+    EXPECT_EQ(0u, table.size());
+    EXPECT_EQ(capacity, table.capacity());
+    for (size_t i = 0; i < n / 2; ++i) {
+        ASSERT_TRUE(Find(table, i, (int)i) == nullptr);
+    }
+
+    // entries inserted after clearing are found, entries from before are
+    // not, even under the same hash values
+    for (size_t i = n / 2; i < n; ++i) {
+        table.insert(&entries[i], i - n / 2);
+    }
+    EXPECT_EQ(n - n / 2, table.size());
+    for (size_t i = n / 2; i < n; ++i) {
+        ASSERT_EQ(&entries[i], Find(table, i - n / 2, (int)i));
+        ASSERT_TRUE(Find(table, i - n / 2, (int)(i - n / 2)) == nullptr);
+    }
+}
+
+TEST(AdaptiveStateTableTest, RepeatedClears)
+{
+    std::vector<AdaptiveHashEntry> entries = MakeEntries(64);
+    AdaptiveStateTable table(8);
+    for (int round = 0; round < 1000; ++round) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if ((i + round) % 3 != 0) {
+                table.insert(&entries[i], i * 31 + round);
+            }
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            AdaptiveHashEntry *found = Find(table, i * 31 + round, (int)i);
+            ASSERT_EQ((i + round) % 3 != 0, found != nullptr);
+        }
+        table.clear();
+        ASSERT_EQ(0u, table.size());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
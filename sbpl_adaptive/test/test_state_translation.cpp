@@ -0,0 +1,213 @@
+// standard includes
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/common.h>
+#include <sbpl_adaptive/mrep/graph/adaptive_state_representation.h>
+#include <sbpl_adaptive/mrep/graph/multirep_adaptive_discrete_space.h>
+
+using namespace adim;
+
+namespace {
+
+const int W = 32;
+
+struct CellState : public AdaptiveState
+{
+    int x;
+    int y;
+    CellState(int x, int y) : x(x), y(y) { }
+};
+
+class GridSpace : public MultiRepAdaptiveDiscreteSpace
+{
+public:
+
+    void expandingState(int) override { }
+    int getBestSeenState() override { return -1; }
+    void addSphere(int, std::vector<int> *) override { }
+    void addSphere(int, int &) override { }
+    void processCostlyPath(
+        const std::vector<int> &,
+        const std::vector<int> &,
+        std::vector<int> *) override { }
+    void reset() override { }
+
+    int GetFromToHeuristic(int, int) override { return 0; }
+    int GetGoalHeuristic(int) override { return 0; }
+    int GetStartHeuristic(int) override { return 0; }
+
+    bool InitializeEnv(const char *) override { return true; }
+    bool InitializeMDPCfg(void *) override { return true; }
+    void SetAllActionsandAllOutcomes(void *) override { }
+    void SetAllPreds(void *) override { }
+    int SizeofCreatedEnv() override { return (int)state_id_to_hash_entry_.size(); }
+    void PrintState(int, bool, FILE *) override { }
+    void PrintEnv_Config(FILE *) override { }
+};
+
+// A grid representation of cells, optionally supporting state translation
+class CellRepresentation : public AdaptiveStateRepresentation
+{
+public:
+
+    CellRepresentation(
+        const MultiRepAdaptiveDiscreteSpacePtr &space,
+        const std::string &name,
+        bool translation)
+    :
+        AdaptiveStateRepresentation(space, true, name),
+        translation_(translation)
+    {
+    }
+
+    int CreateState(int x, int y)
+    {
+        AdaptiveHashEntry *entry = mrepSpace()->FindOrInsertState(
+                hash(x, y), getID(), equal(x, y), CellState(x, y));
+        return entry->stateID;
+    }
+
+    int FindOrCreateState(const AdaptiveState *state) override
+    {
+        if (!translation_) {
+            return -1;
+        }
+        const CellState *s = state_cast<CellState>(state);
+        return CreateState(s->x, s->y);
+    }
+
+    bool SupportsStateTranslation() const override { return translation_; }
+
+    int SetStartCoords(const AdaptiveState *) override { return 0; }
+    int SetStartConfig(const ModelCoords *) override { return 0; }
+    int SetGoalCoords(const AdaptiveState *) override { return 0; }
+    int SetGoalConfig(const ModelCoords *) override { return 0; }
+    bool isGoalState(int) const override { return false; }
+    void GetSuccs(int, std::vector<int> *, std::vector<int> *) override { }
+    void GetTrackSuccs(int, std::vector<int> *, std::vector<int> *) override { }
+    void GetPreds(int, std::vector<int> *, std::vector<int> *) override { }
+    bool IsValidStateData(const AdaptiveState *) const override { return true; }
+    bool IsValidConfig(const ModelCoords *) const override { return true; }
+    int GetGoalHeuristic(int) const override { return 0; }
+    void PrintState(int, bool, FILE *) const override { }
+    void PrintStateData(const AdaptiveState *, bool, FILE *) const override { }
+    void VisualizeState(int, int, const std::string &, int &) const override { }
+    bool ProjectToFullD(const AdaptiveState *, std::vector<int> &, int) override { return false; }
+    bool ProjectFromFullD(const AdaptiveState *, std::vector<int> &, int) override { return false; }
+    void deleteStateData(int) override { }
+    void toCont(const AdaptiveState *, ModelCoords *) const override { }
+    void toDisc(const ModelCoords *, AdaptiveState *) const override { }
+
+private:
+
+    bool translation_;
+
+    static size_t hash(int x, int y) { return (size_t)(y * W + x); }
+
+    static std::function<bool(AdaptiveHashEntry *)> equal(int x, int y)
+    {
+        return [x, y](AdaptiveHashEntry *e) {
+            const CellState *s = e->dataAs<CellState>();
+            return s->x == x && s->y == y;
+        };
+    }
+};
+
+// A space with a full-dimensional and a second representation, which refer
+// to the space without owning it
+struct Replica
+{
+    std::shared_ptr<GridSpace> space;
+    std::shared_ptr<CellRepresentation> full;
+    std::shared_ptr<CellRepresentation> coarse;
+
+    explicit Replica(bool translation = true) : space(std::make_shared<GridSpace>())
+    {
+        MultiRepAdaptiveDiscreteSpacePtr ref(
+                space.get(), [](MultiRepAdaptiveDiscreteSpace *) { });
+        full = std::make_shared<CellRepresentation>(ref, "full", true);
+        coarse = std::make_shared<CellRepresentation>(ref, "coarse", translation);
+        space->RegisterFullDRepresentation(full);
+        space->RegisterRepresentation(coarse);
+    }
+};
+
+} // namespace
+
+TEST(StateTranslationTest, TranslatesBetweenReplicas)
+{
+    Replica a;
+    Replica b;
+    ASSERT_TRUE(a.space->supportsStateTranslation());
+    ASSERT_TRUE(b.space->supportsStateTranslation());
+
+    // populate the replicas in different orders so that their ids differ
+    std::vector<int> a_ids;
+    for (int i = 0; i < 50; ++i) {
+        a_ids.push_back(a.full->CreateState(i % W, i / W));
+        a_ids.push_back(a.coarse->CreateState(i % W, i / W));
+    }
+    for (int i = 49; i >= 0; i -= 3) {
+        b.coarse->CreateState(i % W, i / W);
+    }
+
+    for (int a_id : a_ids) {
+        const int b_id = b.space->translateStateID(*a.space, a_id);
+        ASSERT_GE(b_id, 0);
+        const AdaptiveHashEntry *ea = a.space->GetState(a_id);
+        const AdaptiveHashEntry *eb = b.space->GetState(b_id);
+        EXPECT_EQ(ea->dimID, eb->dimID);
+        EXPECT_EQ(ea->dataAs<CellState>()->x, eb->dataAs<CellState>()->x);
+        EXPECT_EQ(ea->dataAs<CellState>()->y, eb->dataAs<CellState>()->y);
+
+        // translation finds existing states, and translating back is the
+        // identity
+        EXPECT_EQ(b_id, b.space->translateStateID(*a.space, a_id));
+        EXPECT_EQ(a_id, a.space->translateStateID(*b.space, b_id));
+    }
+    EXPECT_EQ(a.space->SizeofCreatedEnv(), b.space->SizeofCreatedEnv());
+
+    EXPECT_EQ(a_ids[7], a.space->translateStateID(*a.space, a_ids[7]));
+    EXPECT_EQ(-1, b.space->translateStateID(*a.space, -1));
+    EXPECT_EQ(-1, b.space->translateStateID(*a.space, a.space->SizeofCreatedEnv()));
+}
+
+TEST(StateTranslationTest, AbstractGoalTranslatesToGoal)
+{
+    Replica a;
+    Replica b;
+    AbstractGoal goal;
+    a.full->CreateState(1, 1);
+    const int a_goal = a.space->SetAbstractGoal(&goal);
+    const int b_goal = b.space->SetAbstractGoal(&goal);
+    EXPECT_NE(a_goal, b_goal);
+    EXPECT_EQ(b_goal, b.space->translateStateID(*a.space, a_goal));
+    EXPECT_EQ(a_goal, a.space->translateStateID(*b.space, b_goal));
+}
+
+TEST(StateTranslationTest, RequiresEveryRepresentation)
+{
+    Replica a;
+    Replica b(false);
+    EXPECT_TRUE(a.space->supportsStateTranslation());
+    EXPECT_FALSE(b.space->supportsStateTranslation());
+    EXPECT_FALSE(GridSpace().supportsStateTranslation());
+
+    const int full_id = a.full->CreateState(3, 4);
+    const int coarse_id = a.coarse->CreateState(3, 4);
+    EXPECT_GE(b.space->translateStateID(*a.space, full_id), 0);
+    EXPECT_EQ(-1, b.space->translateStateID(*a.space, coarse_id));
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
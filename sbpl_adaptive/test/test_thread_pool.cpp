@@ -0,0 +1,131 @@
+// standard includes
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// system includes
+#include <gtest/gtest.h>
+
+// project includes
+#include <sbpl_adaptive/thread_pool.h>
+
+using namespace adim;
+
+namespace {
+
+// Run a loop over n indices and check that every index was visited exactly
+// once, by a valid worker
+void ExpectVisitsEveryIndexOnce(ThreadPool &pool, size_t n)
+{
+    std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[n]);
+    for (size_t i = 0; i < n; ++i) {
+        visits[i] = 0;
+    }
+    std::atomic<int> bad_worker(0);
+
+    pool.parallelFor(n, [&](size_t i, int worker) {
+        ++visits[i];
+        if (worker < 0 || worker >= pool.numWorkers()) {
+            ++bad_worker;
+        }
+    });
+
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(1, visits[i].load()) << "index " << i;
+    }
+    EXPECT_EQ(0, bad_worker.load());
+}
+
+} // namespace
+
+TEST(ThreadPoolTest, DefaultsToAtLeastOneWorker)
+{
+    ThreadPool pool;
+    EXPECT_GE(pool.numWorkers(), 1);
+}
+
+TEST(ThreadPoolTest, CompletesEveryIndex)
+{
+    for (int workers : { 1, 2, 4, 7 }) {
+        SCOPED_TRACE(workers);
+        ThreadPool pool(workers);
+        EXPECT_EQ(workers, pool.numWorkers());
+        for (size_t n : { 0, 1, 2, 3, 7, 64, 1000, 100000 }) {
+            SCOPED_TRACE(n);
+            ExpectVisitsEveryIndexOnce(pool, n);
+        }
+    }
+}
+
+TEST(ThreadPoolTest, UnevenWorkIsBalanced)
+{
+    ThreadPool pool(4);
+    std::vector<int> out(256, 0);
+    // the first quarter of the range is much more expensive than the rest
+    pool.parallelFor(out.size(), [&](size_t i, int) {
+        if (i < out.size() / 4) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        out[i] = (int)i * 2;
+    });
+    for (size_t i = 0; i < out.size(); ++i) {
+        ASSERT_EQ((int)i * 2, out[i]);
+    }
+}
+
+TEST(ThreadPoolTest, CallingThreadIsWorkerZero)
+{
+    ThreadPool pool(1);
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<int> other(0);
+    pool.parallelFor(100, [&](size_t, int worker) {
+        if (worker != 0 || std::this_thread::get_id() != caller) {
+            ++other;
+        }
+    });
+    EXPECT_EQ(0, other.load());
+}
+
+TEST(ThreadPoolTest, RethrowsAndRemainsUsable)
+{
+    for (int workers : { 1, 4 }) {
+        SCOPED_TRACE(workers);
+        ThreadPool pool(workers);
+        std::atomic<int> calls(0);
+        EXPECT_THROW(
+            pool.parallelFor(10000, [&](size_t i, int) {
+                ++calls;
+                if (i == 5000) {
+                    throw std::runtime_error("task failed");
+                }
+            }),
+            std::runtime_error);
+        EXPECT_GE(calls.load(), 1);
+        EXPECT_LE(calls.load(), 10000);
+
+        // the exception does not leak into the next loop
+        ExpectVisitsEveryIndexOnce(pool, 10000);
+    }
+}
+
+TEST(ThreadPoolTest, RethrowsOneOfManyExceptions)
+{
+    ThreadPool pool(4);
+    for (int round = 0; round < 20; ++round) {
+        EXPECT_THROW(
+            pool.parallelFor(1000, [](size_t, int) {
+                throw std::logic_error("every task fails");
+            }),
+            std::logic_error);
+    }
+    ExpectVisitsEveryIndexOnce(pool, 1000);
+}
+
+int main(int argc, char *argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
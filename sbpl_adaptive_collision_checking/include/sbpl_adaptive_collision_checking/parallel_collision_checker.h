@@ -0,0 +1,79 @@
+#ifndef SBPL_ADAPTIVE_COLLISION_CHECKING_PARALLEL_COLLISION_CHECKER_H
+#define SBPL_ADAPTIVE_COLLISION_CHECKING_PARALLEL_COLLISION_CHECKER_H
+
+// standard includes
+#include <vector>
+
+// system includes
+#include <sbpl_adaptive/thread_pool.h>
+#include <smpl/forward.h>
+
+// project includes
+#include <sbpl_adaptive_collision_checking/sbpl_collision_space.h>
+#include <sbpl_adaptive_collision_checking/urdf_collision_model.h>
+
+namespace adim {
+
+SBPL_CLASS_FORWARD(ParallelCollisionChecker)
+
+/// Runs batches of independent collision checks, e.g. the motion primitives
+/// of a single expansion, on a thread pool.
+///
+/// Neither SBPLCollisionSpace nor URDFCollisionModel is safe to use from
+/// multiple threads (the URDF model updates its robot state while computing
+/// spheres), so each worker uses its own collision space and model. The
+/// collision spaces may share the same (read-only) occupancy grid. Results are
+/// written to the slot of each query, so they do not depend on the schedule.
+class ParallelCollisionChecker
+{
+public:
+
+    /// \param pool The thread pool; if null, checks run sequentially
+    /// \param spaces One collision space per worker of the pool, each with its
+    ///     own collision model
+    ParallelCollisionChecker(
+        const ThreadPoolPtr &pool,
+        const std::vector<SBPLCollisionSpacePtr> &spaces);
+
+    /// Set the models used for self-collision checks, one per worker of the
+    /// pool
+    void setSelfCollisionModels(
+        const std::vector<URDFCollisionModelConstPtr> &models);
+
+    int numWorkers() const;
+
+    /// Check a batch of configurations against the environment. valid[i] is
+    /// set to whether coords[i] is collision-free and dists[i] to the distance
+    /// reported by the collision space.
+    void checkCollisions(
+        const std::vector<const ModelCoords *> &coords,
+        std::vector<char> &valid,
+        std::vector<double> &dists);
+
+    /// Check a batch of interpolated segments coords0[i] -> coords1[i]
+    /// against the environment.
+    void checkCollisions(
+        const std::vector<const ModelCoords *> &coords0,
+        const std::vector<const ModelCoords *> &coords1,
+        int steps,
+        std::vector<char> &valid,
+        std::vector<double> &dists);
+
+    /// Check a batch of configurations for self-collisions. valid[i] is set to
+    /// whether coords[i] is free of self-collisions.
+    void checkSelfCollisions(
+        const std::vector<const URDFModelCoords *> &coords,
+        std::vector<char> &valid);
+
+private:
+
+    ThreadPoolPtr pool_;
+    std::vector<SBPLCollisionSpacePtr> spaces_;
+    std::vector<URDFCollisionModelConstPtr> models_;
+
+    void parallelFor(size_t n, const ThreadPool::Task &task);
+};
+
+} // namespace adim
+
+#endif
@@ -0,0 +1,98 @@
+#include <sbpl_adaptive_collision_checking/parallel_collision_checker.h>
+
+// standard includes
+#include <assert.h>
+
+namespace adim {
+
+ParallelCollisionChecker::ParallelCollisionChecker(
+    const ThreadPoolPtr &pool,
+    const std::vector<SBPLCollisionSpacePtr> &spaces)
+:
+    pool_(pool),
+    spaces_(spaces),
+    models_()
+{
+    if ((int)spaces_.size() < numWorkers()) {
+        ROS_ERROR("Expected %d collision spaces for parallel collision checking (got %zu). Checks will run sequentially.",
+                numWorkers(), spaces_.size());
+        pool_.reset();
+    }
+}
+
+void ParallelCollisionChecker::setSelfCollisionModels(
+    const std::vector<URDFCollisionModelConstPtr> &models)
+{
+    if ((int)models.size() < numWorkers()) {
+        ROS_ERROR("Expected %d collision models for parallel self-collision checking (got %zu)",
+                numWorkers(), models.size());
+        return;
+    }
+    models_ = models;
+}
+
+int ParallelCollisionChecker::numWorkers() const
+{
+    return pool_ ? pool_->numWorkers() : 1;
+}
+
+void ParallelCollisionChecker::checkCollisions(
+    const std::vector<const ModelCoords *> &coords,
+    std::vector<char> &valid,
+    std::vector<double> &dists)
+{
+    valid.assign(coords.size(), false);
+    dists.assign(coords.size(), 0.0);
+    parallelFor(coords.size(), [&](size_t i, int worker)
+    {
+        valid[i] = spaces_[worker]->checkCollision(*coords[i], dists[i]);
+    });
+}
+
+void ParallelCollisionChecker::checkCollisions(
+    const std::vector<const ModelCoords *> &coords0,
+    const std::vector<const ModelCoords *> &coords1,
+    int steps,
+    std::vector<char> &valid,
+    std::vector<double> &dists)
+{
+    assert(coords0.size() == coords1.size());
+    valid.assign(coords0.size(), false);
+    dists.assign(coords0.size(), 0.0);
+    parallelFor(coords0.size(), [&](size_t i, int worker)
+    {
+        valid[i] = spaces_[worker]->checkCollision(
+                *coords0[i], *coords1[i], steps, dists[i]);
+    });
+}
+
+void ParallelCollisionChecker::checkSelfCollisions(
+    const std::vector<const URDFModelCoords *> &coords,
+    std::vector<char> &valid)
+{
+    valid.assign(coords.size(), false);
+    if (models_.empty()) {
+        ROS_ERROR("No collision models set for self-collision checking");
+        return;
+    }
+    parallelFor(coords.size(), [&](size_t i, int worker)
+    {
+        valid[i] = models_[worker]->checkSelfCollisions(*coords[i]);
+    });
+}
+
+void ParallelCollisionChecker::parallelFor(
+    size_t n,
+    const ThreadPool::Task &task)
+{
+    if (pool_) {
+        pool_->parallelFor(n, task);
+    }
+    else {
+        for (size_t i = 0; i < n; ++i) {
+            task(i, 0);
+        }
+    }
+}
+
+} // namespace adim